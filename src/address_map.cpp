@@ -0,0 +1,104 @@
+/**
+ * filename: address_map.cpp
+ *
+ * description: fitting 64 bit trace addresses into address_t
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "address_map.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+constexpr uint_fast8_t kAddressBits{8 * sizeof(address_t)};
+
+uint64_t LowMask(uint_fast8_t low_bits)
+{
+	return low_bits >= 64 ? ~uint64_t{} : (uint64_t{1} << low_bits) - 1;
+}
+}  // namespace
+
+std::optional<AddressMap> AddressMap::Build(std::vector<uint64_t> addresses)
+{
+	if (std::ranges::all_of(
+			addresses,
+			[](uint64_t a)
+			{ return a <= std::numeric_limits<address_t>::max(); }))
+		return {};
+
+	std::ranges::sort(addresses);
+	const auto [last, end]{std::ranges::unique(addresses)};
+	addresses.erase(last, end);
+
+	// the most low bits whose upper values can still be ranked in the bits
+	// left over. Shifting sorted values keeps them sorted, so equal upper
+	// values are neighbours
+	AddressMap map{.low_bits = 0, .high = {}};
+	for (uint_fast8_t low_bits{kAddressBits}; low_bits > 0; --low_bits)
+	{
+		uint64_t distinct{};
+		uint64_t previous{};
+		for (const auto a : addresses)
+		{
+			const auto upper{a >> low_bits};
+			distinct += distinct == 0 || upper != previous;
+			previous = upper;
+		}
+		if (distinct <= uint64_t{1} << (kAddressBits - low_bits))
+		{
+			map.low_bits = low_bits;
+			break;
+		}
+	}
+
+	for (const auto a : addresses)
+	{
+		const auto upper{a >> map.low_bits};
+		if (map.high.empty() || map.high.back() != upper)
+			map.high.push_back(upper);
+	}
+	return map;
+}
+
+std::optional<AddressMap> AddressMap::Unify(
+	const std::vector<std::reference_wrapper<StackTrace>> &traces,
+	const std::vector<std::optional<AddressMap>> &maps)
+{
+	if (std::ranges::none_of(maps, [](const auto &m) { return m.has_value(); }))
+		return {};
+
+	// the addresses as they were before each trace was renumbered
+	const auto original{[&](size_t i, address_t address)
+						{
+							return maps[i].has_value()
+									   ? maps[i]->Expand(address)
+									   : uint64_t{address};
+						}};
+	std::vector<uint64_t> addresses;
+	for (size_t i{}; i < traces.size(); ++i)
+		for (const auto &ma : traces[i].get())
+			addresses.push_back(original(i, ma.address));
+
+	auto map{Build(std::move(addresses))};
+	for (size_t i{}; i < traces.size(); ++i)
+		for (auto &ma : traces[i].get())
+			ma.address = map->Compact(original(i, ma.address));
+	return map;
+}
+
+address_t AddressMap::Compact(uint64_t address) const
+{
+	const auto rank{std::ranges::lower_bound(high, address >> low_bits) -
+					high.begin()};
+	return static_cast<address_t>((static_cast<uint64_t>(rank) << low_bits) |
+								  (address & LowMask(low_bits)));
+}
+
+uint64_t AddressMap::Expand(address_t address) const
+{
+	const uint64_t a{address};
+	return (high[a >> low_bits] << low_bits) | (a & LowMask(low_bits));
+}
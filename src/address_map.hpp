@@ -0,0 +1,65 @@
+/**
+ * filename: address_map.hpp
+ *
+ * description: header file for fitting 64 bit trace addresses into address_t
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief an order preserving renumbering of 64 bit addresses into address_t
+ * @description The low_bits of every address are kept as they are and the
+ *bits above them are replaced by their rank among the values above low_bits
+ *the trace uses. Two addresses then agree on any bits at or above a bit
+ *below low_bits exactly when the originals do, so a cache or TLB that only
+ *splits addresses at bits up to low_bits, offset plus index bits or page
+ *bits, hits and misses exactly as it would on the original addresses.
+ *low_bits is as large as the number of distinct upper values allows, 32 when
+ *they all share their upper half.
+ **/
+struct AddressMap
+{
+	uint_fast8_t low_bits;
+	// the bits above low_bits of each rank, ascending
+	std::vector<uint64_t> high;
+
+	/**
+	 * @brief the map of the addresses
+	 * @return nothing if every address already fits in address_t
+	 **/
+	static std::optional<AddressMap> Build(std::vector<uint64_t> addresses);
+
+	/**
+	 * @brief renumber traces that are simulated together with one map over
+	 *all their addresses, so the same address is the same in every trace
+	 * @param maps the map each trace was read with, nothing for a trace that
+	 *fit in address_t
+	 * @return the map every trace now uses, nothing if they all fit
+	 **/
+	static std::optional<AddressMap> Unify(
+		const std::vector<std::reference_wrapper<StackTrace>> &traces,
+		const std::vector<std::optional<AddressMap>> &maps);
+
+	// address must be one the map was built from
+	address_t Compact(uint64_t address) const;
+
+	uint64_t Expand(address_t address) const;
+
+	/**
+	 * @brief true if a cache or TLB splitting addresses at no more than bits
+	 *sees the same hits and misses as with the original addresses
+	 **/
+	bool IsExact(uint_fast8_t bits) const
+	{
+		return bits <= low_bits;
+	};
+};
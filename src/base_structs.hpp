@@ -9,6 +9,7 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
 #include <ostream>
 #include <vector>
 
@@ -45,6 +46,21 @@ enum ReplacementPolicy
 	FIFO
 };
 
+/**
+ * @brief how the contents of neighbouring levels of a hierarchy relate
+ * @description INCLUSIVE : every block in an upper level is also in the levels
+ *below it, evictions below back-invalidate the levels above
+ * EXCLUSIVE : a block lives in exactly one level, lower levels are filled by
+ *the victims of the level above
+ * NON_INCLUSIVE : levels are filled independently on a miss
+ **/
+enum InclusionPolicy
+{
+	INCLUSIVE,
+	EXCLUSIVE,
+	NON_INCLUSIVE
+};
+
 /**
  * @param uint_fast8_t line_size
  * @param uint_fast8_t associativity
@@ -70,6 +86,8 @@ struct CacheConf
 	 * true : FIFO replacement
 	 */
 	ReplacementPolicy replacement_policy_;
+	// seed of the victims random replacement picks
+	uint32_t seed_{};
 
 	CacheConf() = default;
 
@@ -86,6 +104,199 @@ struct CacheConf
 		  miss_penalty_{miss_penalty},
 		  cache_size_{cache_size},
 		  replacement_policy_{replacement_policy} {};
+
+	bool operator==(const CacheConf &) const = default;
+};
+
+enum PrefetcherType
+{
+	NEXT_LINE,
+	STRIDE,
+	STREAM
+};
+
+/**
+ * @param PrefetcherType type
+ * @param uint_fast8_t degree, blocks prefetched per trigger
+ * @param uint_fast8_t distance, blocks between the trigger and the first
+ *prefetch
+ * @param uint16_t table_size, stride table or stream tracker entries
+ */
+struct PrefetchConf
+{
+	PrefetcherType type_;
+	uint_fast8_t degree_{1};
+	uint_fast8_t distance_{1};
+	uint16_t table_size_{16};
+};
+
+struct PrefetchStats
+{
+	uint64_t issued;
+	// used by a demand access after the block arrived
+	uint64_t useful;
+	// used by a demand access before the block arrived
+	uint64_t late;
+	// evicted before use, or still unused at the end of the trace
+	uint64_t useless;
+	// blocks that were not prefetched, evicted to make room for a prefetch
+	uint64_t demand_evictions;
+	// used prefetches over issued prefetches
+	double accuracy;
+	// used prefetches over the misses there would have been without them
+	double coverage;
+};
+
+struct TimingStats
+{
+	// run time when misses are allowed to overlap
+	uint64_t run_time;
+	double average_memory_access_time;
+	// cycles spent waiting for a free MSHR
+	uint64_t mshr_stall_cycles;
+	// cycles loads spent waiting for a block that was still being fetched
+	uint64_t dependency_stall_cycles;
+	// misses merged into the MSHR of a block already being fetched
+	uint64_t merged_misses;
+	// average number of misses in flight while there was at least one
+	double memory_level_parallelism;
+};
+
+/**
+ * @param uint16_t entries
+ * @param uint_fast8_t associativity
+ * @param address_t page_size, bytes
+ * @param ReplacementPolicy replacement_policy
+ * @param uint16_t walk_penalty, cycles for a page walk on a miss
+ * @param uint16_t huge_entries, entries of the huge page TLB, 0 shares the
+ *base page TLB
+ * @param uint_fast8_t huge_associativity
+ * @param address_t huge_page_size, bytes
+ * @param huge_regions, inclusive [first, last] address ranges backed by huge
+ *pages
+ */
+struct TlbConf
+{
+	uint16_t entries_;
+	uint_fast8_t associativity_;
+	address_t page_size_{4096};
+	ReplacementPolicy replacement_policy_;
+	uint16_t walk_penalty_;
+	uint16_t huge_entries_{};
+	uint_fast8_t huge_associativity_{};
+	address_t huge_page_size_{2 * 1024 * 1024};
+	std::vector<std::pair<address_t, address_t>> huge_regions_{};
+};
+
+struct TlbStats
+{
+	uint64_t accesses;
+	uint64_t misses;
+	// accesses to huge pages, these are included in accesses and misses
+	uint64_t huge_accesses;
+	uint64_t huge_misses;
+	double hit_rate;
+	double huge_hit_rate;
+	// cycles spent walking the page table, included in the run time
+	uint64_t walk_cycles;
+};
+
+/**
+ * @param uint16_t entries, blocks the victim cache holds
+ * @param uint16_t hit_latency, cycles to swap a block back into the cache
+ */
+struct VictimCacheConf
+{
+	uint16_t entries_;
+	uint16_t hit_latency_{1};
+};
+
+struct VictimCacheStats
+{
+	// misses of the cache, each probes the victim cache
+	uint64_t probes;
+	uint64_t hits;
+	double hit_rate;
+	// blocks the cache evicted into the victim cache
+	uint64_t insertions;
+	// dirty blocks pushed out of the victim cache to memory
+	uint64_t writebacks;
+	// cycles spent swapping blocks back, included in the run time
+	uint64_t swap_cycles;
+};
+
+/**
+ * @param uint16_t depth, lines the buffer holds
+ * @param uint16_t drain_cycles, cycles to write one line to memory
+ */
+struct WriteBufferConf
+{
+	uint16_t depth_;
+	uint16_t drain_cycles_;
+};
+
+struct WriteBufferStats
+{
+	// writes to memory put in the buffer
+	uint64_t writes;
+	// writes merged into a line already waiting in the buffer
+	uint64_t coalesced;
+	double coalesce_rate;
+	// lines written to memory
+	uint64_t memory_writes;
+	// cycles spent waiting for a free entry, included in the run time
+	uint64_t stall_cycles;
+};
+
+/**
+ * PERIODIC : each interval ends its equal part of the trace
+ * RANDOM : each interval starts at a random place in its equal part of the
+ *trace
+ */
+enum SamplingPolicy
+{
+	PERIODIC,
+	RANDOM
+};
+
+struct SamplingConf
+{
+	SamplingPolicy policy_;
+	// detailed intervals taken from the trace, and the accesses in each
+	uint32_t intervals_;
+	uint32_t interval_length_;
+	/**
+	 * accesses before each interval that only update the cache tags, the
+	 *rest are skipped. Without a length the window is
+	 *CacheSimulator::kWarmingPasses times the blocks of the cache
+	 */
+	std::optional<uint32_t> warming_length_{};
+	uint32_t seed_{};
+};
+
+struct SamplingStats
+{
+	uint32_t intervals;
+	uint64_t sampled_accesses;
+	// accesses that only updated the tags, the rest were skipped
+	uint64_t warmed_accesses;
+	uint64_t total_accesses;
+	// half widths of the 95% confidence intervals of the estimates
+	double total_hit_rate_error;
+	double run_time_error;
+	double average_memory_access_time_error;
+};
+
+struct SetSamplingStats
+{
+	uint32_t sampled_sets;
+	uint32_t total_sets;
+	// fraction of the sets simulated
+	double sampling_ratio;
+	uint64_t sampled_accesses;
+	uint64_t total_accesses;
+	// half width of the 95% confidence interval of the total hit rate
+	double total_hit_rate_error;
 };
 
 struct Results
@@ -95,4 +306,56 @@ struct Results
 	double write_hit_rate;
 	uint64_t run_time;
 	double average_memory_access_time;
+	// only set when a prefetcher is attached to the cache
+	std::optional<PrefetchStats> prefetch{};
+	// only set when a timing model is attached to the cache
+	std::optional<TimingStats> timing{};
+	// only set when a TLB is attached to the cache
+	std::optional<TlbStats> tlb{};
+	// only set when a victim cache is attached to the cache
+	std::optional<VictimCacheStats> victim{};
+	// only set when a write buffer is attached to the cache
+	std::optional<WriteBufferStats> write_buffer{};
+	// only set when the results are estimated from samples of the trace
+	std::optional<SamplingStats> sampling{};
+	// only set when the results are estimated from a subset of the sets
+	std::optional<SetSamplingStats> set_sampling{};
+};
+
+/**
+ * @brief raw event counts of a simulation, results are derived from these
+ **/
+struct AccessCounts
+{
+	uint64_t reads;
+	uint64_t writes;
+	uint64_t read_misses;
+	uint64_t write_misses;
+	uint64_t instructions;
+
+	Results ToResults(uint64_t miss_penalty) const
+	{
+		const auto ac{reads + writes};
+		const auto misses{read_misses + write_misses};
+		return {.total_hit_rate =
+					1.0f - static_cast<double>(misses) / static_cast<double>(ac),
+				.read_hit_rate = 1.0f - static_cast<double>(read_misses) /
+											static_cast<double>(reads),
+				.write_hit_rate = 1.0f - static_cast<double>(write_misses) /
+											 static_cast<double>(writes),
+				.run_time = instructions + misses * miss_penalty,
+				.average_memory_access_time =
+					1 + (static_cast<double>(misses) / static_cast<double>(ac)) *
+							static_cast<double>(miss_penalty)};
+	}
+
+	AccessCounts &operator+=(const AccessCounts &rhs)
+	{
+		reads += rhs.reads;
+		writes += rhs.writes;
+		read_misses += rhs.read_misses;
+		write_misses += rhs.write_misses;
+		instructions += rhs.instructions;
+		return *this;
+	}
 };
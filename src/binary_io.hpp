@@ -0,0 +1,37 @@
+/**
+ * filename: binary_io.hpp
+ *
+ * description: helpers for reading and writing plain values to binary streams
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <type_traits>
+
+namespace BinaryIO
+{
+/**
+ * @brief write the bytes of a trivially copyable value in host byte order
+ **/
+template <typename T>
+	requires std::is_trivially_copyable_v<T>
+void Write(std::ostream &os, const T &v)
+{
+	os.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+/**
+ * @brief read a value written with Write, false if the stream ran out
+ **/
+template <typename T>
+	requires std::is_trivially_copyable_v<T>
+bool Read(std::istream &is, T &v)
+{
+	is.read(reinterpret_cast<char *>(&v), sizeof(T));
+	return static_cast<bool>(is);
+}
+}  // namespace BinaryIO
@@ -9,9 +9,13 @@
 #pragma once
 
 #include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
 #include <unordered_set>
 
 #include "base_structs.hpp"
+#include "binary_io.hpp"
 #include "cache_block.hpp"
 
 /**
@@ -33,13 +37,20 @@ struct CacheIndex
 
 	SearchMap map;
 
+	// flush generation the index was last used in, 0 before its first use
+	uint32_t epoch{};
+
 	CacheIndex(uint_fast8_t associativity,
 			   const CacheBlockCompare<T> &compare,
 			   const CacheBlockHash<T> &hash)
-		: associativity_(associativity),
-		  list(associativity),
-		  map(static_cast<size_t>(associativity), hash, compare)
+		: associativity_(associativity), map(0, hash, compare){};
+
+	// make room for associativity_ blocks. Done on the first use of the index
+	// so building a cache with many indicies stays cheap
+	void allocate()
 	{
+		list = T(associativity_);
+		list.clear();
 		map.reserve(associativity_);
 	};
 
@@ -98,18 +109,62 @@ struct CacheBase
 
 	/**
 	 * @brief returns true on hit, false on miss
+	 **/
+	bool AccessMemory(const address_t &address, const bool &read)
+	{
+		return Access(address, read).hit;
+	};
+
+	/**
+	 * @brief access the cache, reporting the evicted block on a miss
 	 * @description Two different instantiations for when
 	 * the cache uses random vs fifo for replacement
 	 **/
-	virtual bool AccessMemory(const address_t &address, const bool &read) = 0;
+	virtual AccessResult Access(const address_t &address, const bool &read) = 0;
+
+	/**
+	 * @brief place a block in the cache through the replacement policy,
+	 *ignoring the write allocate policy. A block that is already present only
+	 *has its dirty bit updated
+	 **/
+	virtual AccessResult Fill(const address_t &address, const bool &dirty) = 0;
+
+	/**
+	 * @brief remove a block from the cache
+	 * @return the removed block, or nothing if it was not present
+	 **/
+	virtual std::optional<cache_block_t> Invalidate(const address_t &address) = 0;
+
+	// true if the block holding address is in the cache, does not change state
+	virtual bool Contains(const address_t &address) const = 0;
 
 	// flush the cache by clearing each cache index
 	virtual void ClearCache() = 0;
 
+	/**
+	 * @brief write every block, its dirty bit and the replacement state of the
+	 *cache to a binary stream
+	 **/
+	virtual void SaveState(std::ostream &os) const = 0;
+
+	/**
+	 * @brief replace the contents of the cache with a state written by
+	 *SaveState of a cache with the same config
+	 * @return false if the state is truncated or does not fit the cache, the
+	 *cache is left flushed
+	 **/
+	virtual bool LoadState(std::istream &is) = 0;
+
 	inline auto get_index(address_t address) const
 	{
 		return (address >> offset_size_) & ((1 << index_size_) - 1);
 	};
+
+	// address of the first byte in the block holding address
+	inline address_t get_block_address(address_t address) const
+	{
+		return static_cast<address_t>(address >> offset_size_ << offset_size_);
+	};
 };
 
 /**
@@ -126,6 +181,33 @@ private:
 protected:
 	std::vector<CacheIndex<T>> cache_;
 
+	// current flush generation, an index stamped with an older one is empty
+	uint32_t epoch_{1};
+
+	/**
+	 * @brief the index holding address
+	 * @description an index last used before the latest flush is emptied
+	 *first
+	 **/
+	CacheIndex<T> &Index(address_t address)
+	{
+		return IndexAt(get_index(address));
+	};
+
+	CacheIndex<T> &IndexAt(size_t index)
+	{
+		auto &ci{cache_[index]};
+		if (ci.epoch != epoch_) [[unlikely]]
+		{
+			if (ci.epoch)
+				ci.clear();
+			else
+				ci.allocate();
+			ci.epoch = epoch_;
+		}
+		return ci;
+	};
+
 public:
 	Cache(CacheConf cc)
 		: CacheBase{cc},
@@ -135,18 +217,110 @@ public:
 
 	virtual ~Cache() = default;
 
+	bool Contains(const address_t &address) const override
+	{
+		const auto &ci{cache_[get_index(address)]};
+		return ci.epoch == epoch_ &&
+			   ci.map.contains(cache_block_t{address, false});
+	};
+
 	/**
-	 * @brief returns true on hit, false on miss
-	 * @description Two different instantiations for when the cache uses random
-	 *vs fifo for replacement
+	 * @brief flush the cache in O(1) by starting a new generation, each index
+	 *is emptied the next time it is used
 	 **/
-	virtual bool
-	AccessMemory(const address_t &address, const bool &read) override = 0;
-
-	// flush the cache by clearing each cache index
 	void ClearCache() override
 	{
-		for (auto &ci : cache_)
-			ci.clear();
+		// the generation wrapped around, every used index is emptied now
+		if (++epoch_ == 0)
+		{
+			epoch_ = 1;
+			for (auto &ci : cache_)
+				if (ci.epoch)
+				{
+					ci.clear();
+					ci.epoch = epoch_;
+				}
+		}
+	};
+
+	/**
+	 * @brief writes the number of indicies in use, then for each one its
+	 *number, its block count and its blocks in container order
+	 * @description The container order is the replacement state, newest first
+	 *for FIFO and way order for random replacement
+	 **/
+	void SaveState(std::ostream &os) const override
+	{
+		uint32_t used{};
+		for (const auto &ci : cache_)
+			used += ci.epoch == epoch_ && !ci.list.empty();
+		BinaryIO::Write(os, used);
+
+		for (size_t i{}; i < cache_.size(); i++)
+		{
+			const auto &ci{cache_[i]};
+			if (ci.epoch != epoch_ || ci.list.empty())
+				continue;
+
+			BinaryIO::Write(os, static_cast<uint32_t>(i));
+			BinaryIO::Write(os, static_cast<uint16_t>(ci.list.size()));
+			for (const auto &cb : ci.list)
+			{
+				BinaryIO::Write(os, cb.block_address);
+				BinaryIO::Write(os, static_cast<uint8_t>(cb.dirty));
+			}
+		}
+	};
+
+	bool LoadState(std::istream &is) override
+	{
+		ClearCache();
+		if (ReadState(is))
+			return true;
+
+		ClearCache();
+		return false;
+	};
+
+private:
+	// fill the flushed cache from a state written by SaveState
+	bool ReadState(std::istream &is)
+	{
+		uint32_t used;
+		if (!BinaryIO::Read(is, used) || used > num_indicies_)
+			return false;
+
+		for (uint32_t n{}; n < used; n++)
+		{
+			uint32_t index;
+			uint16_t blocks;
+			if (!BinaryIO::Read(is, index) || !BinaryIO::Read(is, blocks) ||
+				index >= num_indicies_ || blocks > associativity_)
+				return false;
+
+			auto &ci{IndexAt(index)};
+			for (uint16_t b{}; b < blocks; b++)
+			{
+				cache_block_t cb;
+				uint8_t dirty;
+				if (!BinaryIO::Read(is, cb.block_address) ||
+					!BinaryIO::Read(is, dirty))
+					return false;
+				cb.dirty = dirty;
+
+				// a block in the wrong index, or in its index twice, would
+				// break the search map
+				if (get_index(cb.block_address) != index ||
+					ci.map.contains(cb))
+					return false;
+
+				// the lists have room for associativity_ blocks, so pushing
+				// does not move the blocks the map points at
+				ci.list.push_back(cb);
+				ci.map.insert(std::prev(ci.list.end()));
+			}
+		}
+
+		return true;
 	};
 };
@@ -18,6 +18,18 @@ struct cache_block_t
 	bool dirty;
 };
 
+/**
+ * @brief outcome of a single access to a cache
+ * @description on a miss that allocates, victim holds the block that was pushed
+ *out of the index to make room
+ **/
+struct AccessResult
+{
+	bool hit{};
+	bool evicted{};
+	cache_block_t victim{};
+};
+
 template <typename T>
 concept CacheBlockContainer = requires(T t, size_t x) {
 	// contains cache blocks
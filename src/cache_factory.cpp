@@ -7,6 +7,7 @@
  **/
 
 #include "cache.hpp"
+#include "cache_factory.hpp"
 #include "fifo_cache.hpp"
 #include "rand_cache.hpp"
 
@@ -25,4 +26,22 @@ std::unique_ptr<CacheBase> CreateCache(const CacheConf& cc)
 	}
 	return nullptr;
 }
+
+std::unique_ptr<Prefetcher> CreatePrefetcher(const PrefetchConf& pc,
+											 uint_fast8_t offset_size)
+{
+	switch (pc.type_)
+	{
+		case NEXT_LINE:
+			return std::make_unique<NextLinePrefetcher>(pc, offset_size);
+			break;
+		case STRIDE:
+			return std::make_unique<StridePrefetcher>(pc, offset_size);
+			break;
+		case STREAM:
+			return std::make_unique<StreamPrefetcher>(pc, offset_size);
+			break;
+	}
+	return nullptr;
+}
 };	// namespace CacheFactory
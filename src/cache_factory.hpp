@@ -11,8 +11,11 @@
 #include <memory>
 
 #include "cache.hpp"
+#include "prefetcher.hpp"
 
 namespace CacheFactory
 {
 std::unique_ptr<CacheBase> CreateCache(const CacheConf &cc);
+std::unique_ptr<Prefetcher> CreatePrefetcher(const PrefetchConf &pc,
+											 uint_fast8_t offset_size);
 };
@@ -0,0 +1,271 @@
+/**
+ * filename: cache_hierarchy.cpp
+ *
+ * description: object file for a multi level cache hierarchy
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "cache_hierarchy.hpp"
+
+#include <bit>
+
+MissStream::MissStream(CacheConf first_level_conf)
+	: offset_size_{static_cast<uint_fast8_t>(
+		  std::bit_width(first_level_conf.line_size_) - 1)},
+	  first_level_conf_{first_level_conf}
+{}
+
+void MissStream::Push(RequestType type, address_t address)
+{
+	const auto block{static_cast<address_t>(address >> offset_size_)};
+	const auto delta{static_cast<uint32_t>(block - last_block_)};
+	// zigzag the delta so small negative strides stay small
+	const uint32_t zigzag{(delta << 1) ^ (0u - (delta >> 31))};
+
+	uint64_t v{static_cast<uint64_t>(zigzag) << 2 | type};
+	do
+	{
+		auto byte{static_cast<uint8_t>(v & 0x7f)};
+		v >>= 7;
+		if (v)
+			byte |= 0x80;
+		buffer_.push_back(byte);
+	} while (v);
+
+	last_block_ = block;
+	size_++;
+}
+
+CacheHierarchy::CacheHierarchy(std::vector<CacheConf> confs,
+							   InclusionPolicy policy)
+	: confs_{std::move(confs)},
+	  stats_(confs_.size()),
+	  inclusion_policy_{policy}
+{
+	for (const auto &cc : confs_)
+		levels_.push_back(CacheFactory::CreateCache(cc));
+}
+
+void CacheHierarchy::ClearCache()
+{
+	for (auto &level : levels_)
+		level->ClearCache();
+}
+
+HierarchyResults CacheHierarchy::SimulateTrace(const StackTrace &st)
+{
+	stats_.assign(levels_.size(), {});
+
+	for (auto &ma : st)
+	{
+		stats_[0].counts.instructions += ma.last_memory_access_count + 1;
+		Request(0, ma.is_read ? READ_REQUEST : WRITE_REQUEST, ma.address);
+	}
+
+	return CollectResults();
+}
+
+MissStream CacheHierarchy::RecordMissStream(const StackTrace &st)
+{
+	MissStream ms{confs_[0]};
+	stats_.assign(levels_.size(), {});
+
+	recording_ = &ms;
+	for (auto &ma : st)
+	{
+		stats_[0].counts.instructions += ma.last_memory_access_count + 1;
+		Request(0, ma.is_read ? READ_REQUEST : WRITE_REQUEST, ma.address);
+	}
+	recording_ = nullptr;
+
+	ms.first_level_counts_ = stats_[0].counts;
+	return ms;
+}
+
+HierarchyResults CacheHierarchy::SimulateMissStream(const MissStream &ms)
+{
+	stats_.assign(levels_.size(), {});
+	stats_[0].counts = ms.first_level_counts_;
+
+	replaying_ = true;
+	ms.ForEach([this](RequestType type, address_t address)
+			   { Request(1, type, address); });
+	replaying_ = false;
+
+	return CollectResults();
+}
+
+void CacheHierarchy::Request(size_t level, RequestType type, address_t address)
+{
+	if (recording_ && level == 1)
+	{
+		recording_->Push(type, address);
+		return;
+	}
+
+	// past the last level is main memory
+	if (level == levels_.size())
+		return;
+
+	auto &cache{*levels_[level]};
+	auto &stats{stats_[level]};
+
+	switch (type)
+	{
+		case READ_REQUEST:
+		case WRITE_REQUEST:
+		{
+			const bool is_read{type == READ_REQUEST};
+			if (is_read)
+				stats.counts.reads++;
+			else
+				stats.counts.writes++;
+
+			// a write only gets past the level above when that level does not
+			// allocate it, so the block stays where it is
+			if (inclusion_policy_ == EXCLUSIVE && level > 0 && !is_read)
+			{
+				if (!cache.Contains(address))
+				{
+					stats.counts.write_misses++;
+					Request(level + 1, WRITE_REQUEST, address);
+				}
+				else
+				{
+					// a write-back hit leaves the block dirty, a write-through
+					// one passes the write on
+					cache.Access(address, false);
+					if (!cache.is_write_allocate_)
+						Request(level + 1, WRITE_REQUEST, address);
+				}
+				return;
+			}
+
+			// the lower levels of an exclusive hierarchy only hold victims, a
+			// read hit moves the block back up
+			if (inclusion_policy_ == EXCLUSIVE && level > 0)
+			{
+				if (const auto cb{cache.Invalidate(address)})
+				{
+					// the block moves up clean so the levels above never
+					// depend on the state of the levels below
+					if (cb->dirty)
+						Request(level + 1,
+								WRITEBACK_REQUEST,
+								cache.get_block_address(address));
+					return;
+				}
+				stats.counts.read_misses++;
+				Request(level + 1, READ_REQUEST, address);
+				return;
+			}
+
+			const auto ar{cache.Access(address, is_read)};
+			if (ar.evicted)
+				Evict(level, ar.victim);
+
+			if (!ar.hit)
+			{
+				if (is_read)
+					stats.counts.read_misses++;
+				else
+					stats.counts.write_misses++;
+				// a write-allocate cache fetches the block on a write miss
+				Request(level + 1,
+						is_read || cache.is_write_allocate_ ? READ_REQUEST
+															: WRITE_REQUEST,
+						address);
+			}
+			// write-through
+			else if (!is_read && !cache.is_write_allocate_)
+				Request(level + 1, WRITE_REQUEST, address);
+			return;
+		}
+		case WRITEBACK_REQUEST:
+		case EVICT_REQUEST:
+		{
+			if (type == WRITEBACK_REQUEST)
+				stats.writebacks++;
+
+			if (inclusion_policy_ != EXCLUSIVE)
+			{
+				// clean victims only matter to exclusive hierarchies
+				if (type == EVICT_REQUEST)
+					return;
+				if (!cache.is_write_allocate_)
+				{
+					Request(level + 1, WRITEBACK_REQUEST, address);
+					return;
+				}
+			}
+
+			const auto ar{cache.Fill(address, type == WRITEBACK_REQUEST)};
+			if (ar.evicted)
+				Evict(level, ar.victim);
+			return;
+		}
+	}
+}
+
+void CacheHierarchy::Evict(size_t level, cache_block_t victim)
+{
+	const auto block{levels_[level]->get_block_address(victim.block_address)};
+	bool dirty{victim.dirty};
+
+	if (inclusion_policy_ == INCLUSIVE)
+	{
+		// remove every upper level block covered by the victim, a dirty copy
+		// above makes the write-back dirty
+		for (size_t upper{replaying_ ? 1u : 0u}; upper < level; ++upper)
+			for (address_t offset{}; offset < confs_[level].line_size_;
+				 offset += confs_[upper].line_size_)
+				if (const auto cb{levels_[upper]->Invalidate(block + offset)})
+				{
+					dirty |= cb->dirty;
+					stats_[level].back_invalidations++;
+				}
+	}
+
+	if (inclusion_policy_ == EXCLUSIVE)
+		Request(level + 1, dirty ? WRITEBACK_REQUEST : EVICT_REQUEST, block);
+	else if (dirty)
+		Request(level + 1, WRITEBACK_REQUEST, block);
+	// keep clean victims in the stream so exclusive candidates can replay it
+	else if (recording_ && level == 0)
+		Request(level + 1, EVICT_REQUEST, block);
+}
+
+HierarchyResults CacheHierarchy::CollectResults()
+{
+	HierarchyResults hr;
+
+	const auto &first{stats_.front().counts};
+	const auto &last{stats_.back().counts};
+	const auto ac{static_cast<double>(first.reads + first.writes)};
+
+	uint64_t run_time{first.instructions};
+	double amat{1};
+	for (size_t i{}; i < stats_.size(); ++i)
+	{
+		const auto misses{stats_[i].counts.read_misses +
+						  stats_[i].counts.write_misses};
+		stats_[i].results =
+			stats_[i].counts.ToResults(confs_[i].miss_penalty_);
+		run_time += misses * confs_[i].miss_penalty_;
+		amat += static_cast<double>(misses) / ac * confs_[i].miss_penalty_;
+		hr.levels.push_back(stats_[i]);
+	}
+
+	hr.combined = {
+		.total_hit_rate =
+			1.0f - static_cast<double>(last.read_misses + last.write_misses) / ac,
+		.read_hit_rate = 1.0f - static_cast<double>(last.read_misses) /
+									static_cast<double>(first.reads),
+		.write_hit_rate = 1.0f - static_cast<double>(last.write_misses) /
+									 static_cast<double>(first.writes),
+		.run_time = run_time,
+		.average_memory_access_time = amat};
+
+	return hr;
+}
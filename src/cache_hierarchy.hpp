@@ -0,0 +1,181 @@
+/**
+ * filename: cache_hierarchy.hpp
+ *
+ * description: header file for a multi level cache hierarchy
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "base_structs.hpp"
+#include "cache_factory.hpp"
+
+/**
+ * @brief the kinds of requests one level sends to the level below it
+ **/
+enum RequestType : uint8_t
+{
+	READ_REQUEST,
+	WRITE_REQUEST,
+	// dirty victim of the level above
+	WRITEBACK_REQUEST,
+	// clean victim of the level above, only used by exclusive hierarchies
+	EVICT_REQUEST
+};
+
+/**
+ * @brief the requests that leave the first level of a hierarchy
+ * @description Recorded once and replayed into any number of lower level
+ *candidates that share the same first level. Each request is stored as a
+ *zigzag varint of the block number delta to the previous request, with the
+ *request type in the low two bits, so strided miss streams take one or two
+ *bytes per request instead of a full MemoryAccess.
+ **/
+class MissStream
+{
+private:
+	std::vector<uint8_t> buffer_;
+	uint64_t size_{};
+	address_t last_block_{};
+	uint_fast8_t offset_size_;
+	CacheConf first_level_conf_;
+	AccessCounts first_level_counts_{};
+
+	friend class CacheHierarchy;
+
+public:
+	MissStream(CacheConf first_level_conf);
+
+	void Push(RequestType type, address_t address);
+
+	/**
+	 * @brief decode the stream in order, calling f(RequestType, address_t)
+	 *for every request
+	 **/
+	template <typename F>
+	void ForEach(F &&f) const
+	{
+		address_t block{};
+		for (size_t i{}; i < buffer_.size();)
+		{
+			uint64_t v{};
+			for (uint_fast8_t shift{};; shift += 7)
+			{
+				const uint8_t byte{buffer_[i++]};
+				v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+				if (!(byte & 0x80))
+					break;
+			}
+			const auto type{static_cast<RequestType>(v & 0b11)};
+			const auto zigzag{static_cast<uint32_t>(v >> 2)};
+			block += (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+			f(type, static_cast<address_t>(block << offset_size_));
+		}
+	}
+
+	// number of requests in the stream
+	uint64_t size() const
+	{
+		return size_;
+	};
+
+	// encoded size of the stream in bytes
+	size_t bytes() const
+	{
+		return buffer_.size();
+	};
+
+	CacheConf get_first_level_config() const
+	{
+		return first_level_conf_;
+	};
+};
+
+struct LevelResults
+{
+	// demand accesses that reached this level. The run time of a lower level
+	// only counts the stall cycles spent on its misses
+	Results results;
+	AccessCounts counts;
+	// dirty blocks written back into this level from the level above
+	uint64_t writebacks;
+	// blocks removed from the levels above to keep the hierarchy inclusive
+	uint64_t back_invalidations;
+};
+
+struct HierarchyResults
+{
+	std::vector<LevelResults> levels;
+	/**
+	 * hit rates are the fraction of accesses served without going to memory,
+	 * run time and AMAT include the miss penalty of every level
+	 **/
+	Results combined;
+};
+
+/**
+ * @brief a chain of caches, the first config is the level closest to the cpu
+ * @description misses and write-backs are forwarded down the chain. Each
+ *level's miss penalty is the extra cycles taken by an access that misses it.
+ *Exclusive hierarchies expect every level to have the same line size.
+ **/
+class CacheHierarchy
+{
+private:
+	std::vector<std::unique_ptr<CacheBase>> levels_;
+	std::vector<CacheConf> confs_;
+	std::vector<LevelResults> stats_;
+	const InclusionPolicy inclusion_policy_;
+
+	// when set, requests leaving the first level are recorded instead of
+	// being simulated
+	MissStream *recording_{};
+	// when set, the first level is not simulated, its requests come from a
+	// miss stream
+	bool replaying_{};
+
+	void Request(size_t level, RequestType type, address_t address);
+	void Evict(size_t level, cache_block_t victim);
+	HierarchyResults CollectResults();
+
+public:
+	CacheHierarchy(std::vector<CacheConf> confs, InclusionPolicy policy);
+
+	/**
+	 * @brief run the trace through every level of the hierarchy
+	 **/
+	HierarchyResults SimulateTrace(const StackTrace &st);
+
+	/**
+	 * @brief run the trace through the first level only, recording the
+	 *requests it sends to the levels below
+	 **/
+	MissStream RecordMissStream(const StackTrace &st);
+
+	/**
+	 * @brief replay a recorded first level miss stream into the lower levels
+	 * @description The stream must have been recorded with the same first
+	 *level config. Results are exact for exclusive and non-inclusive
+	 *hierarchies, inclusive hierarchies do not back-invalidate the first level
+	 *when replaying.
+	 **/
+	HierarchyResults SimulateMissStream(const MissStream &ms);
+
+	std::vector<CacheConf> get_cache_configs() const
+	{
+		return confs_;
+	};
+
+	InclusionPolicy get_inclusion_policy() const
+	{
+		return inclusion_policy_;
+	};
+
+	// flush every level
+	void ClearCache();
+};
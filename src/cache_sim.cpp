@@ -9,45 +9,445 @@
 
 #include "cache_sim.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
+#include <limits>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "binary_io.hpp"
+
+namespace
+{
+// "CSCK" read as a little endian word
+constexpr uint32_t kCheckpointMagic{0x4b435343};
+constexpr uint16_t kCheckpointVersion{1};
+
+// the part of the config a snapshot depends on, laid out without padding so it
+// can be written as is
+struct CheckpointHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint8_t line_size;
+	uint8_t associativity;
+	address_t cache_size;
+	uint8_t replacement_policy;
+	uint8_t write_allocate;
+	uint8_t has_tlb;
+	uint8_t reserved;
+
+	bool operator==(const CheckpointHeader&) const = default;
+};
+
+CheckpointHeader Header(const CacheConf& cc, bool has_tlb)
+{
+	return {kCheckpointMagic,
+			kCheckpointVersion,
+			static_cast<uint8_t>(cc.line_size_),
+			static_cast<uint8_t>(cc.associativity_),
+			cc.cache_size_,
+			static_cast<uint8_t>(cc.replacement_policy_),
+			cc.write_allocate_,
+			has_tlb,
+			0};
+}
+}  // namespace
+
+void CacheSimulator::ResetComponents()
+{
+	if (prefetch_)
+		prefetch_->ResetStats();
+	if (timing_)
+		timing_->Reset();
+	if (tlb_)
+		tlb_->ResetStats();
+	if (victim_)
+		victim_->ResetStats();
+	if (write_buffer_)
+		write_buffer_->ResetStats();
+}
+
+void CacheSimulator::Step(const MemoryAccess& ma, AccessCounts& counts)
+{
+	if (ma.is_read)
+		counts.reads++;
+	else
+		counts.writes++;
+	counts.instructions += ma.last_memory_access_count + 1;
+
+	if (tlb_)
+		tlb_->Translate(ma.address);
+
+	bool hit;
+	if (prefetch_)
+	{
+		hit = prefetch_->AccessMemory(
+			ma.address, ma.is_read, counts.instructions);
+		if (events_)
+			events_->Record({.hit = hit});
+	}
+	else
+	{
+		const auto ar{cache_->Access(ma.address, ma.is_read)};
+		hit = ar.hit;
+		if (!hit && victim_)
+			hit = VictimAccess(ma, ar, counts.instructions);
+		// a block swapped back from the victim cache is recorded as a hit
+		if (events_)
+			events_->Record(hit == ar.hit ? ar : AccessResult{.hit = true});
+		if (write_buffer_)
+			BufferWrites(ma, ar, counts.instructions);
+	}
+
+	if (timing_)
+		timing_->Access(ma.last_memory_access_count,
+						cache_->get_block_address(ma.address),
+						hit,
+						ma.is_read);
+
+	// if miss
+	if (!hit)
+	{
+		if (ma.is_read)
+			counts.read_misses++;
+		else
+			counts.write_misses++;
+	}
+}
+
+bool CacheSimulator::VictimAccess(const MemoryAccess& ma,
+								  const AccessResult& ar,
+								  uint64_t now)
+{
+	// a write miss of a no-write allocate cache leaves the block where it is
+	const bool allocated{ma.is_read || cache_->is_write_allocate_};
+	const auto dirty{
+		victim_->Probe(cache_->get_block_address(ma.address), allocated)};
+
+	// the block the cache evicted takes the place of the one swapped back
+	if (ar.evicted)
+	{
+		const auto out{victim_->Insert(
+			{.block_address = cache_->get_block_address(ar.victim.block_address),
+			 .dirty = ar.victim.dirty})};
+		if (out.has_value() && out->dirty && write_buffer_)
+			write_buffer_->Write(out->block_address, now);
+	}
+
+	if (!dirty.has_value())
+		return false;
+	if (allocated && dirty.value())
+		cache_->Fill(ma.address, true);
+	return true;
+}
+
+void CacheSimulator::BufferWrites(const MemoryAccess& ma,
+								  const AccessResult& ar,
+								  uint64_t now)
+{
+	// a write-through cache writes every store, a write-back cache the dirty
+	// blocks it evicts. With a victim cache those are written as they leave it
+	if (!cache_->is_write_allocate_)
+	{
+		if (!ma.is_read)
+			write_buffer_->Write(cache_->get_block_address(ma.address), now);
+	}
+	else if (ar.evicted && ar.victim.dirty && !victim_)
+		write_buffer_->Write(cache_->get_block_address(ar.victim.block_address),
+							 now);
+}
+
+Results CacheSimulator::CollectResults(const AccessCounts& counts,
+									   double cycle_scale) const
+{
+	auto res{counts.ToResults(cache_conf_.miss_penalty_)};
+	// cycles a component adds to every access of the trace
+	const auto add_cycles{
+		[&](uint64_t cycles)
+		{
+			const auto scaled{static_cast<uint64_t>(
+				static_cast<double>(cycles) * cycle_scale)};
+			res.run_time += scaled;
+			res.average_memory_access_time +=
+				static_cast<double>(scaled) /
+				static_cast<double>(counts.reads + counts.writes);
+		}};
+	if (prefetch_)
+		res.prefetch = prefetch_->get_stats();
+	if (timing_)
+		res.timing = timing_->get_stats();
+	if (tlb_)
+	{
+		res.tlb = tlb_->get_stats();
+		add_cycles(res.tlb->walk_cycles);
+	}
+	if (victim_)
+	{
+		res.victim = victim_->get_stats();
+		add_cycles(res.victim->swap_cycles);
+	}
+	if (write_buffer_)
+	{
+		res.write_buffer = write_buffer_->get_stats();
+		add_cycles(res.write_buffer->stall_cycles);
+	}
+
+	return res;
+}
 
 Results CacheSimulator::SimulateTrace(const StackTrace& st)
 {
-	// memory access count
-	const auto ac{st.size()};
+	counts_ = {};
 
-	uint64_t rc{};	// read count
-	uint64_t wc{};	// write count
-	uint64_t ic{};	// instruction count
-	uint64_t rm{};	// read misses
-	uint64_t wm{};	// write misses
+	ResetComponents();
 
-	for (auto& ma : st)
+	// progress is published in chunks so the loop stays free of atomics
+	for (size_t first{}; first < st.size(); first += kProgressChunk)
 	{
+		const auto last{std::min(st.size(), first + kProgressChunk)};
+		for (size_t i{first}; i < last; ++i)
+			Step(st[i], counts_);
+		if (progress_)
+			progress_->fetch_add(last - first, std::memory_order_relaxed);
+	}
+
+	return CollectResults(counts_);
+}
+
+Results CacheSimulator::SampleTrace(const StackTrace& st,
+									const SamplingConf& sc)
+{
+	const uint64_t total{st.size()};
+	const uint64_t intervals{sc.intervals_};
+	const uint64_t length{sc.interval_length_};
+
+	// the samples would cover the whole trace, simulate it exactly
+	if (intervals == 0 || length == 0 || intervals * length >= total)
+	{
+		auto res{SimulateTrace(st)};
+		res.sampling = SamplingStats{.intervals = 1,
+									 .sampled_accesses = total,
+									 .warmed_accesses = 0,
+									 .total_accesses = total,
+									 .total_hit_rate_error = 0,
+									 .run_time_error = 0,
+									 .average_memory_access_time_error = 0};
+		return res;
+	}
+
+	// the access and instruction counts of the whole trace are exact, only
+	// the misses are estimated
+	AccessCounts exact{};
+	for (const auto& ma : st)
+	{
+		if (ma.is_read)
+			exact.reads++;
+		else
+			exact.writes++;
+		exact.instructions += ma.last_memory_access_count + 1;
+	}
+
+	ResetComponents();
+
+	std::mt19937 gen{sc.seed_};
+	const uint64_t part{total / intervals};
+	AccessCounts sampled{};
+	// miss ratio of each interval
+	std::vector<double> miss_ratios;
+	miss_ratios.reserve(intervals);
+	uint64_t warmed_to{};
+	uint64_t warmed{};
+	// a few passes over the cache are enough to fill it with the blocks the
+	// interval will find there
+	const uint64_t warming_length{sc.warming_length_.value_or(
+		kWarmingPasses * (cache_conf_.cache_size_ / cache_conf_.line_size_))};
+
+	for (uint64_t i{}; i < intervals; ++i)
+	{
+		uint64_t start{i * part + part - length};
+		if (sc.policy_ == RANDOM)
+			start = i * part + std::uniform_int_distribution<uint64_t>{
+								   0, part - length}(gen);
+
+		// functional warming only keeps the tags up to date
+		const uint64_t warm_from{std::max(
+			warmed_to, start - std::min<uint64_t>(start, warming_length))};
+		warmed += start - warm_from;
+		for (auto j{warm_from}; j < start; ++j)
+		{
+			if (tlb_)
+				tlb_->Warm(st[j].address);
+			cache_->AccessMemory(st[j].address, st[j].is_read);
+		}
+
+		const AccessCounts before{sampled};
+		for (auto j{start}; j < start + length; ++j)
+			Step(st[j], sampled);
+		warmed_to = start + length;
+
+		miss_ratios.push_back(
+			static_cast<double>(sampled.read_misses + sampled.write_misses -
+								before.read_misses - before.write_misses) /
+			static_cast<double>(length));
+	}
+
+	// scale the misses of the samples up to the whole trace
+	AccessCounts estimate{exact};
+	if (sampled.reads)
+		estimate.read_misses = static_cast<uint64_t>(
+			std::llround(static_cast<double>(sampled.read_misses) *
+						 static_cast<double>(exact.reads) /
+						 static_cast<double>(sampled.reads)));
+	if (sampled.writes)
+		estimate.write_misses = static_cast<uint64_t>(
+			std::llround(static_cast<double>(sampled.write_misses) *
+						 static_cast<double>(exact.writes) /
+						 static_cast<double>(sampled.writes)));
+
+	const double sampled_accesses{static_cast<double>(intervals * length)};
+	auto res{CollectResults(estimate,
+							static_cast<double>(total) / sampled_accesses)};
+
+	// standard error of the mean miss ratio over the intervals, with the
+	// finite population correction for the part of the trace sampled
+	double mean{};
+	for (const auto r : miss_ratios)
+		mean += r;
+	mean /= static_cast<double>(intervals);
+	double variance{};
+	for (const auto r : miss_ratios)
+		variance += (r - mean) * (r - mean);
+
+	double miss_ratio_error{std::numeric_limits<double>::infinity()};
+	if (intervals > 1)
+		miss_ratio_error =
+			1.96 *
+			std::sqrt(variance / static_cast<double>(intervals - 1) /
+					  static_cast<double>(intervals) *
+					  (1 - sampled_accesses / static_cast<double>(total)));
+
+	res.sampling = SamplingStats{
+		.intervals = static_cast<uint32_t>(intervals),
+		.sampled_accesses = intervals * length,
+		.warmed_accesses = warmed,
+		.total_accesses = total,
+		.total_hit_rate_error = miss_ratio_error,
+		.run_time_error = miss_ratio_error * static_cast<double>(total) *
+						  static_cast<double>(cache_conf_.miss_penalty_),
+		.average_memory_access_time_error =
+			miss_ratio_error * static_cast<double>(cache_conf_.miss_penalty_)};
+
+	return res;
+}
+
+Results CacheSimulator::SimulateSetSample(const SetSampleFilter& filter)
+{
+	AccessCounts sampled{};
+	// accesses and misses of each sampled set
+	std::unordered_map<address_t, std::pair<uint64_t, uint64_t>> sets;
+	sets.reserve(filter.get_sampled_sets());
+
+	for (const auto& ma : filter.get_accesses())
+	{
+		const bool hit{cache_->AccessMemory(ma.address, ma.is_read)};
+		auto& set{sets[cache_->get_index(ma.address)]};
+		set.first++;
+
 		if (ma.is_read)
-			rc++;
+			sampled.reads++;
 		else
-			wc++;
-		ic += ma.last_memory_access_count + 1;
+			sampled.writes++;
 
-		// if miss
-		if (!cache_->AccessMemory(ma.address, ma.is_read))
+		if (!hit)
 		{
+			set.second++;
 			if (ma.is_read)
-				rm++;
+				sampled.read_misses++;
 			else
-				wm++;
+				sampled.write_misses++;
 		}
 	}
 
-	return {.total_hit_rate =
-				1.0f - static_cast<double>(rm + wm) / static_cast<double>(ac),
-			.read_hit_rate =
-				1.0f - static_cast<double>(rm) / static_cast<double>(rc),
-			.write_hit_rate =
-				1.0f - static_cast<double>(wm) / static_cast<double>(wc),
-			.run_time = ic + (rm + wm) * cache_conf_.miss_penalty_,
-			.average_memory_access_time =
-				1 + (static_cast<double>(rm + wm) / static_cast<double>(ac)) *
-						cache_conf_.miss_penalty_};
+	const auto& totals{filter.get_totals()};
+	AccessCounts estimate{totals};
+	if (sampled.reads)
+		estimate.read_misses = static_cast<uint64_t>(
+			std::llround(static_cast<double>(sampled.read_misses) *
+						 static_cast<double>(totals.reads) /
+						 static_cast<double>(sampled.reads)));
+	if (sampled.writes)
+		estimate.write_misses = static_cast<uint64_t>(
+			std::llround(static_cast<double>(sampled.write_misses) *
+						 static_cast<double>(totals.writes) /
+						 static_cast<double>(sampled.writes)));
+
+	auto res{estimate.ToResults(cache_conf_.miss_penalty_)};
+
+	// every set is a cluster of accesses, so the error of the miss ratio is
+	// that of a ratio estimator over the sampled sets. Sets that were never
+	// accessed add nothing to either sum
+	const double n{static_cast<double>(filter.get_sampled_sets())};
+	const double f{n / static_cast<double>(filter.get_total_sets())};
+	const double accesses{static_cast<double>(sampled.reads + sampled.writes)};
+	const double ratio{
+		accesses ? static_cast<double>(sampled.read_misses +
+									   sampled.write_misses) /
+					   accesses
+				 : 0};
+	double residuals{};
+	for (const auto& [index, set] : sets)
+	{
+		const double r{static_cast<double>(set.second) -
+					   ratio * static_cast<double>(set.first)};
+		residuals += r * r;
+	}
+
+	double error{0};
+	if (f < 1)
+		error = n > 1 && accesses
+					? 1.96 * n / accesses *
+						  std::sqrt((1 - f) * residuals / (n * (n - 1)))
+					: std::numeric_limits<double>::infinity();
+
+	res.set_sampling = SetSamplingStats{
+		.sampled_sets = filter.get_sampled_sets(),
+		.total_sets = filter.get_total_sets(),
+		.sampling_ratio = f,
+		.sampled_accesses = sampled.reads + sampled.writes,
+		.total_accesses = totals.reads + totals.writes,
+		.total_hit_rate_error = error};
+
+	return res;
+}
+
+void CacheSimulator::SaveCheckpoint(std::ostream& os) const
+{
+	BinaryIO::Write(os, Header(cache_conf_, tlb_ != nullptr));
+	cache_->SaveState(os);
+	if (tlb_)
+		tlb_->SaveState(os);
+}
+
+bool CacheSimulator::LoadCheckpoint(std::istream& is)
+{
+	// the prefetcher, victim cache and write buffer are not part of the
+	// snapshot
+	if (prefetch_)
+		prefetch_->Clear();
+	if (victim_)
+		victim_->Clear();
+	if (write_buffer_)
+		write_buffer_->Clear();
+
+	CheckpointHeader header;
+	if (BinaryIO::Read(is, header) &&
+		header == Header(cache_conf_, tlb_ != nullptr) &&
+		cache_->LoadState(is) && (!tlb_ || tlb_->LoadState(is)))
+		return true;
+
+	ClearCache();
+	return false;
 }
@@ -9,11 +9,25 @@
 #pragma once
 
 #include <boost/circular_buffer.hpp>
+#include <atomic>
 #include <boost/concept_check.hpp>
+#include <concepts>
+#include <istream>
+#include <ostream>
+#include <ranges>
+#include <span>
+#include <type_traits>
 #include <utility>
 
 #include "base_structs.hpp"
 #include "cache_factory.hpp"
+#include "event_stream.hpp"
+#include "prefetcher.hpp"
+#include "set_sampling.hpp"
+#include "timing_model.hpp"
+#include "tlb.hpp"
+#include "victim_cache.hpp"
+#include "write_buffer.hpp"
 
 /**
  * @brief cache simulator
@@ -24,9 +38,54 @@ class CacheSimulator
 private:
 	std::unique_ptr<CacheBase> cache_;
 	CacheConf cache_conf_;
+	// optional prefetcher in front of the cache
+	std::unique_ptr<PrefetchStage> prefetch_;
+	// optional non-blocking timing model
+	std::unique_ptr<MshrTimingModel> timing_;
+	// optional TLB beside the cache
+	std::unique_ptr<Tlb> tlb_;
+	// optional victim cache behind the cache
+	std::unique_ptr<VictimCache> victim_;
+	// optional write buffer between the cache and memory
+	std::unique_ptr<WriteBuffer> write_buffer_;
+	// optional record of every access outcome, not owned
+	EventStreamWriter* events_{nullptr};
+	// optional count of simulated accesses for progress reports, not owned
+	std::atomic<uint64_t>* progress_{nullptr};
+	// counts of the last SimulateTrace
+	AccessCounts counts_{};
+	// accesses simulated between progress updates
+	static constexpr size_t kProgressChunk{1 << 16};
 	// internal storage for the stack trace if needed
 
+	// reset the statistics of the attached components
+	void ResetComponents();
+
+	// simulate one access in detail
+	void Step(const MemoryAccess& ma, AccessCounts& counts);
+
+	// pass a cache miss to the victim cache, true if it hit there
+	bool VictimAccess(const MemoryAccess& ma,
+					  const AccessResult& ar,
+					  uint64_t now);
+
+	// pass the writes an access sends to memory to the write buffer
+	void BufferWrites(const MemoryAccess& ma,
+					  const AccessResult& ar,
+					  uint64_t now);
+
+	// results of counts and the component statistics, cycle_scale scales the
+	// cycles the components add in a sampled run up to the whole trace
+	Results CollectResults(const AccessCounts& counts,
+						   double cycle_scale = 1) const;
+
 public:
+	// bumped whenever a change to the simulator changes the results it gives
+	static constexpr uint32_t kVersion{1};
+	// passes over the blocks of the cache that warm it before each sampled
+	// interval, unless the SamplingConf sets its own warming length
+	static constexpr uint32_t kWarmingPasses{8};
+
 	CacheSimulator(CacheConf cache_conf)
 		: cache_{CacheFactory::CreateCache(cache_conf)}, cache_conf_{cache_conf}
 	{}
@@ -44,16 +103,222 @@ public:
 	 **/
 	Results SimulateTrace(const StackTrace& st);
 
+	/**
+	 * @brief simulate the accesses of a range, e.g. a trace piped through
+	 *TraceStages, without storing them
+	 **/
+	template <std::ranges::input_range R>
+		requires(!std::same_as<std::remove_cvref_t<R>, StackTrace> &&
+				 std::convertible_to<std::ranges::range_reference_t<R>,
+									 const MemoryAccess&>)
+	Results SimulateTrace(R&& accesses)
+	{
+		counts_ = {};
+
+		ResetComponents();
+
+		size_t unreported{};
+		for (const MemoryAccess& ma : accesses)
+		{
+			Step(ma, counts_);
+			if (progress_ && ++unreported == kProgressChunk)
+			{
+				progress_->fetch_add(unreported, std::memory_order_relaxed);
+				unreported = 0;
+			}
+		}
+		if (progress_)
+			progress_->fetch_add(unreported, std::memory_order_relaxed);
+
+		return CollectResults(counts_);
+	}
+
+	/**
+	 * @brief simulate accesses as they arrive instead of from a stored trace
+	 * @param next returns the next accesses each time it is called, empty
+	 *once there are no more
+	 **/
+	template <typename Source>
+		requires std::convertible_to<std::invoke_result_t<Source&>,
+									 std::span<const MemoryAccess>>
+	Results SimulateStream(Source&& next)
+	{
+		counts_ = {};
+
+		ResetComponents();
+
+		for (std::span<const MemoryAccess> batch{next()}; !batch.empty();
+			 batch = next())
+		{
+			for (auto& ma : batch)
+				Step(ma, counts_);
+			if (progress_)
+				progress_->fetch_add(batch.size(), std::memory_order_relaxed);
+		}
+
+		return CollectResults(counts_);
+	}
+
+	/**
+	 * @brief estimate the results of SimulateTrace from a few intervals of the
+	 *trace, reported in Results::sampling with their error bounds
+	 * @description Only the intervals are simulated in detail. A window of
+	 *accesses before each interval only updates the cache and TLB tags, the
+	 *rest are skipped. The misses of the intervals are scaled up to the access counts
+	 *of the whole trace. Component statistics cover the intervals only
+	 **/
+	Results SampleTrace(const StackTrace& st, const SamplingConf& sc);
+
+	/**
+	 * @brief estimate the results of SimulateTrace from the sampled sets of a
+	 *filter built for this cache's index bits, reported in
+	 *Results::set_sampling
+	 * @description Only the cache is simulated, the prefetcher, timing model
+	 *and TLB see the whole trace so they are left out. The miss ratio of the
+	 *sampled sets is scaled up to the access counts of the whole trace
+	 **/
+	Results SimulateSetSample(const SetSampleFilter& filter);
+
 	CacheConf get_cache_config() const
 	{
 		return cache_conf_;
 	};
 
+	/**
+	 * @brief the raw counts behind the results of the last SimulateTrace,
+	 *they do not depend on the miss penalty
+	 **/
+	const AccessCounts& get_counts() const
+	{
+		return counts_;
+	};
+
+	// true if a prefetcher, timing model, TLB, victim cache or write buffer
+	// is attached
+	bool has_components() const
+	{
+		return prefetch_ || timing_ || tlb_ || victim_ || write_buffer_;
+	};
+
+	/**
+	 * @brief change the miss penalty, the cache itself does not depend on it.
+	 *Attach components after changing it
+	 **/
+	void set_miss_penalty(uint_fast8_t miss_penalty)
+	{
+		cache_conf_.miss_penalty_ = miss_penalty;
+	};
+
+	/**
+	 * @brief put a prefetcher in front of the cache, its statistics are
+	 *reported in Results::prefetch
+	 **/
+	void set_prefetcher(const PrefetchConf& pc)
+	{
+		prefetch_ = std::make_unique<PrefetchStage>(
+			*cache_,
+			CacheFactory::CreatePrefetcher(pc, cache_->offset_size_),
+			cache_conf_.miss_penalty_);
+	};
+
+	/**
+	 * @brief time the cache as a non-blocking cache with num_mshrs miss status
+	 *holding registers, reported in Results::timing
+	 **/
+	void set_timing_model(uint_fast8_t num_mshrs)
+	{
+		timing_ = std::make_unique<MshrTimingModel>(
+			num_mshrs, cache_conf_.miss_penalty_, cache_conf_.write_allocate_);
+	};
+
+	/**
+	 * @brief translate every access with a TLB beside the cache, reported in
+	 *Results::tlb. Page walk cycles are added to the run time
+	 **/
+	void set_tlb(const TlbConf& tc)
+	{
+		tlb_ = std::make_unique<Tlb>(tc);
+	};
+
+	/**
+	 * @brief put a victim cache behind the cache, reported in
+	 *Results::victim. Its hits are not counted as misses, the swap cycles are
+	 *added to the run time. Not used behind a prefetcher
+	 **/
+	void set_victim_cache(const VictimCacheConf& vc)
+	{
+		victim_ = std::make_unique<VictimCache>(vc);
+	};
+
+	/**
+	 * @brief put a coalescing write buffer between the cache and memory,
+	 *reported in Results::write_buffer. The cycles spent waiting for a free
+	 *entry are added to the run time. Not used behind a prefetcher
+	 **/
+	void set_write_buffer(const WriteBufferConf& wc)
+	{
+		write_buffer_ = std::make_unique<WriteBuffer>(wc);
+	};
+
+	/**
+	 * @brief record the outcome of every simulated access to events, which
+	 *must outlive the simulation. nullptr stops recording. Victims are not
+	 *known behind a prefetcher and are recorded as no eviction
+	 **/
+	void set_event_stream(EventStreamWriter* events)
+	{
+		events_ = events;
+	};
+
+	/**
+	 * @brief add the accesses SimulateTrace and SimulateStream have simulated
+	 *to progress every few thousand accesses, nullptr stops counting
+	 **/
+	void set_progress(std::atomic<uint64_t>* progress)
+	{
+		progress_ = progress;
+	};
+
+	// remove the prefetcher, timing model, TLB, victim cache and write buffer
+	void ClearComponents()
+	{
+		prefetch_.reset();
+		timing_.reset();
+		tlb_.reset();
+		victim_.reset();
+		write_buffer_.reset();
+	};
+
+	/**
+	 * @brief write a snapshot of the cache to a binary stream, so a warmed up
+	 *cache can be restored before simulating other traces
+	 * @description Holds the cache config, every block with its dirty bit, the
+	 *replacement state and the TLB translations when there is a TLB. The
+	 *prefetcher, timing model, victim cache and write buffer are not saved,
+	 *they start cold after a load
+	 **/
+	void SaveCheckpoint(std::ostream& os) const;
+
+	/**
+	 * @brief restore a snapshot written by SaveCheckpoint
+	 * @return false if the snapshot is damaged or was taken of a different
+	 *cache or TLB, the cache is left flushed. The miss penalty may differ
+	 **/
+	bool LoadCheckpoint(std::istream& is);
+
 	/**
 	 * @brief clears the cache
 	 **/
 	void ClearCache()
 	{
 		cache_->ClearCache();
+		if (prefetch_)
+			prefetch_->Clear();
+		if (tlb_)
+			tlb_->ClearCache();
+		if (victim_)
+			victim_->Clear();
+		if (write_buffer_)
+			write_buffer_->Clear();
 	}
 };
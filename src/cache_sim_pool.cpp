@@ -0,0 +1,55 @@
+/**
+ * filename: cache_sim_pool.cpp
+ *
+ * description: object file for a pool of reusable cache simulators
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "cache_sim_pool.hpp"
+
+#include <algorithm>
+
+namespace
+{
+bool SameGeometry(CacheConf lhs, CacheConf rhs)
+{
+	lhs.miss_penalty_ = rhs.miss_penalty_;
+	return lhs == rhs;
+}
+}  // namespace
+
+std::unique_ptr<CacheSimulator> CacheSimulatorPool::Acquire(const CacheConf &cc)
+{
+	std::unique_ptr<CacheSimulator> cs;
+	{
+		std::lock_guard lock{mutex_};
+		const auto it{std::find_if(
+			free_.begin(),
+			free_.end(),
+			[&](const auto &f)
+			{ return SameGeometry(f->get_cache_config(), cc); })};
+		if (it != free_.end())
+		{
+			cs = std::move(*it);
+			free_.erase(it);
+		}
+		else
+			created_++;
+	}
+
+	// build outside the lock, it is the slow part
+	if (!cs)
+		return std::make_unique<CacheSimulator>(cc);
+
+	cs->ClearCache();
+	cs->ClearComponents();
+	cs->set_miss_penalty(cc.miss_penalty_);
+	return cs;
+}
+
+void CacheSimulatorPool::Release(std::unique_ptr<CacheSimulator> cs)
+{
+	std::lock_guard lock{mutex_};
+	free_.push_back(std::move(cs));
+}
@@ -0,0 +1,55 @@
+/**
+ * filename: cache_sim_pool.hpp
+ *
+ * description: header file for a pool of reusable cache simulators
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "base_structs.hpp"
+#include "cache_sim.hpp"
+
+/**
+ * @brief keeps finished cache simulators around for the next job with the
+ *same geometry
+ * @description Building a simulator allocates every index of the cache,
+ *reusing one only costs a flush. Simulators are matched on every config
+ *parameter except the miss penalty. Safe to share between threads.
+ **/
+class CacheSimulatorPool
+{
+private:
+	std::mutex mutex_;
+	std::vector<std::unique_ptr<CacheSimulator>> free_;
+	// simulators built because there was no free one to reuse
+	size_t created_{};
+
+public:
+	/**
+	 * @brief a flushed simulator for cc without any components attached
+	 **/
+	std::unique_ptr<CacheSimulator> Acquire(const CacheConf &cc);
+
+	/**
+	 * @brief hand a simulator back for reuse
+	 **/
+	void Release(std::unique_ptr<CacheSimulator> cs);
+
+	size_t get_created_count()
+	{
+		std::lock_guard lock{mutex_};
+		return created_;
+	};
+
+	size_t get_free_count()
+	{
+		std::lock_guard lock{mutex_};
+		return free_.size();
+	};
+};
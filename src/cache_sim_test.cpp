@@ -8,13 +8,41 @@
  **/
 
 #include <gtest/gtest.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
 
+#include "address_map.hpp"
 #include "base_structs.hpp"
 #include "cache.hpp"
 #include "cache_block.hpp"
 #include "cache_factory.hpp"
+#include "cache_hierarchy.hpp"
+#include "cache_sim.hpp"
+#include "cache_sim_pool.hpp"
+#include "characterize.hpp"
+#include "coherent_sim.hpp"
+#include "event_stream.hpp"
+#include "line_trace.hpp"
+#include "numa.hpp"
+#include "perf_counters.hpp"
+#include "progress.hpp"
+#include "result_cache.hpp"
+#include "results_table.hpp"
+#include "shared_cache_sim.hpp"
+#include "shm_ring.hpp"
+#include "sim_client.hpp"
+#include "sim_server.hpp"
+#include "trace_stages.hpp"
 
 TEST(CacheSimTest, cacheConfig)
 {
@@ -151,3 +179,1386 @@ TEST(CacheSimTest, writePolicy)
 	ASSERT_FALSE(cache->AccessMemory(0b111, false));  // first index tag 0001
 	ASSERT_FALSE(cache->AccessMemory(0b111, false));  // first index tag 0001
 }
+
+TEST(CacheSimTest, evictionReport)
+{
+	CacheConf cc{2, 2, 8, ReplacementPolicy::FIFO, 1, 1};
+	// 2 indecies of 2 ways, 1 bit offset
+	std::unique_ptr<CacheBase> cache{CacheFactory::CreateCache(cc)};
+	ASSERT_FALSE(cache->Access(0b0001, false).evicted);	 // dirty
+	ASSERT_FALSE(cache->Access(0b0101, true).evicted);	 // clean
+	auto ar{cache->Access(0b1001, true)};
+	ASSERT_FALSE(ar.hit);
+	ASSERT_TRUE(ar.evicted);
+	ASSERT_EQ(cache->get_block_address(ar.victim.block_address), 0b0000);
+	ASSERT_TRUE(ar.victim.dirty);
+
+	ASSERT_TRUE(cache->Contains(0b0100));
+	auto cb{cache->Invalidate(0b0100)};
+	ASSERT_TRUE(cb.has_value());
+	ASSERT_FALSE(cb->dirty);
+	ASSERT_FALSE(cache->Contains(0b0100));
+	ASSERT_FALSE(cache->Invalidate(0b0100).has_value());
+	ASSERT_TRUE(cache->Contains(0b1000));
+
+	// filling a free way evicts nothing
+	ASSERT_FALSE(cache->Fill(0b1101, true).evicted);
+	ASSERT_TRUE(cache->AccessMemory(0b1101, true));
+}
+
+TEST(CacheSimTest, randEvictionReport)
+{
+	CacheConf cc{2, 2, 4, ReplacementPolicy::RAND, 1, 1};
+	// 1 index of 2 ways
+	std::unique_ptr<CacheBase> cache{CacheFactory::CreateCache(cc)};
+	ASSERT_FALSE(cache->Access(0b000, true).evicted);
+	ASSERT_FALSE(cache->Access(0b010, true).evicted);
+	ASSERT_TRUE(cache->Invalidate(0b000).has_value());
+	ASSERT_TRUE(cache->AccessMemory(0b010, true));
+	ASSERT_FALSE(cache->Access(0b100, true).evicted);
+	auto ar{cache->Access(0b110, true)};
+	ASSERT_TRUE(ar.evicted);
+	ASSERT_FALSE(cache->Contains(ar.victim.block_address));
+}
+
+namespace
+{
+StackTrace StridedTrace(address_t stride, address_t footprint, size_t passes)
+{
+	StackTrace st;
+	for (size_t p{}; p < passes; ++p)
+		for (address_t a{}; a < footprint; a += stride)
+			st.push_back({a, 2, (a / stride) % 3 != 0});
+	return st;
+}
+
+// a hot working set of hot_size bytes mixed with random accesses to a larger
+// region
+StackTrace MixedTrace(address_t hot_size, size_t accesses)
+{
+	StackTrace st;
+	std::mt19937 gen{7};
+	std::uniform_int_distribution<address_t> hot{0, hot_size - 1};
+	std::uniform_int_distribution<address_t> cold{0, 1 << 20};
+	for (size_t i{}; i < accesses; ++i)
+		st.push_back({i % 4 ? hot(gen) : cold(gen) + hot_size,
+					  static_cast<uint16_t>(i % 5),
+					  i % 3 != 0});
+	return st;
+}
+}  // namespace
+
+TEST(CacheSimTest, hierarchyMissStreamReplay)
+{
+	const StackTrace st{StridedTrace(8, 4096, 4)};
+	const CacheConf l1{16, 1, 512, ReplacementPolicy::FIFO, 10, 1};
+	const CacheConf l2{16, 4, 2048, ReplacementPolicy::FIFO, 100, 1};
+
+	for (auto policy : {NON_INCLUSIVE, EXCLUSIVE})
+	{
+		CacheHierarchy live{{l1, l2}, policy};
+		const auto live_res{live.SimulateTrace(st)};
+
+		CacheHierarchy recorder{{l1}, policy};
+		const auto ms{recorder.RecordMissStream(st)};
+		ASSERT_LT(ms.bytes(), ms.size() * sizeof(MemoryAccess));
+
+		CacheHierarchy replay{{l1, l2}, policy};
+		const auto replay_res{replay.SimulateMissStream(ms)};
+
+		ASSERT_EQ(live_res.levels.size(), 2);
+		for (size_t i{}; i < 2; ++i)
+		{
+			ASSERT_EQ(live_res.levels[i].counts.reads,
+					  replay_res.levels[i].counts.reads);
+			ASSERT_EQ(live_res.levels[i].counts.read_misses,
+					  replay_res.levels[i].counts.read_misses);
+			ASSERT_EQ(live_res.levels[i].counts.write_misses,
+					  replay_res.levels[i].counts.write_misses);
+			ASSERT_EQ(live_res.levels[i].writebacks,
+					  replay_res.levels[i].writebacks);
+		}
+		ASSERT_EQ(live_res.combined.run_time, replay_res.combined.run_time);
+	}
+}
+
+TEST(CacheSimTest, hierarchyInclusion)
+{
+	// l1 : 2 blocks, fully associative. l2 : 2 blocks, direct mapped
+	const CacheConf l1{2, 2, 4, ReplacementPolicy::FIFO, 1, 1};
+	const CacheConf l2{2, 1, 4, ReplacementPolicy::FIFO, 10, 1};
+	// 0b000 and 0b100 share an l2 index
+	const StackTrace st{{0b000, 0, true}, {0b100, 0, true}, {0b000, 0, true}};
+
+	CacheHierarchy inclusive{{l1, l2}, INCLUSIVE};
+	auto res{inclusive.SimulateTrace(st)};
+	// 0b100 and 0b000 evict each other from l2, and so from l1
+	ASSERT_EQ(res.levels[1].back_invalidations, 2);
+	ASSERT_EQ(res.levels[0].counts.read_misses, 3);
+
+	CacheHierarchy non_inclusive{{l1, l2}, NON_INCLUSIVE};
+	res = non_inclusive.SimulateTrace(st);
+	ASSERT_EQ(res.levels[1].back_invalidations, 0);
+	ASSERT_EQ(res.levels[0].counts.read_misses, 2);
+	ASSERT_EQ(res.combined.run_time, 3 + 2 * 1 + 2 * 10);
+
+	// the l1 victim is caught by the exclusive l2
+	const StackTrace st2{{0b000, 0, true},
+						 {0b010, 0, true},
+						 {0b100, 0, true},
+						 {0b000, 0, true}};
+	CacheHierarchy exclusive{{l1, l2}, EXCLUSIVE};
+	res = exclusive.SimulateTrace(st2);
+	ASSERT_EQ(res.levels[1].counts.reads, 4);
+	ASSERT_EQ(res.levels[1].counts.read_misses, 3);
+
+	// a write-through l1 passes its writes down, the exclusive l2 keeps the
+	// block it writes so the next read still hits it
+	const CacheConf write_through{2, 2, 4, ReplacementPolicy::FIFO, 1, 0};
+	const StackTrace st3{{0b000, 0, true},
+						 {0b010, 0, true},
+						 {0b100, 0, true},
+						 {0b000, 0, false},
+						 {0b000, 0, true},
+						 {0b110, 0, false}};
+	CacheHierarchy no_allocate{{write_through, l2}, EXCLUSIVE};
+	res = no_allocate.SimulateTrace(st3);
+	ASSERT_EQ(res.levels[0].counts.write_misses, 2);
+	ASSERT_EQ(res.levels[1].counts.reads, 4);
+	ASSERT_EQ(res.levels[1].counts.read_misses, 3);
+	ASSERT_EQ(res.levels[1].counts.writes, 2);
+	ASSERT_EQ(res.levels[1].counts.write_misses, 1);
+}
+
+TEST(CacheSimTest, nextLinePrefetch)
+{
+	const CacheConf cc{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1};
+	const StackTrace st{StridedTrace(16, 512, 1)};
+
+	CacheSimulator plain{cc};
+	ASSERT_EQ(plain.SimulateTrace(st).total_hit_rate, 0);
+	ASSERT_FALSE(plain.SimulateTrace(st).prefetch.has_value());
+
+	CacheSimulator prefetched{cc};
+	prefetched.set_prefetcher({.type_ = NEXT_LINE, .degree_ = 2});
+	const auto res{prefetched.SimulateTrace(st)};
+	ASSERT_TRUE(res.prefetch.has_value());
+	ASSERT_GT(res.total_hit_rate, 0.5);
+	ASSERT_EQ(res.prefetch->useful + res.prefetch->late +
+				  res.prefetch->useless,
+			  res.prefetch->issued);
+	// every access is 3 cycles apart, less than the miss penalty
+	ASSERT_GT(res.prefetch->late, 0);
+	ASSERT_GT(res.prefetch->coverage, 0.5);
+}
+
+TEST(CacheSimTest, stridePrefetch)
+{
+	const CacheConf cc{16, 4, 4096, ReplacementPolicy::FIFO, 1, 1};
+	// a 64 byte stride skips 3 of every 4 blocks
+	const StackTrace st{StridedTrace(64, 4096, 1)};
+
+	CacheSimulator next_line{cc};
+	next_line.set_prefetcher({.type_ = NEXT_LINE});
+	ASSERT_EQ(next_line.SimulateTrace(st).prefetch->useful, 0);
+
+	CacheSimulator stride{cc};
+	stride.set_prefetcher({.type_ = STRIDE, .distance_ = 2});
+	const auto res{stride.SimulateTrace(st)};
+	ASSERT_GT(res.total_hit_rate, 0.9);
+	ASSERT_GT(res.prefetch->accuracy, 0.9);
+
+	// an odd access lowers the confidence of the stride without replacing it
+	StridePrefetcher sp{{.type_ = STRIDE}, 4};
+	std::vector<address_t> prefetches;
+	for (const address_t a : {0u, 64u, 128u, 192u, 200u, 256u})
+		sp.OnAccess(a, true, prefetches);
+	ASSERT_EQ(prefetches, (std::vector<address_t>{192, 256}));
+	sp.OnAccess(320, true, prefetches);
+	ASSERT_EQ(prefetches.back(), 384);
+}
+
+TEST(CacheSimTest, streamPrefetchPollution)
+{
+	// a single block per index, every prefetch replaces a demand block
+	const CacheConf cc{16, 1, 64, ReplacementPolicy::FIFO, 1, 1};
+	StackTrace st;
+	for (size_t i{}; i < 64; ++i)
+		st.push_back(
+			{static_cast<address_t>((i % 2) * 0x1020 + i / 2 * 16), 0, true});
+
+	CacheSimulator stream{cc};
+	stream.set_prefetcher({.type_ = STREAM, .degree_ = 1, .distance_ = 1});
+	const auto res{stream.SimulateTrace(st)};
+	ASSERT_GT(res.prefetch->issued, 0);
+	ASSERT_GT(res.prefetch->useful, 0);
+	ASSERT_GT(res.prefetch->demand_evictions, 0);
+}
+
+TEST(CacheSimTest, mshrTiming)
+{
+	// every access is to a new block, 1 cycle apart
+	const CacheConf cc{16, 1, 1024, ReplacementPolicy::FIFO, 100, 1};
+	const StackTrace st{StridedTrace(16, 16 * 8, 1)};
+	for (auto &ma : st)
+		ASSERT_EQ(ma.last_memory_access_count, 2);
+
+	CacheSimulator blocking{cc};
+	blocking.set_timing_model(1);
+	auto res{blocking.SimulateTrace(st)};
+	ASSERT_TRUE(res.timing.has_value());
+	// one MSHR serializes the misses just like the blocking model
+	ASSERT_EQ(res.timing->run_time, 3 + 8 * 100);
+	ASSERT_EQ(res.timing->memory_level_parallelism, 1);
+
+	CacheSimulator non_blocking{cc};
+	non_blocking.set_timing_model(8);
+	res = non_blocking.SimulateTrace(st);
+	ASSERT_EQ(res.timing->run_time, 8 * 3 + 100);
+	ASSERT_EQ(res.timing->mshr_stall_cycles, 0);
+	ASSERT_GT(res.timing->memory_level_parallelism, 6);
+	ASSERT_LT(res.timing->run_time, res.run_time);
+}
+
+TEST(CacheSimTest, mshrDependency)
+{
+	const CacheConf cc{16, 1, 1024, ReplacementPolicy::FIFO, 100, 1};
+	// the load waits for the block, the store to the next block does not
+	const StackTrace st{
+		{0x00, 0, true}, {0x04, 0, true}, {0x10, 0, false}, {0x14, 0, false}};
+
+	CacheSimulator cs{cc};
+	cs.set_timing_model(4);
+	const auto res{cs.SimulateTrace(st)};
+	ASSERT_EQ(res.timing->dependency_stall_cycles, 99);
+	ASSERT_EQ(res.timing->merged_misses, 0);
+	ASSERT_EQ(res.timing->run_time, 102 + 100);
+}
+
+TEST(CacheSimTest, tlbHugePages)
+{
+	const CacheConf cc{16, 1, 1024, ReplacementPolicy::FIFO, 10, 1};
+	// one access per 4KB page over 1MB, twice
+	const StackTrace st{StridedTrace(4096, 1024 * 1024, 2)};
+
+	TlbConf tc{.entries_ = 64,
+			   .associativity_ = 4,
+			   .replacement_policy_ = FIFO,
+			   .walk_penalty_ = 30};
+	CacheSimulator base_pages{cc};
+	base_pages.set_tlb(tc);
+	const auto base_res{base_pages.SimulateTrace(st)};
+	ASSERT_TRUE(base_res.tlb.has_value());
+	// 256 pages do not fit in 64 entries
+	ASSERT_EQ(base_res.tlb->misses, 512);
+	ASSERT_EQ(base_res.tlb->walk_cycles, 512 * 30);
+	ASSERT_EQ(base_res.tlb->huge_accesses, 0);
+
+	tc.huge_entries_ = 8;
+	tc.huge_associativity_ = 8;
+	tc.huge_regions_ = {{0, 0xffffffff}};
+	CacheSimulator huge_pages{cc};
+	huge_pages.set_tlb(tc);
+	const auto huge_res{huge_pages.SimulateTrace(st)};
+	// the whole trace is in one 2MB page
+	ASSERT_EQ(huge_res.tlb->misses, 1);
+	ASSERT_EQ(huge_res.tlb->huge_accesses, st.size());
+	ASSERT_EQ(base_res.run_time - huge_res.run_time, 511 * 30);
+
+	// huge pages share the base TLB without a huge page TLB
+	tc.huge_entries_ = 0;
+	tc.huge_regions_ = {{0, 0x7ffff}};
+	CacheSimulator shared{cc};
+	shared.set_tlb(tc);
+	const auto shared_res{shared.SimulateTrace(st)};
+	// the huge page is pushed out by the 128 base pages on every pass
+	ASSERT_EQ(shared_res.tlb->huge_misses, 2);
+	ASSERT_EQ(shared_res.tlb->misses, 2 + 2 * 128);
+}
+
+TEST(CacheSimTest, sharedCacheInterference)
+{
+	// 4 indicies of 2 ways
+	const CacheConf cc{16, 2, 128, ReplacementPolicy::FIFO, 10, 1};
+	// a fits in the cache alone, b streams through it
+	const StackTrace a{StridedTrace(16, 64, 8)};
+	const StackTrace b{StridedTrace(16, 4096, 1)};
+
+	SharedCacheSimulator shared{cc};
+	auto res{shared.SimulateTraces({a, b}, ROUND_ROBIN)};
+	ASSERT_EQ(res.sources.size(), 2);
+	ASSERT_EQ(res.sources[0].counts.reads + res.sources[0].counts.writes,
+			  a.size());
+	ASSERT_GT(res.evictions[1][0], 0);
+	ASSERT_EQ(res.sources[0].evictions_suffered,
+			  res.evictions[0][0] + res.evictions[1][0]);
+	const auto shared_misses{res.sources[0].counts.read_misses +
+							 res.sources[0].counts.write_misses};
+	ASSERT_GT(shared_misses, 4);
+
+	// a keeps its own way of every index
+	SharedCacheSimulator partitioned{cc, {1, 1}};
+	res = partitioned.SimulateTraces({a, b}, ROUND_ROBIN);
+	ASSERT_EQ(res.sources[0].counts.read_misses +
+				  res.sources[0].counts.write_misses,
+			  4);
+	ASSERT_EQ(res.evictions[1][0], 0);
+	ASSERT_EQ(res.evictions[0][1], 0);
+
+	// sources past the byte that tracks them are not simulated
+	const std::vector<std::reference_wrapper<const StackTrace>> many(
+		SharedCacheSimulator::kMaxSources + 1, a);
+	ASSERT_TRUE(shared.SimulateTraces(many, ROUND_ROBIN).sources.empty());
+}
+
+TEST(CacheSimTest, sharedCacheTimestamps)
+{
+	const CacheConf cc{16, 2, 128, ReplacementPolicy::FIFO, 10, 1};
+	// a issues an access every 3 cycles, b every 30
+	const StackTrace a{StridedTrace(16, 160, 1)};
+	StackTrace b{StridedTrace(16, 160, 1)};
+	for (auto &ma : b)
+	{
+		ma.address += 0x1000;
+		ma.last_memory_access_count = 29;
+	}
+
+	SharedCacheSimulator shared{cc};
+	const auto res{shared.SimulateTraces({a, b}, TIMESTAMP)};
+	ASSERT_EQ(res.sources[0].counts.instructions, 30);
+	ASSERT_EQ(res.sources[1].counts.instructions, 300);
+	// a has finished by the time b starts, so b never loses a block to a
+	ASSERT_EQ(res.evictions[0][1], 0);
+	ASSERT_EQ(res.evictions[1][0], 8);
+	ASSERT_EQ(res.evictions[1][1], 2);
+}
+
+TEST(CacheSimTest, epochFlush)
+{
+	CacheConf cc{2, 2, 8, ReplacementPolicy::FIFO, 1, 1};
+	std::unique_ptr<CacheBase> cache{CacheFactory::CreateCache(cc)};
+	ASSERT_FALSE(cache->Contains(0b000));
+	ASSERT_FALSE(cache->AccessMemory(0b000, false));
+	ASSERT_FALSE(cache->AccessMemory(0b100, true));
+	ASSERT_TRUE(cache->AccessMemory(0b000, true));
+
+	cache->ClearCache();
+	ASSERT_FALSE(cache->Contains(0b000));
+	ASSERT_FALSE(cache->Invalidate(0b100).has_value());
+	ASSERT_FALSE(cache->AccessMemory(0b000, true));
+	// the index starts empty again, nothing is evicted until it is full
+	ASSERT_FALSE(cache->Access(0b100, true).evicted);
+	ASSERT_TRUE(cache->Access(0b1000, true).evicted);
+
+	// results after a flush match a freshly built cache
+	const StackTrace st{StridedTrace(2, 64, 3)};
+	CacheSimulator reused{cc};
+	reused.SimulateTrace(st);
+	reused.ClearCache();
+	CacheSimulator fresh{cc};
+	ASSERT_EQ(reused.SimulateTrace(st).run_time,
+			  fresh.SimulateTrace(st).run_time);
+}
+
+TEST(CacheSimTest, simulatorPool)
+{
+	CacheSimulatorPool pool;
+	const CacheConf cc{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1};
+	CacheConf slow{cc};
+	slow.miss_penalty_ = 100;
+	const CacheConf other{16, 4, 1024, ReplacementPolicy::FIFO, 10, 1};
+	const StackTrace st{StridedTrace(16, 512, 2)};
+
+	auto cs{pool.Acquire(cc)};
+	cs->set_timing_model(4);
+	const auto first{cs->SimulateTrace(st)};
+	pool.Release(std::move(cs));
+	ASSERT_EQ(pool.get_free_count(), 1);
+
+	// a different geometry is not reused
+	auto cs_other{pool.Acquire(other)};
+	ASSERT_EQ(pool.get_created_count(), 2);
+
+	// only the miss penalty differs, the flushed simulator is reused
+	cs = pool.Acquire(slow);
+	ASSERT_EQ(pool.get_created_count(), 2);
+	ASSERT_EQ(pool.get_free_count(), 0);
+	const auto second{cs->SimulateTrace(st)};
+	ASSERT_FALSE(second.timing.has_value());
+	ASSERT_EQ(second.total_hit_rate, first.total_hit_rate);
+	ASSERT_EQ(second.run_time - first.run_time, (100 - 10) * 32);
+}
+
+TEST(CacheSimTest, checkpointRestore)
+{
+	const CacheConf cc{16, 4, 1024, ReplacementPolicy::FIFO, 10, 1};
+	const TlbConf tc{.entries_ = 4,
+					 .associativity_ = 2,
+					 .page_size_ = 256,
+					 .replacement_policy_ = ReplacementPolicy::FIFO,
+					 .walk_penalty_ = 20};
+	// the warmup fills the cache, the trace then hits on its first 1024 bytes
+	const StackTrace warmup{StridedTrace(16, 1024, 1)};
+	const StackTrace st{StridedTrace(16, 1536, 1)};
+
+	CacheSimulator warm{cc};
+	warm.set_tlb(tc);
+	warm.SimulateTrace(warmup);
+	std::stringstream snapshot;
+	warm.SaveCheckpoint(snapshot);
+	const auto expected{warm.SimulateTrace(st)};
+
+	CacheSimulator restored{cc};
+	restored.set_tlb(tc);
+	ASSERT_TRUE(restored.LoadCheckpoint(snapshot));
+	const auto actual{restored.SimulateTrace(st)};
+
+	ASSERT_EQ(actual.total_hit_rate, expected.total_hit_rate);
+	ASSERT_EQ(actual.run_time, expected.run_time);
+	ASSERT_EQ(actual.tlb->misses, expected.tlb->misses);
+
+	restored.ClearCache();
+	const auto cold{restored.SimulateTrace(st)};
+	ASSERT_EQ(cold.total_hit_rate, 0);
+	ASSERT_NEAR(expected.total_hit_rate, 64.0 / 96.0, 1e-6);
+}
+
+TEST(CacheSimTest, checkpointRandomReplacement)
+{
+	const CacheConf cc{16, 4, 1024, ReplacementPolicy::RAND, 10, 1};
+	const StackTrace st{StridedTrace(16, 4096, 2)};
+
+	// the restored generator picks the same victims as the saved one
+	CacheSimulator warm{cc};
+	warm.SimulateTrace(st);
+	std::stringstream snapshot;
+	warm.SaveCheckpoint(snapshot);
+
+	CacheSimulator restored{cc};
+	ASSERT_TRUE(restored.LoadCheckpoint(snapshot));
+	for (int i{}; i < 3; i++)
+		ASSERT_EQ(restored.SimulateTrace(st).run_time,
+				  warm.SimulateTrace(st).run_time);
+}
+
+TEST(CacheSimTest, checkpointMismatch)
+{
+	const CacheConf cc{16, 4, 1024, ReplacementPolicy::FIFO, 10, 1};
+	const CacheConf other{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1};
+	const StackTrace st{StridedTrace(16, 512, 1)};
+
+	CacheSimulator warm{cc};
+	warm.SimulateTrace(st);
+	std::stringstream snapshot;
+	warm.SaveCheckpoint(snapshot);
+	const std::string bytes{snapshot.str()};
+
+	std::istringstream is{bytes};
+	CacheSimulator cs_other{other};
+	ASSERT_FALSE(cs_other.LoadCheckpoint(is));
+
+	// a TLB that was not in the snapshot
+	is.clear();
+	is.str(bytes);
+	CacheSimulator cs_tlb{cc};
+	cs_tlb.set_tlb({.entries_ = 4,
+					.associativity_ = 2,
+					.replacement_policy_ = ReplacementPolicy::FIFO,
+					.walk_penalty_ = 20});
+	ASSERT_FALSE(cs_tlb.LoadCheckpoint(is));
+
+	// a truncated snapshot leaves the cache flushed
+	CacheSimulator cs{cc};
+	cs.SimulateTrace(st);
+	is.clear();
+	is.str(bytes.substr(0, bytes.size() - 1));
+	ASSERT_FALSE(cs.LoadCheckpoint(is));
+	ASSERT_EQ(cs.SimulateTrace(st).total_hit_rate, 0);
+
+	// the miss penalty is not part of the snapshot
+	CacheConf slow{cc};
+	slow.miss_penalty_ = 100;
+	is.clear();
+	is.str(bytes);
+	CacheSimulator cs_slow{slow};
+	ASSERT_TRUE(cs_slow.LoadCheckpoint(is));
+	ASSERT_EQ(cs_slow.SimulateTrace(st).total_hit_rate, 1);
+}
+
+TEST(CacheSimTest, intervalSampling)
+{
+	const StackTrace st{MixedTrace(2048, 200000)};
+
+	const CacheConf cc{16, 4, 4096, ReplacementPolicy::FIFO, 50, 1};
+	CacheSimulator cs{cc};
+	const auto exact{cs.SimulateTrace(st)};
+
+	for (auto policy : {PERIODIC, RANDOM})
+	{
+		cs.ClearCache();
+		const auto estimate{cs.SampleTrace(
+			st, {.policy_ = policy, .intervals_ = 40, .interval_length_ = 500})};
+		ASSERT_EQ(estimate.sampling->sampled_accesses, 20000);
+		ASSERT_LT(estimate.sampling->total_hit_rate_error, 0.02);
+		ASSERT_NEAR(estimate.total_hit_rate,
+					exact.total_hit_rate,
+					estimate.sampling->total_hit_rate_error);
+		ASSERT_NEAR(static_cast<double>(estimate.run_time),
+					static_cast<double>(exact.run_time),
+					estimate.sampling->run_time_error);
+	}
+
+	// short warming still lands close on a small cache
+	cs.ClearCache();
+	const auto estimate{cs.SampleTrace(st,
+									   {.policy_ = RANDOM,
+										.intervals_ = 40,
+										.interval_length_ = 500,
+										.warming_length_ = 2000,
+										.seed_ = 3})};
+	ASSERT_NEAR(estimate.total_hit_rate, exact.total_hit_rate, 0.02);
+	// random intervals can start closer than 2000 to the one before
+	ASSERT_LE(estimate.sampling->warmed_accesses, 40 * 2000);
+
+	// by default only a few passes over the cache are warmed, most of the
+	// trace is skipped
+	cs.ClearCache();
+	const auto bounded{cs.SampleTrace(
+		st, {.policy_ = PERIODIC, .intervals_ = 40, .interval_length_ = 500})};
+	const uint64_t window{CacheSimulator::kWarmingPasses * 4096 / 16};
+	ASSERT_EQ(bounded.sampling->warmed_accesses, 40 * window);
+	// each part of 5000 accesses skips everything before its window
+	ASSERT_EQ(st.size() - bounded.sampling->sampled_accesses -
+				  bounded.sampling->warmed_accesses,
+			  40 * (5000 - 500 - window));
+	ASSERT_NEAR(bounded.total_hit_rate, exact.total_hit_rate, 0.02);
+}
+
+TEST(CacheSimTest, intervalSamplingWholeTrace)
+{
+	const CacheConf cc{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1};
+	const StackTrace st{StridedTrace(16, 2048, 2)};
+
+	CacheSimulator cs{cc};
+	const auto exact{cs.SimulateTrace(st)};
+	cs.ClearCache();
+	const auto estimate{cs.SampleTrace(
+		st, {.policy_ = PERIODIC, .intervals_ = 4, .interval_length_ = 64})};
+
+	// the intervals cover the trace, so it is simulated exactly
+	ASSERT_EQ(estimate.run_time, exact.run_time);
+	ASSERT_EQ(estimate.sampling->sampled_accesses, st.size());
+	ASSERT_EQ(estimate.sampling->total_hit_rate_error, 0);
+}
+
+TEST(CacheSimTest, setSampling)
+{
+	const StackTrace st{MixedTrace(32 * 1024, 200000)};
+	const CacheConf cc{16, 4, 16 * 1024, ReplacementPolicy::FIFO, 50, 1};
+	const CacheConf wide{16, 8, 32 * 1024, ReplacementPolicy::RAND, 50, 1};
+
+	// both configs have 256 sets, so they share one filter
+	ASSERT_EQ(GetIndexBits(cc), GetIndexBits(wide));
+	const SetSampleFilter filter{st, GetIndexBits(cc), 3};
+	ASSERT_EQ(filter.get_sampled_sets(), 32);
+
+	address_t sampled{};
+	for (address_t index{}; index < filter.get_total_sets(); ++index)
+		sampled += filter.IsSampled(index);
+	ASSERT_EQ(sampled, 32);
+	ASSERT_LT(filter.get_accesses().size(), st.size() / 4);
+
+	for (const auto &conf : {cc, wide})
+	{
+		CacheSimulator cs{conf};
+		const auto exact{cs.SimulateTrace(st)};
+		cs.ClearCache();
+		const auto estimate{cs.SimulateSetSample(filter)};
+
+		ASSERT_EQ(estimate.set_sampling->sampling_ratio, 1.0 / 8);
+		ASSERT_EQ(estimate.set_sampling->total_accesses, st.size());
+		ASSERT_GT(estimate.set_sampling->total_hit_rate_error, 0);
+		ASSERT_LT(estimate.set_sampling->total_hit_rate_error, 0.01);
+		ASSERT_NEAR(estimate.total_hit_rate, exact.total_hit_rate, 0.01);
+	}
+
+	// random replacement picks the same victims on every run with a seed,
+	// and a flushed cache starts over from the seed
+	CacheConf seeded{wide};
+	seeded.seed_ = 7;
+	CacheSimulator first{seeded};
+	CacheSimulator second{seeded};
+	const auto estimate{first.SimulateSetSample(filter)};
+	ASSERT_EQ(second.SimulateSetSample(filter).total_hit_rate,
+			  estimate.total_hit_rate);
+	first.ClearCache();
+	ASSERT_EQ(first.SimulateSetSample(filter).total_hit_rate,
+			  estimate.total_hit_rate);
+}
+
+TEST(CacheSimTest, resultCache)
+{
+	const auto folder{std::filesystem::temp_directory_path() /
+					  "cache_sim_test_results"};
+	std::filesystem::remove_all(folder);
+	const ResultCache rc{folder};
+
+	StackTrace st{StridedTrace(16, 2048, 2)};
+	const auto hash{ResultCache::HashTrace(st)};
+	const CacheConf cc{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1};
+	CacheConf slow{cc};
+	slow.miss_penalty_ = 100;
+	const CacheConf other{16, 4, 1024, ReplacementPolicy::FIFO, 10, 1};
+
+	ASSERT_FALSE(rc.Find(hash, cc).has_value());
+	CacheSimulator cs{cc};
+	cs.SimulateTrace(st);
+	ASSERT_TRUE(rc.Store(hash, cc, cs.get_counts()));
+
+	// only the miss penalty differs, the run time is recomputed from the
+	// stored counts
+	const auto counts{rc.Find(hash, slow)};
+	ASSERT_TRUE(counts.has_value());
+	const auto expected{CacheSimulator{slow}.SimulateTrace(st)};
+	const auto actual{counts->ToResults(slow.miss_penalty_)};
+	ASSERT_EQ(actual.run_time, expected.run_time);
+	ASSERT_EQ(actual.total_hit_rate, expected.total_hit_rate);
+	ASSERT_EQ(actual.average_memory_access_time,
+			  expected.average_memory_access_time);
+
+	ASSERT_FALSE(rc.Find(hash, other).has_value());
+	st.back().is_read = !st.back().is_read;
+	ASSERT_NE(ResultCache::HashTrace(st), hash);
+	ASSERT_FALSE(rc.Find(ResultCache::HashTrace(st), cc).has_value());
+
+	std::filesystem::remove_all(folder);
+}
+
+TEST(CacheSimTest, simServer)
+{
+	const auto socket_path{
+		(std::filesystem::temp_directory_path() / "cache_sim_test.sock")
+			.string()};
+	const StackTrace st{StridedTrace(16, 2048, 2)};
+	int loads{};
+	SimServer server{socket_path,
+					 [&](const std::string &path) -> std::optional<StackTrace>
+					 {
+						 if (path != "strided")
+							 return {};
+						 loads++;
+						 return st;
+					 },
+					 2};
+	std::jthread run{[&]() { server.Run(); }};
+
+	SimClient client;
+	// the server may not be listening yet
+	for (int i{}; i < 100 && !client.Connect(socket_path); ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	const auto id{client.LoadTrace("strided")};
+	ASSERT_TRUE(id.has_value());
+	// the trace stays loaded
+	ASSERT_EQ(client.LoadTrace("strided"), id);
+	ASSERT_EQ(loads, 1);
+	ASSERT_FALSE(client.LoadTrace("missing").has_value());
+
+	std::vector<CacheConf> confs{
+		{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1},
+		{16, 4, 1024, ReplacementPolicy::FIFO, 100, 0},
+		{32, 1, 2048, ReplacementPolicy::RAND, 50, 1},
+		{16, 4, 512, ReplacementPolicy::RAND, 50, 1}};
+	// the seed goes to the server with the rest of the config
+	confs.back().seed_ = 11;
+	std::vector<std::optional<Results>> results(confs.size());
+	ASSERT_TRUE(client.Simulate(
+		{id.value()},
+		confs,
+		[&](uint32_t trace, uint32_t conf, const Results &res)
+		{
+			EXPECT_EQ(trace, 0);
+			results.at(conf) = res;
+		}));
+
+	for (size_t i{}; i < confs.size(); ++i)
+	{
+		const auto expected{CacheSimulator{confs[i]}.SimulateTrace(st)};
+		ASSERT_TRUE(results[i].has_value());
+		ASSERT_EQ(results[i]->run_time, expected.run_time);
+		ASSERT_EQ(results[i]->total_hit_rate, expected.total_hit_rate);
+	}
+
+	// a line size that is not a power of 2
+	ASSERT_FALSE(client.Simulate({id.value()},
+								 {{12, 2, 1024, ReplacementPolicy::FIFO, 10, 1}},
+								 [](uint32_t, uint32_t, const Results &) {}));
+	// no ways at all, answered with an error and the server keeps serving
+	for (const auto policy : {ReplacementPolicy::FIFO, ReplacementPolicy::RAND})
+	{
+		ASSERT_FALSE(client.Simulate({id.value()},
+									 {{16, 0, 1024, policy, 10, 1}},
+									 [](uint32_t, uint32_t, const Results &) {}));
+		ASSERT_EQ(client.get_error(), "invalid cache config");
+	}
+	ASSERT_TRUE(client.Simulate({id.value()},
+								{confs.front()},
+								[](uint32_t, uint32_t, const Results &) {}));
+
+	server.Stop();
+}
+
+TEST(CacheSimTest, shmRing)
+{
+	const std::string name{"/cache_sim_test_" + std::to_string(::getpid())};
+	const StackTrace st{StridedTrace(8, 4096, 3)};
+	const std::vector<CacheConf> confs{
+		{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1},
+		{32, 4, 2048, ReplacementPolicy::FIFO, 100, 0}};
+
+	// a ring much smaller than the trace, the producer has to wait
+	auto ring{ShmRing::Create(name, 100, 2)};
+	ASSERT_NE(ring, nullptr);
+	ASSERT_EQ(ring->get_capacity(), 128);
+	ASSERT_EQ(ShmRing::Create(name, 100, 2), nullptr);
+
+	std::vector<Results> results(confs.size());
+	{
+		std::vector<std::jthread> consumers;
+		for (uint32_t i{}; i < confs.size(); ++i)
+			consumers.emplace_back(
+				[&, i]()
+				{
+					ShmRingConsumer consumer{*ring, i};
+					CacheSimulator cs{confs[i]};
+					results[i] =
+						cs.SimulateStream([&]() { return consumer.Next(); });
+				});
+
+		// the producer side of the ring, as another process would see it
+		auto shared{ShmRing::Open(name)};
+		ASSERT_NE(shared, nullptr);
+		ShmRingProducer producer{*shared};
+		for (const auto &ma : st)
+			producer.Push(ma);
+		producer.Close();
+		ASSERT_GT(producer.get_stall_count(), 0);
+	}
+
+	for (size_t i{}; i < confs.size(); ++i)
+	{
+		const auto expected{CacheSimulator{confs[i]}.SimulateTrace(st)};
+		ASSERT_EQ(results[i].run_time, expected.run_time);
+		ASSERT_EQ(results[i].total_hit_rate, expected.total_hit_rate);
+	}
+
+	ring.reset();
+	ASSERT_EQ(ShmRing::Open(name), nullptr);
+}
+
+TEST(CacheSimTest, eventStream)
+{
+	const auto file{std::filesystem::temp_directory_path() /
+					"cache_sim_test.events"};
+	const StackTrace st{MixedTrace(2048, 10000)};
+	const CacheConf cc{16, 2, 1024, ReplacementPolicy::FIFO, 10, 0};
+
+	// the outcomes straight from a cache of the same config
+	auto cache{CacheFactory::CreateCache(cc)};
+	std::vector<AccessResult> expected;
+	for (const auto &ma : st)
+		expected.push_back(cache->Access(ma.address, ma.is_read));
+
+	CacheSimulator cs{cc};
+	{
+		EventStreamWriter events{file.string(), true, cache->offset_size_, 1000};
+		ASSERT_TRUE(events.is_open());
+		cs.set_event_stream(&events);
+		cs.SimulateTrace(st);
+		cs.set_event_stream(nullptr);
+		ASSERT_TRUE(events.Close());
+	}
+
+	auto reader{EventStreamReader::Open(file.string())};
+	ASSERT_NE(reader, nullptr);
+	ASSERT_EQ(reader->get_access_count(), st.size());
+	ASSERT_EQ(reader->get_index().size(), 10u);
+
+	const auto all{reader->Read(0, st.size())};
+	ASSERT_EQ(all.size(), expected.size());
+	uint64_t misses{};
+	for (size_t i{}; i < all.size(); ++i)
+	{
+		ASSERT_EQ(all[i].hit, expected[i].hit);
+		ASSERT_EQ(all[i].evicted, expected[i].evicted);
+		if (expected[i].evicted)
+		{
+			// only the block of the victim is recorded
+			ASSERT_EQ(all[i].victim.block_address,
+					  cache->get_block_address(
+						  expected[i].victim.block_address));
+			ASSERT_EQ(all[i].victim.dirty, expected[i].victim.dirty);
+		}
+		misses += !expected[i].hit;
+	}
+	ASSERT_EQ(misses,
+			  cs.get_counts().read_misses + cs.get_counts().write_misses);
+
+	// an interval cutting through three blocks
+	const auto part{reader->Read(1500, 1700)};
+	ASSERT_EQ(part.size(), 1700u);
+	uint64_t part_misses{};
+	for (size_t i{}; i < part.size(); ++i)
+	{
+		ASSERT_EQ(part[i].hit, expected[1500 + i].hit);
+		part_misses += !part[i].hit;
+	}
+	ASSERT_EQ(reader->CountMisses(1500, 1700), part_misses);
+	ASSERT_TRUE(reader->Read(st.size(), 10).empty());
+
+	std::filesystem::remove(file);
+}
+
+TEST(CacheSimTest, resultsTable)
+{
+	const CacheConf cc{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1};
+	CacheSimulator cs{cc};
+	cs.set_prefetcher({.type_ = NEXT_LINE});
+	// only reads, the write hit rate is not a number
+	StackTrace st{StridedTrace(16, 4096, 1)};
+	for (auto &ma : st)
+		ma.is_read = true;
+	const std::vector<ResultsTable::Row> rows{
+		{"a.trace", "x,y.conf", cc, cs.SimulateTrace(st)},
+		{"b.trace", "z.conf", cc, CacheSimulator{cc}.SimulateTrace(st)}};
+	const auto columns{ResultsTable::get_columns().size()};
+
+	std::ostringstream csv;
+	ASSERT_TRUE(ResultsTable::Write(csv, rows, ResultsTable::CSV));
+	std::istringstream lines{csv.str()};
+	std::string line;
+	size_t count{};
+	while (std::getline(lines, line))
+	{
+		// the quoted comma of the config name is not a separator
+		const auto separators{std::ranges::count(line, ',')};
+		ASSERT_EQ(static_cast<size_t>(separators),
+				  count == 1 ? columns : columns - 1);
+		count++;
+	}
+	ASSERT_EQ(count, 3u);
+	ASSERT_NE(csv.str().find("\"x,y.conf\""), std::string::npos);
+
+	std::ostringstream jsonl;
+	ASSERT_TRUE(ResultsTable::Write(jsonl, rows, ResultsTable::JSONL));
+	const auto second{jsonl.str().substr(jsonl.str().find('\n') + 1)};
+	ASSERT_NE(jsonl.str().find("\"prefetch_issued\":"), std::string::npos);
+	ASSERT_EQ(second.find("\"prefetch_issued\":"), std::string::npos);
+	ASSERT_NE(second.find("\"write_hit_rate\":null"), std::string::npos);
+	ASSERT_NE(second.find("\"cache_size\":1024"), std::string::npos);
+	ASSERT_NE(second.find("\"replacement_seed\":0"), std::string::npos);
+}
+
+TEST(CacheSimTest, numaTopology)
+{
+	ASSERT_EQ(Numa::ParseCpuList("0-3,8,10-11\n"),
+			  (std::vector<uint32_t>{0, 1, 2, 3, 8, 10, 11}));
+	ASSERT_TRUE(Numa::ParseCpuList("").empty());
+
+	const auto sysfs{std::filesystem::temp_directory_path() /
+					 "cache_sim_test_nodes"};
+	std::filesystem::remove_all(sysfs);
+	for (const auto &[node, cpus] :
+		 {std::pair{"node1", "4-7"}, {"node0", "0-3"}, {"node2", "8-9"}})
+	{
+		std::filesystem::create_directories(sysfs / node);
+		std::ofstream{sysfs / node / "cpulist"} << cpus << "\n";
+	}
+	std::filesystem::create_directories(sysfs / "power");
+
+	// node 2 has no allowed CPU
+	const auto nodes{Numa::ReadTopology({0, 1, 2, 3, 5, 6}, sysfs.string())};
+	ASSERT_EQ(nodes.size(), 2u);
+	ASSERT_EQ(nodes[0].id, 0u);
+	ASSERT_EQ(nodes[0].cpus.size(), 4u);
+	ASSERT_EQ(nodes[1].cpus, (std::vector<uint32_t>{5, 6}));
+
+	// workers alternate between the nodes, then wrap around each node
+	ASSERT_EQ(Numa::Place(nodes, 0).cpu, 0u);
+	ASSERT_EQ(Numa::Place(nodes, 1).cpu, 5u);
+	ASSERT_EQ(Numa::Place(nodes, 2).cpu, 1u);
+	ASSERT_EQ(Numa::Place(nodes, 3).node, 1u);
+	ASSERT_EQ(Numa::Place(nodes, 3).cpu, 6u);
+	ASSERT_EQ(Numa::Place(nodes, 5).cpu, 5u);
+
+	// without a topology every allowed CPU is one node
+	const auto flat{Numa::ReadTopology({0, 1}, (sysfs / "missing").string())};
+	ASSERT_EQ(flat.size(), 1u);
+	ASSERT_EQ(flat[0].cpus.size(), 2u);
+
+	std::filesystem::remove_all(sysfs);
+}
+
+TEST(CacheSimTest, perfCounters)
+{
+	const StackTrace st{MixedTrace(4096, 20000)};
+	CacheSimulator cs{{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1}};
+
+	// counters that are not permitted are left out, the time is always there
+	PerfCounters pc;
+	pc.Start();
+	cs.SimulateTrace(st);
+	const auto sample{pc.Stop()};
+	ASSERT_GT(sample.ns, 0u);
+	ASSERT_EQ(pc.is_available(),
+			  std::ranges::any_of(sample.counters,
+								  [](const auto &c) { return c.has_value(); }));
+	if (sample.counters[INSTRUCTIONS])
+	{
+		ASSERT_GT(*sample.counters[INSTRUCTIONS], st.size());
+	}
+
+	auto total{sample};
+	total += sample;
+	ASSERT_EQ(total.ns, 2 * sample.ns);
+	if (sample.get_ipc())
+	{
+		ASSERT_DOUBLE_EQ(*total.get_ipc(), *sample.get_ipc());
+	}
+}
+
+TEST(CacheSimTest, progressReport)
+{
+	const auto status{std::filesystem::temp_directory_path() /
+					  "cache_sim_test_status.json"};
+	std::filesystem::remove(status);
+	const StackTrace st{MixedTrace(4096, 200000)};
+
+	std::ostringstream os;
+	ProgressReporter reporter{std::chrono::milliseconds{10}, &os,
+							  status.string()};
+	auto &fast{reporter.AddJob("fast.conf", st.size())};
+	auto &stalled{reporter.AddJob("stalled.conf", st.size())};
+	reporter.Start();
+
+	CacheSimulator cs{{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1}};
+	cs.set_progress(&fast.done);
+	cs.SimulateTrace(st);
+	ASSERT_EQ(fast.done, st.size());
+	fast.finished = true;
+	reporter.Stop();
+
+	// the last report has every access of the finished job, and the stalled
+	// job as the slowest
+	std::ifstream file{status};
+	const std::string json{std::istreambuf_iterator<char>{file}, {}};
+	ASSERT_NE(json.find("\"done\":200000,\"total\":400000"), std::string::npos);
+	ASSERT_NE(json.find("\"slowest\":[\"stalled.conf\"]"), std::string::npos);
+	ASSERT_NE(os.str().find("slow : stalled.conf"), std::string::npos);
+	ASSERT_EQ(stalled.done, 0u);
+
+	std::filesystem::remove(status);
+}
+
+TEST(CacheSimTest, lineTraceInterning)
+{
+	const StackTrace st{MixedTrace(2048, 50000)};
+	const auto lt{LineTraces::Intern(st, 4, 4)};
+	ASSERT_LT(sizeof(LineAccess), sizeof(MemoryAccess));
+	ASSERT_EQ(lt.accesses.size(), st.size());
+
+	// IDs are handed out in first touch order, and map back to the lines
+	uint32_t seen{};
+	for (size_t i{}; i < st.size(); ++i)
+	{
+		const auto id{lt.accesses[i].get_id()};
+		ASSERT_LE(id, seen);
+		seen += id == seen;
+		ASSERT_EQ(lt.get_address(id), st[i].address >> 4 << 4);
+		ASSERT_EQ(lt.accesses[i].is_read(), st[i].is_read);
+	}
+	ASSERT_EQ(seen, lt.lines.size());
+
+	const CacheConf cc{16, 1, 1024, ReplacementPolicy::FIFO, 10, 1};
+	CacheSimulator cs{cc};
+	cs.SimulateTrace(st);
+	ASSERT_EQ(lt.instructions, cs.get_counts().instructions);
+
+	// the same misses as the cache itself, every line misses on first touch
+	const auto mc{LineTraces::ClassifyMisses(lt, cc)};
+	ASSERT_EQ(mc.misses,
+			  cs.get_counts().read_misses + cs.get_counts().write_misses);
+	ASSERT_EQ(mc.compulsory, lt.lines.size());
+	ASSERT_EQ(mc.compulsory + mc.capacity + mc.conflict, mc.misses);
+	ASSERT_GT(mc.conflict, 0u);
+
+	// optimal replacement does no worse than fully associative FIFO
+	const CacheConf fully{16, 64, 1024, ReplacementPolicy::FIFO, 10, 1};
+	const auto fifo{LineTraces::ClassifyMisses(lt, fully)};
+	ASSERT_LE(fifo.opt_misses, fifo.misses);
+	ASSERT_GE(fifo.opt_misses, lt.lines.size());
+}
+
+TEST(CacheSimTest, addressMap)
+{
+	// a heap and a stack region far apart in a 64 bit address space
+	std::mt19937 gen{7};
+	std::uniform_int_distribution<uint64_t> offset{0, (1u << 20) - 1};
+	std::vector<uint64_t> wide;
+	// the same accesses with each region moved below 4GiB
+	StackTrace narrow;
+	for (size_t i{}; i < 20000; ++i)
+	{
+		const bool stack{i % 3 == 0};
+		const auto o{offset(gen)};
+		wide.push_back((stack ? 0x7ffd00000000ull : 0x555500000000ull) + o);
+		narrow.push_back({static_cast<address_t>((stack ? 1u << 24 : 0u) + o),
+						  1,
+						  i % 2 == 0});
+	}
+
+	ASSERT_FALSE(AddressMap::Build({0, 1, 0xffffffff}).has_value());
+	const auto map{AddressMap::Build(wide)};
+	ASSERT_TRUE(map.has_value());
+	ASSERT_GE(map->low_bits, 24);
+	ASSERT_TRUE(map->IsExact(20));
+
+	StackTrace compact{narrow};
+	for (size_t i{}; i < wide.size(); ++i)
+	{
+		compact[i].address = map->Compact(wide[i]);
+		ASSERT_EQ(map->Expand(compact[i].address), wide[i]);
+	}
+
+	// a cache within the kept bits sees the same hits as on the originals
+	const CacheConf cc{64, 4, 64 * 1024, ReplacementPolicy::FIFO, 10, 1};
+	CacheSimulator wide_cs{cc};
+	wide_cs.SimulateTrace(compact);
+	CacheSimulator narrow_cs{cc};
+	narrow_cs.SimulateTrace(narrow);
+	ASSERT_EQ(wide_cs.get_counts().read_misses,
+			  narrow_cs.get_counts().read_misses);
+	ASSERT_EQ(wide_cs.get_counts().write_misses,
+			  narrow_cs.get_counts().write_misses);
+
+	// addresses sharing their upper half keep all 32 bits
+	const auto shared{AddressMap::Build(
+		{0x100000000ull, 0x1deadbeefull, 0x1ffffffffull})};
+	ASSERT_TRUE(shared.has_value());
+	ASSERT_EQ(shared->low_bits, 32);
+	ASSERT_EQ(shared->Compact(0x1deadbeefull), 0xdeadbeefu);
+
+	// two wide traces sharing lines, renumbered on their own the same address
+	// differs between them and different addresses collide
+	const uint64_t heap{0x555500000000ull};
+	std::vector<uint64_t> writer;
+	std::vector<uint64_t> reader;
+	for (uint64_t line{}; line < 64; ++line)
+	{
+		writer.push_back(heap + line * 64);
+		reader.push_back(line * 64);
+		reader.push_back(heap + line * 64);
+	}
+	const auto compact_trace{
+		[](const std::vector<uint64_t> &addresses,
+		   const AddressMap &m,
+		   bool is_read)
+		{
+			StackTrace st;
+			for (const auto a : addresses)
+				st.push_back({m.Compact(a), 9, is_read});
+			return st;
+		}};
+	std::vector<std::optional<AddressMap>> maps{AddressMap::Build(writer),
+												AddressMap::Build(reader)};
+	StackTrace w{compact_trace(writer, maps[0].value(), false)};
+	StackTrace r{compact_trace(reader, maps[1].value(), true)};
+	ASSERT_EQ(w[0].address, r[0].address);
+	ASSERT_NE(w[0].address, r[1].address);
+
+	const auto unified{AddressMap::Unify({w, r}, maps)};
+	ASSERT_TRUE(unified.has_value());
+	for (size_t i{}; i < w.size(); ++i)
+	{
+		ASSERT_EQ(w[i].address, r[2 * i + 1].address);
+		ASSERT_NE(w[i].address, r[2 * i].address);
+		ASSERT_EQ(unified->Expand(r[2 * i].address), reader[2 * i]);
+	}
+	// the reader's misses now fetch the lines the writer modified
+	CoherentSimulator cohs{cc, 2, SNOOP, 100};
+	const auto res{cohs.SimulateTraces({w, r})};
+	ASSERT_GT(res.cores[0].writebacks, 0);
+}
+
+TEST(CacheSimTest, traceCharacterization)
+{
+	const StackTrace st{MixedTrace(2048, 300000)};
+	const auto tc{Characterize::Run(st, 4)};
+	const auto single{Characterize::Run(st, 1)};
+
+	// merged sketches and counts are the same as those of one pass
+	ASSERT_EQ(tc.unique_lines, single.unique_lines);
+	ASSERT_EQ(tc.page_density, single.page_density);
+	ASSERT_EQ(tc.strides, single.strides);
+	ASSERT_EQ(tc.gaps, single.gaps);
+
+	CacheSimulator cs{CacheConf{16, 1, 1024, ReplacementPolicy::FIFO, 10, 1}};
+	cs.SimulateTrace(st);
+	ASSERT_EQ(tc.accesses, st.size());
+	ASSERT_EQ(tc.instructions, cs.get_counts().instructions);
+	ASSERT_EQ(tc.reads, cs.get_counts().reads);
+
+	for (size_t k{}; k < tc.unique_lines.size(); ++k)
+	{
+		std::set<address_t> lines;
+		std::set<address_t> pages;
+		for (const auto &ma : st)
+		{
+			lines.insert(ma.address >> TraceCharacter::kLineOffsets[k]);
+			pages.insert(ma.address >> TraceCharacter::kPageOffset);
+		}
+		ASSERT_NEAR(tc.unique_lines[k],
+					static_cast<double>(lines.size()),
+					0.03 * static_cast<double>(lines.size()));
+		ASSERT_EQ(tc.pages, pages.size());
+	}
+
+	uint64_t strides{};
+	for (const auto count : tc.strides)
+		strides += count;
+	ASSERT_EQ(strides, st.size() - 1);
+	ASSERT_EQ(tc.gaps[0], st.size() / 5);
+	ASSERT_EQ(TraceCharacter::stride_bucket(0), 32u);
+	ASSERT_EQ(TraceCharacter::stride_bucket(64), 39u);
+	ASSERT_EQ(TraceCharacter::stride_bucket(-1), 31u);
+}
+
+TEST(CacheSimTest, traceStages)
+{
+	const StackTrace st{MixedTrace(2048, 50000)};
+	const StackTrace other{StridedTrace(8, 4096, 4)};
+	const CacheConf cc{16, 2, 1024, ReplacementPolicy::FIFO, 10, 1};
+
+	// every stage against the same accesses stored up front
+	const auto check{[&](auto &&accesses, const StackTrace &expected)
+					 {
+						 CacheSimulator lazy{cc};
+						 const auto res{lazy.SimulateTrace(accesses)};
+						 CacheSimulator stored{cc};
+						 const auto exact{stored.SimulateTrace(expected)};
+						 ASSERT_EQ(lazy.get_counts().reads,
+								   stored.get_counts().reads);
+						 ASSERT_EQ(lazy.get_counts().writes,
+								   stored.get_counts().writes);
+						 ASSERT_EQ(res.total_hit_rate, exact.total_hit_rate);
+					 }};
+
+	StackTrace loads;
+	StackTrace ranged;
+	StackTrace every;
+	StackTrace xored;
+	for (size_t i{}; i < st.size(); ++i)
+	{
+		if (st[i].is_read)
+			loads.push_back(st[i]);
+		if (st[i].address >= 0x100 && st[i].address <= 0x7ff)
+			ranged.push_back(st[i]);
+		if (i % 7 == 3)
+			every.push_back(st[i]);
+		xored.push_back({st[i].address ^ 0x30, st[i].last_memory_access_count,
+						 st[i].is_read});
+	}
+	check(st | TraceStages::Loads(), loads);
+	check(st | TraceStages::InRange(0x100, 0x7ff), ranged);
+	check(st | TraceStages::Every(7, 3), every);
+	check(st | TraceStages::Remap([](address_t a) { return a ^ 0x30; }),
+		  xored);
+	check(st | TraceStages::Slice(100, 1000),
+		  StackTrace(st.begin() + 100, st.begin() + 1100));
+
+	// stages from the command line, in order
+	std::vector<Stage> stages;
+	for (const auto *spec : {"loads", "every:7:3", "slice:10:100"})
+		stages.push_back(TraceStages::ParseStage(spec).value());
+	ASSERT_FALSE(TraceStages::ParseStage("every:0").has_value());
+	ASSERT_FALSE(TraceStages::ParseStage("range:0x20:0x10").has_value());
+	StackTrace staged;
+	for (size_t i{}; i < loads.size(); ++i)
+		if (i % 7 == 3)
+			staged.push_back(loads[i]);
+	check(st | TraceStages::Apply{stages},
+		  StackTrace(staged.begin() + 10, staged.begin() + 110));
+
+	// traces one after the other and in turn
+	StackTrace concat{st};
+	concat.insert(concat.end(), other.begin(), other.end());
+	check(TraceStages::Concat({st, other}), concat);
+	StackTrace interleaved;
+	for (size_t i{}; i < st.size(); ++i)
+	{
+		if (!st[i].is_read)
+			interleaved.push_back(st[i]);
+		if (i < other.size() && !other[i].is_read)
+			interleaved.push_back(other[i]);
+	}
+	check(TraceStages::Interleave({st, other}) | TraceStages::Stores(),
+		  interleaved);
+}
+
+TEST(CacheSimTest, victimCacheAndWriteBuffer)
+{
+	// two blocks that conflict in a direct mapped cache, used in turn
+	StackTrace st;
+	for (size_t i{}; i < 1000; ++i)
+		st.push_back(
+			{static_cast<address_t>(i % 2 ? 0x1000 : 0x0), 0, i % 4 != 1});
+	const CacheConf dm{16, 1, 1024, ReplacementPolicy::FIFO, 50, 1};
+
+	CacheSimulator plain{dm};
+	plain.SimulateTrace(st);
+	ASSERT_EQ(plain.get_counts().read_misses + plain.get_counts().write_misses,
+			  st.size());
+
+	// the victim cache catches every conflict after the first two misses
+	CacheSimulator victim{dm};
+	victim.set_victim_cache({.entries_ = 2, .hit_latency_ = 2});
+	const auto res{victim.SimulateTrace(st)};
+	ASSERT_TRUE(res.victim.has_value());
+	const auto &counts{victim.get_counts()};
+	ASSERT_EQ(counts.read_misses + counts.write_misses, 2u);
+	ASSERT_EQ(res.victim->probes, st.size());
+	ASSERT_EQ(res.victim->hits, st.size() - 2);
+	ASSERT_EQ(res.victim->swap_cycles, 2 * (st.size() - 2));
+	ASSERT_EQ(res.run_time, st.size() + 2 * 50 + 2 * (st.size() - 2));
+
+	// dirty blocks keep their dirty bit through the swaps, nothing leaves
+	ASSERT_EQ(res.victim->writebacks, 0u);
+
+	// the events agree with the counts on the victim cache hits
+	const auto file{std::filesystem::temp_directory_path() /
+					"cache_sim_test.victim.events"};
+	{
+		EventStreamWriter events{file.string(), false, 4, 1000};
+		ASSERT_TRUE(events.is_open());
+		victim.ClearCache();
+		victim.set_event_stream(&events);
+		victim.SimulateTrace(st);
+		victim.set_event_stream(nullptr);
+		ASSERT_TRUE(events.Close());
+	}
+	auto reader{EventStreamReader::Open(file.string())};
+	ASSERT_NE(reader, nullptr);
+	uint64_t event_misses{};
+	for (const auto &ar : reader->Read(0, st.size()))
+		event_misses += !ar.hit;
+	ASSERT_EQ(event_misses, 2u);
+	std::filesystem::remove(file);
+
+	// a write-through cache sends every store to the buffer, stores to the
+	// same line merge while it waits
+	const CacheConf wt{16, 1, 1024, ReplacementPolicy::FIFO, 50, 0};
+	StackTrace stores;
+	for (size_t i{}; i < 400; ++i)
+		stores.push_back({static_cast<address_t>((i / 4) * 16), 0, false});
+	CacheSimulator buffered{wt};
+	buffered.set_write_buffer({.depth_ = 4, .drain_cycles_ = 20});
+	const auto wb_res{buffered.SimulateTrace(stores)};
+	ASSERT_TRUE(wb_res.write_buffer.has_value());
+	ASSERT_EQ(wb_res.write_buffer->writes, stores.size());
+	ASSERT_EQ(wb_res.write_buffer->coalesced, stores.size() * 3 / 4);
+	ASSERT_EQ(wb_res.write_buffer->memory_writes, stores.size() / 4);
+	// a line every 4 cycles drains one every 20, so the buffer fills and
+	// stores wait
+	ASSERT_GT(wb_res.write_buffer->stall_cycles, 0u);
+
+	CacheSimulator unbuffered{wt};
+	const auto plain_res{unbuffered.SimulateTrace(stores)};
+	ASSERT_EQ(wb_res.run_time,
+			  plain_res.run_time + wb_res.write_buffer->stall_cycles);
+
+	// a deep enough buffer never stalls
+	CacheSimulator deep{wt};
+	deep.set_write_buffer({.depth_ = 128, .drain_cycles_ = 20});
+	ASSERT_EQ(deep.SimulateTrace(stores).write_buffer->stall_cycles, 0u);
+}
+
+TEST(CacheSimTest, coherentCaches)
+{
+	// 16 indicies of 4 ways, every trace fits
+	const CacheConf cc{16, 4, 1024, ReplacementPolicy::FIFO, 10, 1};
+	// a writes the lines b reads, c works apart from both
+	StackTrace a;
+	StackTrace b;
+	StackTrace c;
+	for (size_t p{}; p < 20; ++p)
+		for (address_t line{}; line < 8; ++line)
+		{
+			a.push_back({line * 16, 9, false});
+			b.push_back({line * 16, 9, true});
+			c.push_back({0x1000 + line * 16, 9, p % 2 == 0});
+		}
+
+	CoherentSimulator snoop{cc, 3, SNOOP, 50};
+	const auto res{snoop.SimulateTraces({a, b, c})};
+	ASSERT_EQ(res.cores.size(), 3);
+	ASSERT_EQ(res.cores[1].counts.instructions, 1600);
+	ASSERT_GT(res.cores[0].upgrades, 0);
+	ASSERT_GT(res.cores[0].invalidations_sent, 0);
+	ASSERT_EQ(res.cores[0].invalidations_sent,
+			  res.cores[1].invalidations_received);
+	// b misses on every line a took from it
+	ASSERT_GT(res.cores[1].coherence_misses, 0);
+	ASSERT_EQ(res.cores[1].counts.read_misses,
+			  8 + res.cores[1].coherence_misses);
+	// b's reads make a write back the lines it modified
+	ASSERT_GT(res.cores[0].writebacks, 0);
+	ASSERT_EQ(res.cores[2].coherence_misses, 0);
+	ASSERT_EQ(res.cores[2].upgrades, 0);
+	ASSERT_EQ(res.cores[2].invalidations_received, 0);
+	ASSERT_EQ(res.cores[2].counts.read_misses + res.cores[2].counts.write_misses,
+			  8);
+
+	// the results do not depend on the threads running the cores
+	CoherentSimulator serial{cc, 3, SNOOP, 50, 1};
+	const auto serial_res{serial.SimulateTraces({a, b, c})};
+	ASSERT_EQ(serial_res.epochs, res.epochs);
+	for (size_t i{}; i < 3; ++i)
+	{
+		const auto &x{res.cores[i]};
+		const auto &y{serial_res.cores[i]};
+		ASSERT_EQ(x.counts.read_misses, y.counts.read_misses);
+		ASSERT_EQ(x.counts.write_misses, y.counts.write_misses);
+		ASSERT_EQ(x.coherence_misses, y.coherence_misses);
+		ASSERT_EQ(x.upgrades, y.upgrades);
+		ASSERT_EQ(x.invalidations_sent, y.invalidations_sent);
+		ASSERT_EQ(x.writebacks, y.writebacks);
+		ASSERT_EQ(x.messages, y.messages);
+	}
+
+	// a directory only sends to the cores holding the line, the caches end
+	// up the same
+	CoherentSimulator directory{cc, 3, DIRECTORY, 50};
+	const auto directory_res{directory.SimulateTraces({a, b, c})};
+	for (size_t i{}; i < 3; ++i)
+	{
+		ASSERT_EQ(directory_res.cores[i].counts.read_misses,
+				  res.cores[i].counts.read_misses);
+		ASSERT_EQ(directory_res.cores[i].coherence_misses,
+				  res.cores[i].coherence_misses);
+	}
+	ASSERT_LT(directory_res.cores[2].messages, res.cores[2].messages);
+
+	// b evicts and fetches a line again after a writes it within one epoch,
+	// the write invalidates b's old copy but not the one b fetched after it
+	CacheConf dm{16, 1, 64, FIFO, 10, 1};
+	const StackTrace writer{{0x20, 9, true}, {0x0, 139, false}};
+	const StackTrace reader{
+		{0x0, 9, true}, {0x40, 149, true}, {0x0, 9, true}, {0x0, 39, true}};
+	CoherentSimulator follow{dm, 2, SNOOP, 100};
+	const auto follow_res{follow.SimulateTraces({writer, reader})};
+	ASSERT_EQ(follow_res.cores[1].invalidations_received, 1);
+	ASSERT_EQ(follow_res.cores[1].coherence_misses, 0);
+	ASSERT_EQ(follow_res.cores[1].counts.read_misses, 3);
+	// b's fetch after the write makes a write back the line
+	ASSERT_EQ(follow_res.cores[0].writebacks, 1);
+}
@@ -0,0 +1,215 @@
+/**
+ * filename: characterize.cpp
+ *
+ * description: the footprint and access pattern of a trace
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "characterize.hpp"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <thread>
+
+namespace
+{
+constexpr size_t kPages{size_t{1} << (std::numeric_limits<address_t>::digits -
+									  TraceCharacter::kPageOffset)};
+constexpr size_t kGaps{size_t{std::numeric_limits<uint16_t>::max()} + 1};
+
+// what one thread counts of its part of the trace
+struct Part
+{
+	std::array<HyperLogLog, TraceCharacter::kLineOffsets.size()> lines;
+	std::vector<uint32_t> page_counts = std::vector<uint32_t>(kPages);
+	std::array<uint64_t, TraceCharacter::kStrideBuckets> strides{};
+	std::vector<uint64_t> gaps = std::vector<uint64_t>(kGaps);
+	uint64_t reads{};
+};
+
+void Count(const StackTrace &st, size_t first, size_t last, Part &part)
+{
+	if (first == last)
+		return;
+
+	constexpr auto &offsets{TraceCharacter::kLineOffsets};
+	address_t previous{first > 0 ? st[first - 1].address : st[first].address};
+	// the first access of the part is a new line at every size
+	address_t changed{first > 0 ? previous ^ st[first].address
+								: std::numeric_limits<address_t>::max()};
+	for (size_t i{first}; i < last; ++i)
+	{
+		const auto &ma{st[i]};
+		if (i > first)
+			changed = previous ^ ma.address;
+
+		// a line only changes when every smaller line changed as well, and
+		// adding a line again does not move the estimate
+		for (size_t k{}; k < offsets.size() && (changed >> offsets[k]); ++k)
+			part.lines[k].Add(ma.address >> offsets[k]);
+		if (i > 0)
+			part.strides[TraceCharacter::stride_bucket(
+				static_cast<int64_t>(ma.address) -
+				static_cast<int64_t>(previous))]++;
+
+		part.page_counts[ma.address >> TraceCharacter::kPageOffset]++;
+		part.gaps[ma.last_memory_access_count]++;
+		part.reads += ma.is_read;
+		previous = ma.address;
+	}
+}
+
+// the gap a fraction q of the accesses are at or below
+size_t GapQuantile(const TraceCharacter &tc, double q)
+{
+	const auto target{static_cast<uint64_t>(
+		std::ceil(q * static_cast<double>(tc.accesses)))};
+	uint64_t seen{};
+	for (size_t gap{}; gap < tc.gaps.size(); ++gap)
+	{
+		seen += tc.gaps[gap];
+		if (seen >= std::max<uint64_t>(target, 1))
+			return gap;
+	}
+	return tc.gaps.size() - 1;
+}
+
+std::string StrideLabel(size_t bucket)
+{
+	if (bucket == 32)
+		return "0";
+	const auto width{bucket > 32 ? bucket - 32 : 32 - bucket};
+	const auto low{uint64_t{1} << (width - 1)};
+	return std::string{bucket > 32 ? "+" : "-"} + "[" + std::to_string(low) +
+		   ", " + std::to_string(low * 2) + ")";
+}
+}  // namespace
+
+void HyperLogLog::Merge(const HyperLogLog &other)
+{
+	for (size_t i{}; i < registers_.size(); ++i)
+		registers_[i] = std::max(registers_[i], other.registers_[i]);
+}
+
+double HyperLogLog::Estimate() const
+{
+	const auto m{static_cast<double>(registers_.size())};
+	double sum{};
+	size_t zeros{};
+	for (const auto r : registers_)
+	{
+		sum += std::ldexp(1.0, -r);
+		zeros += r == 0;
+	}
+
+	const double estimate{0.7213 / (1 + 1.079 / m) * m * m / sum};
+	// linear counting is more accurate while many registers are still empty
+	if (estimate <= 2.5 * m && zeros > 0)
+		return m * std::log(m / static_cast<double>(zeros));
+	return estimate;
+}
+
+namespace Characterize
+{
+TraceCharacter Run(const StackTrace &st, size_t threads)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	// a part per thread, but no parts too small to be worth a thread
+	threads = std::clamp<size_t>(st.size() / (1 << 16), 1, threads);
+
+	std::vector<Part> parts(threads);
+	{
+		std::vector<std::jthread> workers;
+		for (size_t t{}; t < threads; ++t)
+			workers.emplace_back(
+				[&, t]()
+				{
+					Count(st,
+						  st.size() * t / threads,
+						  st.size() * (t + 1) / threads,
+						  parts[t]);
+				});
+	}
+
+	TraceCharacter tc{.accesses = st.size(),
+					  .reads = 0,
+					  .instructions = 0,
+					  .unique_lines = {},
+					  .pages = 0,
+					  .page_density = {},
+					  .strides = {},
+					  .gaps = std::vector<uint64_t>(kGaps)};
+	auto &merged{parts.front()};
+	for (size_t t{1}; t < parts.size(); ++t)
+	{
+		for (size_t k{}; k < merged.lines.size(); ++k)
+			merged.lines[k].Merge(parts[t].lines[k]);
+		for (size_t page{}; page < kPages; ++page)
+			merged.page_counts[page] += parts[t].page_counts[page];
+		for (size_t b{}; b < merged.strides.size(); ++b)
+			merged.strides[b] += parts[t].strides[b];
+		for (size_t gap{}; gap < kGaps; ++gap)
+			merged.gaps[gap] += parts[t].gaps[gap];
+		merged.reads += parts[t].reads;
+	}
+
+	for (size_t k{}; k < merged.lines.size(); ++k)
+		tc.unique_lines[k] = merged.lines[k].Estimate();
+	for (const auto count : merged.page_counts)
+		if (count > 0)
+		{
+			tc.pages++;
+			tc.page_density[static_cast<size_t>(std::bit_width(count)) - 1]++;
+		}
+	tc.strides = merged.strides;
+	tc.gaps = std::move(merged.gaps);
+	tc.reads = merged.reads;
+	for (size_t gap{}; gap < kGaps; ++gap)
+		tc.instructions += tc.gaps[gap] * (gap + 1);
+	return tc;
+}
+
+void Write(std::ostream &os, const TraceCharacter &tc)
+{
+	os << "Accesses\t : " << tc.accesses << std::endl;
+	os << "Reads\t : " << tc.reads << std::endl;
+	os << "Writes\t : " << tc.accesses - tc.reads << std::endl;
+	os << "Read ratio\t : "
+	   << (tc.accesses ? static_cast<double>(tc.reads) /
+							 static_cast<double>(tc.accesses)
+					   : 0)
+	   << std::endl;
+	os << "Instructions\t : " << tc.instructions << std::endl;
+
+	os << std::endl << "Unique lines (estimated)" << std::endl;
+	for (size_t k{}; k < tc.unique_lines.size(); ++k)
+		os << (1u << TraceCharacter::kLineOffsets[k]) << "B lines\t : "
+		   << std::llround(tc.unique_lines[k]) << std::endl;
+
+	os << std::endl
+	   << "Pages touched\t : " << tc.pages << " of "
+	   << (1u << TraceCharacter::kPageOffset) << "B" << std::endl;
+	os << "Accesses per page\t : pages" << std::endl;
+	for (size_t b{}; b < tc.page_density.size(); ++b)
+		if (tc.page_density[b] > 0)
+			os << "[" << (uint64_t{1} << b) << ", " << (uint64_t{1} << (b + 1))
+			   << ")\t : " << tc.page_density[b] << std::endl;
+
+	os << std::endl << "Stride bytes\t : accesses" << std::endl;
+	for (size_t b{}; b < tc.strides.size(); ++b)
+		if (tc.strides[b] > 0)
+			os << StrideLabel(b) << "\t : " << tc.strides[b] << std::endl;
+
+	os << std::endl << "Instructions between accesses" << std::endl;
+	os << "Mean\t : "
+	   << (tc.accesses ? static_cast<double>(tc.instructions - tc.accesses) /
+							 static_cast<double>(tc.accesses)
+					   : 0)
+	   << std::endl;
+	for (const auto q : {0.5, 0.9, 0.99, 1.0})
+		os << "p" << q * 100 << "\t : " << GapQuantile(tc, q) << std::endl;
+}
+}  // namespace Characterize
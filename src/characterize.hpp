@@ -0,0 +1,115 @@
+/**
+ * filename: characterize.hpp
+ *
+ * description: header file for the footprint and access pattern of a trace
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+#include <vector>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief an estimate of the distinct values added, in 2^kPrecision bytes
+ * @description Each value is hashed, the top kPrecision bits of the hash
+ *pick a register and the register keeps the most leading zeros plus one of
+ *the rest of the hash. Sketches of different parts of a trace merge by
+ *taking the larger register. The standard error is about 1%.
+ **/
+class HyperLogLog
+{
+public:
+	static constexpr unsigned int kPrecision{14};
+
+private:
+	std::vector<uint8_t> registers_;
+
+	// splitmix64 finalizer, spreads line and page numbers over the hash
+	static uint64_t Hash(uint64_t x)
+	{
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ull;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	};
+
+public:
+	HyperLogLog() : registers_(size_t{1} << kPrecision) {}
+
+	void Add(uint64_t value)
+	{
+		const auto h{Hash(value)};
+		// the sentinel bit caps the zeros at the bits left after the index
+		const auto rest{(h << kPrecision) | (uint64_t{1} << (kPrecision - 1))};
+		const auto rank{static_cast<uint8_t>(std::countl_zero(rest) + 1)};
+		auto &r{registers_[h >> (64 - kPrecision)]};
+		r = std::max(r, rank);
+	};
+
+	void Merge(const HyperLogLog &other);
+
+	double Estimate() const;
+};
+
+/**
+ * @brief the footprint and access pattern of a trace
+ * @description Unique lines are estimated for every line size of
+ *kLineSizes, everything else is counted exactly. Pages are 4KiB.
+ *page_density[i] : pages touched by [2^i, 2^(i+1)) accesses
+ *strides : byte distance from the previous access, stride_bucket gives the
+ *bucket of a distance
+ *gaps[n] : accesses with a last_memory_access_count of n
+ **/
+struct TraceCharacter
+{
+	static constexpr std::array<uint_fast8_t, 5> kLineOffsets{4, 5, 6, 7, 8};
+	static constexpr uint_fast8_t kPageOffset{12};
+	static constexpr size_t kDensityBuckets{33};
+	static constexpr size_t kStrideBuckets{65};
+
+	uint64_t accesses;
+	uint64_t reads;
+	uint64_t instructions;
+	std::array<double, kLineOffsets.size()> unique_lines;
+	uint64_t pages;
+	std::array<uint64_t, kDensityBuckets> page_density;
+	std::array<uint64_t, kStrideBuckets> strides;
+	std::vector<uint64_t> gaps;
+
+	/**
+	 * @brief 32 for a distance of 0, 32 + bit_width of a forward distance and
+	 *32 - bit_width of a backward distance
+	 **/
+	static size_t stride_bucket(int64_t distance)
+	{
+		const auto width{static_cast<size_t>(
+			std::bit_width(static_cast<uint64_t>(std::abs(distance))))};
+		return distance < 0 ? 32 - width : 32 + width;
+	};
+};
+
+namespace Characterize
+{
+/**
+ * @brief characterize st in one pass
+ * @param threads 0 uses one per hardware thread
+ * @description The trace is split between the threads, each keeps its own
+ *sketches and counts of its part, which are merged at the end.
+ **/
+TraceCharacter Run(const StackTrace &st, size_t threads = 0);
+
+/**
+ * @brief write a character as a plain text report
+ **/
+void Write(std::ostream &os, const TraceCharacter &tc);
+}  // namespace Characterize
@@ -0,0 +1,102 @@
+/**
+ * filename: client.cpp
+ *
+ * description: sends simulations to a running simulation server
+ *
+ * authors: Chamberlain, David
+ *
+ **/
+
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "sim_client.hpp"
+#include "util.hpp"
+
+namespace po = boost::program_options;
+
+int main(int argc, char **argv)
+{
+	// clang-format off
+	po::options_description desc{"Options"};
+	desc.add_options()("help,h", "Help prompt")
+		("socket", po::value<std::string>()->default_value("cache_sim.sock"), "Unix domain socket the server listens on")
+		("stack-trace,s", po::value<std::vector<std::string>>()->multitoken()->composing(), "Stack Trace files, read by the server")
+		("cache-conf,c", po::value<std::vector<std::string>>()->multitoken()->composing(), "Cache Configuration files");
+	// clang-format on
+
+	po::variables_map vm;
+	po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+	po::notify(vm);
+
+	if (vm.count("help") || !vm.count("stack-trace") || !vm.count("cache-conf"))
+	{
+		std::cout << desc << std::endl;
+		return vm.count("help") ? 0 : 1;
+	}
+
+	std::vector<std::string> trace_names;
+	std::vector<std::string> conf_names;
+	std::vector<CacheConf> confs;
+	for (const std::string &cc_file :
+		 vm["cache-conf"].as<std::vector<std::string>>())
+	{
+		auto cc{Util::ReadCacheConfFile(cc_file)};
+		if (!cc.has_value())
+		{
+			std::cerr << "Cache Config file " << cc_file << " not found"
+					  << std::endl;
+			return 1;
+		}
+		confs.push_back(cc.value());
+		conf_names.push_back(std::filesystem::path(cc_file).filename());
+	}
+
+	SimClient client;
+	if (!client.Connect(vm["socket"].as<std::string>()))
+	{
+		std::cerr << client.get_error() << std::endl;
+		return 1;
+	}
+
+	std::vector<uint32_t> trace_ids;
+	for (const std::string &st_file :
+		 vm["stack-trace"].as<std::vector<std::string>>())
+	{
+		// the server reads the trace, so give it a path it can open
+		const auto id{client.LoadTrace(std::filesystem::absolute(st_file))};
+		if (!id.has_value())
+		{
+			std::cerr << client.get_error() << std::endl;
+			return 1;
+		}
+		trace_ids.push_back(id.value());
+		trace_names.push_back(std::filesystem::path(st_file).filename());
+	}
+
+	// one tab separated line per result, in the order they finish
+	std::cout << "Stack Trace\tCache Config\tTotal Hit Rate\tLoad Hit "
+				 "Rate\tWrite Hit Rate\tTotal Run Time\tAverage Memory Access "
+				 "Latency"
+			  << std::endl;
+	const bool ok{client.Simulate(
+		trace_ids,
+		confs,
+		[&](uint32_t trace, uint32_t conf, const Results &res)
+		{
+			std::cout << trace_names[trace] << "\t" << conf_names[conf] << "\t"
+					  << res.total_hit_rate << "\t" << res.read_hit_rate << "\t"
+					  << res.write_hit_rate << "\t" << res.run_time << "\t"
+					  << res.average_memory_access_time << std::endl;
+		})};
+	if (!ok)
+	{
+		std::cerr << client.get_error() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
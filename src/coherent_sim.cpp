@@ -0,0 +1,305 @@
+/**
+ * filename: coherent_sim.cpp
+ *
+ * description: simulating the private caches of several cores kept coherent
+ *with MESI
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "coherent_sim.hpp"
+
+#include <algorithm>
+#include <barrier>
+#include <bit>
+#include <thread>
+
+CoherentSimulator::CoherentSimulator(CacheConf cache_conf,
+									 size_t cores,
+									 CoherenceProtocol protocol,
+									 uint64_t epoch_length,
+									 size_t threads)
+	: cache_conf_{cache_conf},
+	  protocol_{protocol},
+	  epoch_length_{std::max<uint64_t>(epoch_length, 1)},
+	  threads_{std::clamp<size_t>(
+		  threads ? threads : cores, 1, std::clamp<size_t>(cores, 1, 64))},
+	  cores_(std::clamp<size_t>(cores, 1, 64))
+{
+	for (auto &core : cores_)
+		core.cache = CacheFactory::CreateCache(cache_conf);
+}
+
+bool CoherentSimulator::is_done() const
+{
+	return std::ranges::all_of(cores_,
+							   [](const Core &core)
+							   { return core.next == core.trace->size(); });
+}
+
+void CoherentSimulator::RunEpoch(size_t c, uint64_t end)
+{
+	auto &core{cores_[c]};
+	const uint64_t self{uint64_t{1} << c};
+	const auto &st{*core.trace};
+	for (; core.next < st.size(); ++core.next)
+	{
+		const auto &ma{st[core.next]};
+		const auto time{core.clock + ma.last_memory_access_count + 1};
+		if (time >= end)
+			break;
+		core.clock = time;
+
+		auto &counts{core.counts};
+		if (ma.is_read)
+			counts.reads++;
+		else
+			counts.writes++;
+		counts.instructions += ma.last_memory_access_count + 1;
+
+		const auto line{get_line(ma.address)};
+		const auto ar{core.cache->Access(ma.address, ma.is_read)};
+		if (ar.evicted)
+		{
+			const auto victim{get_line(ar.victim.block_address)};
+			core.requests.push_back(
+				{.time = time, .line = victim, .type = EVICT});
+			core.exclusive.erase(victim);
+		}
+
+		// what the directory knew at the start of the epoch
+		const auto known{directory_.find(line)};
+		const bool alone{known == directory_.end() ||
+						 (known->second.sharers & ~self) == 0};
+		if (!ar.hit)
+		{
+			if (ma.is_read)
+				counts.read_misses++;
+			else
+				counts.write_misses++;
+			if (core.invalidated.erase(line))
+				core.stats.coherence_misses++;
+			core.requests.push_back(
+				{.time = time, .line = line, .type = ma.is_read ? READ : WRITE});
+			if (core.cache->Contains(ma.address))
+				core.filled[line] = time;
+			if (!ma.is_read || alone)
+				core.exclusive[line] = !ma.is_read;
+			continue;
+		}
+
+		if (ma.is_read)
+			continue;
+		const auto held{core.exclusive.find(line)};
+		if (held != core.exclusive.end())
+		{
+			if (!held->second)
+				core.requests.push_back(
+					{.time = time, .line = line, .type = MODIFY});
+			held->second = true;
+			continue;
+		}
+		// exclusive or shared at the start of the epoch, a modified line
+		// needs no request
+		const bool modified{alone && known != directory_.end() &&
+							known->second.dirty};
+		if (!modified)
+			core.requests.push_back(
+				{.time = time, .line = line, .type = alone ? MODIFY : UPGRADE});
+		core.exclusive[line] = true;
+	}
+}
+
+void CoherentSimulator::Invalidate(size_t c,
+								   address_t line,
+								   uint64_t time,
+								   LineState &state)
+{
+	auto &core{cores_[c]};
+	const uint64_t others{state.sharers & ~(uint64_t{1} << c)};
+	for (auto rest{others}; rest; rest &= rest - 1)
+	{
+		const auto o{static_cast<size_t>(std::countr_zero(rest))};
+		auto &other{cores_[o]};
+		// the cache only holds the state of the end of the epoch, a copy the
+		// other core fetched again after the write is already up to date
+		const auto fill{other.filled.find(line)};
+		const bool refetched{fill != other.filled.end() &&
+							 (fill->second > time ||
+							  (fill->second == time && o > c))};
+		if (!refetched)
+		{
+			other.cache->Invalidate(line);
+			other.invalidated.insert(line);
+			other.exclusive.erase(line);
+		}
+		other.stats.invalidations_received++;
+		core.stats.invalidations_sent++;
+		if (state.dirty)
+			other.stats.writebacks++;
+	}
+
+	core.stats.messages += protocol_ == SNOOP
+							   ? cores_.size() - 1
+							   : 1 + static_cast<uint64_t>(std::popcount(others));
+	// a no-write allocate write miss leaves no copy behind
+	const bool holds{core.cache->Contains(line)};
+	state.sharers = holds ? uint64_t{1} << c : 0;
+	state.dirty = holds;
+}
+
+void CoherentSimulator::ResolveEpoch()
+{
+	struct Queued
+	{
+		Request request;
+		size_t core;
+	};
+	std::vector<Queued> queued;
+	for (size_t c{}; c < cores_.size(); ++c)
+		for (const auto &r : cores_[c].requests)
+			queued.push_back({r, c});
+	// each core's requests are already in order, ties go to the lower core
+	std::ranges::stable_sort(queued,
+							 [](const Queued &a, const Queued &b)
+							 {
+								 return a.request.time < b.request.time ||
+										(a.request.time == b.request.time &&
+										 a.core < b.core);
+							 });
+
+	for (const auto &[request, c] : queued)
+	{
+		auto &core{cores_[c]};
+		const uint64_t self{uint64_t{1} << c};
+		auto &state{directory_[request.line]};
+		switch (request.type)
+		{
+			case READ:
+			{
+				const bool forwarded{state.dirty && (state.sharers & ~self)};
+				// the modified copy is written back and both cores share it
+				if (forwarded)
+				{
+					cores_[static_cast<size_t>(std::countr_zero(
+								state.sharers & ~self))]
+						.stats.writebacks++;
+					state.dirty = false;
+				}
+				core.stats.messages += protocol_ == SNOOP ? cores_.size() - 1
+														  : 1u + forwarded;
+				if (core.cache->Contains(request.line))
+					state.sharers |= self;
+				break;
+			}
+			case MODIFY:
+				if ((state.sharers & ~self) == 0)
+				{
+					state.sharers |= self;
+					state.dirty = true;
+					break;
+				}
+				// another core read the line since, it is an upgrade after all
+				[[fallthrough]];
+			case UPGRADE:
+				core.stats.upgrades++;
+				[[fallthrough]];
+			case WRITE:
+				Invalidate(c, request.line, request.time, state);
+				break;
+			case EVICT:
+				if (state.sharers & self)
+				{
+					state.sharers &= ~self;
+					if (state.dirty)
+						core.stats.writebacks++;
+					state.dirty = false;
+				}
+				break;
+		}
+		if (state.sharers == 0)
+			directory_.erase(request.line);
+	}
+
+	for (auto &core : cores_)
+	{
+		core.requests.clear();
+		core.exclusive.clear();
+		core.filled.clear();
+	}
+}
+
+CoherentResults CoherentSimulator::SimulateTraces(
+	const std::vector<std::reference_wrapper<const StackTrace>> &traces)
+{
+	static const StackTrace kIdle;
+	directory_.clear();
+	for (size_t c{}; c < cores_.size(); ++c)
+	{
+		auto &core{cores_[c]};
+		core.cache->ClearCache();
+		// cores past the last trace sit idle
+		core.trace = c < traces.size() ? &traces[c].get() : &kIdle;
+		core.next = 0;
+		core.clock = 0;
+		core.counts = {};
+		core.requests.clear();
+		core.exclusive.clear();
+		core.filled.clear();
+		core.invalidated.clear();
+		core.stats = {};
+	}
+
+	uint64_t end{epoch_length_};
+	uint64_t epochs{};
+	const auto close_epoch{[&]()
+						   {
+							   ResolveEpoch();
+							   end += epoch_length_;
+							   epochs++;
+						   }};
+
+	if (threads_ == 1)
+		while (!is_done())
+		{
+			for (size_t c{}; c < cores_.size(); ++c)
+				RunEpoch(c, end);
+			close_epoch();
+		}
+	else
+	{
+		// the last thread to reach the barrier resolves the epoch for all
+		bool done{is_done()};
+		std::barrier sync{static_cast<std::ptrdiff_t>(threads_),
+						  [&]() noexcept
+						  {
+							  close_epoch();
+							  done = is_done();
+						  }};
+		std::vector<std::jthread> workers;
+		for (size_t t{}; t < threads_; ++t)
+			workers.emplace_back(
+				[&, t]()
+				{
+					while (!done)
+					{
+						for (size_t c{t}; c < cores_.size(); c += threads_)
+							RunEpoch(c, end);
+						sync.arrive_and_wait();
+					}
+				});
+	}
+
+	CoherentResults cr{.cores = {}, .combined = {}, .epochs = epochs};
+	AccessCounts combined{};
+	for (auto &core : cores_)
+	{
+		core.stats.counts = core.counts;
+		core.stats.results = core.counts.ToResults(cache_conf_.miss_penalty_);
+		combined += core.counts;
+		cr.cores.push_back(core.stats);
+	}
+	cr.cores.resize(std::min(cr.cores.size(), traces.size()));
+	cr.combined = combined.ToResults(cache_conf_.miss_penalty_);
+	return cr;
+}
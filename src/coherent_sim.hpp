@@ -0,0 +1,181 @@
+/**
+ * filename: coherent_sim.hpp
+ *
+ * description: header file for simulating the private caches of several cores
+ *kept coherent with MESI
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base_structs.hpp"
+#include "cache_factory.hpp"
+
+/**
+ * @brief how the cores find the other copies of a line
+ * @description SNOOP : every request is broadcast on a bus and snooped by
+ *every other core
+ * DIRECTORY : every request goes to a directory, which forwards it only to
+ *the cores holding the line
+ * Both keep the caches in the same states, they only differ in the messages
+ *they send.
+ **/
+enum CoherenceProtocol
+{
+	SNOOP,
+	DIRECTORY
+};
+
+struct CoreResults
+{
+	Results results;
+	AccessCounts counts;
+	// misses to lines another core invalidated, included in the misses
+	uint64_t coherence_misses;
+	// writes that hit a shared line and had to invalidate the other copies
+	uint64_t upgrades;
+	// copies in other cores this core's writes invalidated
+	uint64_t invalidations_sent;
+	// copies in this core another core's writes invalidated
+	uint64_t invalidations_received;
+	// modified lines written back, on eviction or when another core wanted
+	// them
+	uint64_t writebacks;
+	// coherence messages this core's requests caused
+	uint64_t messages;
+};
+
+struct CoherentResults
+{
+	std::vector<CoreResults> cores;
+	Results combined;
+	uint64_t epochs;
+};
+
+/**
+ * @brief one trace per core, each core with a private cache, kept coherent
+ *with MESI
+ * @description The cores advance by instruction count in epochs of
+ *epoch_length instructions. Within an epoch every core simulates its own
+ *accesses against its own cache, on its own thread, and queues the misses,
+ *upgrades and evictions that change which cores hold a line. At the barrier
+ *closing the epoch the queued requests of every core are applied to the
+ *directory in instruction count order, invalidating and downgrading the
+ *copies in the other caches. A core can hit on a line another core
+ *invalidated earlier in the same epoch, shorter epochs are closer to a
+ *globally ordered simulation. The results do not depend on the number of
+ *threads.
+ **/
+class CoherentSimulator
+{
+private:
+	/**
+	 * READ : a read miss
+	 * WRITE : a write miss
+	 * UPGRADE : a write hit on a line other cores may hold
+	 * MODIFY : the first write to a line the core held alone, an upgrade if
+	 *another core read it in the meantime
+	 * EVICT : the core's cache evicted the line
+	 **/
+	enum RequestType
+	{
+		READ,
+		WRITE,
+		UPGRADE,
+		MODIFY,
+		EVICT
+	};
+
+	struct Request
+	{
+		uint64_t time;
+		address_t line;
+		RequestType type;
+	};
+
+	// cores holding a line, dirty when the only one holding it modified it
+	struct LineState
+	{
+		uint64_t sharers;
+		bool dirty;
+	};
+
+	struct Core
+	{
+		std::unique_ptr<CacheBase> cache;
+		const StackTrace *trace{nullptr};
+		size_t next{};
+		// instruction count of the core
+		uint64_t clock{};
+		AccessCounts counts{};
+		// requests of the current epoch, in order
+		std::vector<Request> requests;
+		// lines the core holds alone as far as it knows in the current epoch,
+		// and whether it modified them
+		std::unordered_map<address_t, bool> exclusive;
+		// time of the last miss that filled each line in the current epoch
+		std::unordered_map<address_t, uint64_t> filled;
+		// lines another core invalidated since this core last held them
+		std::unordered_set<address_t> invalidated;
+		CoreResults stats{};
+	};
+
+	const CacheConf cache_conf_;
+	const CoherenceProtocol protocol_;
+	const uint64_t epoch_length_;
+	const size_t threads_;
+	std::vector<Core> cores_;
+	std::unordered_map<address_t, LineState> directory_;
+
+	address_t get_line(address_t address) const
+	{
+		return cores_.front().cache->get_block_address(address);
+	};
+
+	// simulate the accesses of core c before end against its own cache
+	void RunEpoch(size_t c, uint64_t end);
+
+	// apply every queued request to the directory and the other caches
+	void ResolveEpoch();
+
+	// the copies other cores hold of a line core c writes at time are
+	// invalidated
+	void Invalidate(size_t c,
+					address_t line,
+					uint64_t time,
+					LineState &state);
+
+	// true once every core reached the end of its trace
+	bool is_done() const;
+
+public:
+	/**
+	 * @param cores private caches, one per trace, at most 64
+	 * @param epoch_length instructions between barriers
+	 * @param threads 0 runs each core on its own thread
+	 **/
+	CoherentSimulator(CacheConf cache_conf,
+					  size_t cores,
+					  CoherenceProtocol protocol = SNOOP,
+					  uint64_t epoch_length = 1000,
+					  size_t threads = 0);
+
+	/**
+	 * @brief simulate trace i on core i, the caches start flushed
+	 **/
+	CoherentResults SimulateTraces(
+		const std::vector<std::reference_wrapper<const StackTrace>> &traces);
+
+	CacheConf get_cache_config() const
+	{
+		return cache_conf_;
+	};
+};
@@ -0,0 +1,325 @@
+/**
+ * filename: event_stream.cpp
+ *
+ * description: writing and reading the per access hit and miss event stream
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "event_stream.hpp"
+
+#include <algorithm>
+
+#include "binary_io.hpp"
+
+namespace
+{
+// "CSEV" read as a little endian word
+constexpr uint32_t kEventMagic{0x56455343};
+constexpr uint16_t kEventVersion{1};
+constexpr uint16_t kHasVictims{1};
+
+// laid out without padding so they can be written as is
+struct FileHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t flags;
+	uint32_t block_size;
+	uint32_t offset_size;
+};
+
+struct BlockHeader
+{
+	uint64_t first_access;
+	uint32_t accesses;
+	uint32_t misses;
+	uint32_t runs_bytes;
+	uint32_t victims_bytes;
+};
+
+struct Footer
+{
+	uint64_t index_offset;
+	uint64_t blocks;
+	uint64_t accesses;
+	uint32_t magic;
+	uint32_t reserved;
+};
+
+static_assert(sizeof(EventBlockIndex) == 24);
+static_assert(sizeof(BlockHeader) == 24);
+static_assert(sizeof(Footer) == 32);
+
+// read a varint, false if it runs past the end
+bool Pull(const std::string &bytes, size_t &pos, uint64_t &v)
+{
+	v = 0;
+	for (uint_fast8_t shift{}; pos < bytes.size() && shift < 64; shift += 7)
+	{
+		const auto byte{static_cast<uint8_t>(bytes[pos++])};
+		v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+}  // namespace
+
+EventStreamWriter::EventStreamWriter(const std::string &path,
+									 bool victims,
+									 uint_fast8_t offset_size,
+									 uint32_t block_size)
+	: file_{path, std::ios::binary | std::ios::trunc},
+	  victims_{victims},
+	  block_size_{std::max(block_size, 1u)},
+	  offset_size_{offset_size},
+	  offset_{sizeof(FileHeader)}
+{
+	if (!file_)
+		return;
+
+	BinaryIO::Write(file_,
+					FileHeader{.magic = kEventMagic,
+							   .version = kEventVersion,
+							   .flags = victims_ ? kHasVictims : uint16_t{0},
+							   .block_size = block_size_,
+							   .offset_size = offset_size_});
+	writer_ = std::jthread{[this] { Write(); }};
+}
+
+EventStreamWriter::~EventStreamWriter()
+{
+	Close();
+}
+
+void EventStreamWriter::FinishBlock()
+{
+	if (block_accesses_ == 0)
+		return;
+	Push(runs_, run_length_);
+
+	const BlockHeader header{
+		.first_access = accesses_,
+		.accesses = block_accesses_,
+		.misses = block_misses_,
+		.runs_bytes = static_cast<uint32_t>(runs_.size()),
+		.victims_bytes = static_cast<uint32_t>(victim_bytes_.size())};
+	index_.push_back({.first_access = accesses_,
+					  .offset = offset_,
+					  .accesses = block_accesses_,
+					  .misses = block_misses_});
+
+	std::string block;
+	block.reserve(sizeof(header) + runs_.size() + victim_bytes_.size());
+	block.append(reinterpret_cast<const char *>(&header), sizeof(header));
+	block += runs_;
+	block += victim_bytes_;
+	offset_ += block.size();
+	accesses_ += block_accesses_;
+
+	{
+		std::lock_guard lock{mutex_};
+		queue_.push_back(std::move(block));
+	}
+	cv_.notify_one();
+
+	runs_.clear();
+	victim_bytes_.clear();
+	run_hit_ = true;
+	run_length_ = 0;
+	block_accesses_ = 0;
+	block_misses_ = 0;
+	last_victim_ = 0;
+}
+
+void EventStreamWriter::Write()
+{
+	std::unique_lock lock{mutex_};
+	while (true)
+	{
+		cv_.wait(lock, [this] { return !queue_.empty() || closing_; });
+		if (queue_.empty())
+			return;
+
+		auto block{std::move(queue_.front())};
+		queue_.pop_front();
+		// the simulation keeps encoding while the block is written
+		lock.unlock();
+		file_.write(block.data(), static_cast<std::streamsize>(block.size()));
+		lock.lock();
+	}
+}
+
+bool EventStreamWriter::Close()
+{
+	if (!writer_.joinable())
+		return false;
+
+	FinishBlock();
+	{
+		std::lock_guard lock{mutex_};
+		closing_ = true;
+	}
+	cv_.notify_one();
+	writer_.join();
+
+	file_.write(reinterpret_cast<const char *>(index_.data()),
+				static_cast<std::streamsize>(index_.size() *
+											 sizeof(EventBlockIndex)));
+	BinaryIO::Write(file_,
+					Footer{.index_offset = offset_,
+						   .blocks = index_.size(),
+						   .accesses = accesses_,
+						   .magic = kEventMagic,
+						   .reserved = 0});
+	file_.close();
+	return !file_.fail();
+}
+
+std::unique_ptr<EventStreamReader> EventStreamReader::Open(
+	const std::string &path)
+{
+	std::unique_ptr<EventStreamReader> reader{new EventStreamReader{}};
+	auto &file{reader->file_};
+	file.open(path, std::ios::binary);
+	if (!file)
+		return nullptr;
+
+	FileHeader header;
+	if (!BinaryIO::Read(file, header) || header.magic != kEventMagic ||
+		header.version != kEventVersion)
+		return nullptr;
+
+	Footer footer;
+	file.seekg(-static_cast<std::streamoff>(sizeof(Footer)), std::ios::end);
+	const auto footer_offset{static_cast<uint64_t>(file.tellg())};
+	if (!BinaryIO::Read(file, footer) || footer.magic != kEventMagic ||
+		footer.index_offset + footer.blocks * sizeof(EventBlockIndex) !=
+			footer_offset)
+		return nullptr;
+
+	reader->index_.resize(footer.blocks);
+	file.seekg(static_cast<std::streamoff>(footer.index_offset));
+	file.read(reinterpret_cast<char *>(reader->index_.data()),
+			  static_cast<std::streamsize>(footer.blocks *
+										   sizeof(EventBlockIndex)));
+	if (!file)
+		return nullptr;
+
+	reader->victims_ = header.flags & kHasVictims;
+	reader->offset_size_ = static_cast<uint_fast8_t>(header.offset_size);
+	reader->accesses_ = footer.accesses;
+	return reader;
+}
+
+bool EventStreamReader::DecodeBlock(size_t b,
+									uint64_t first,
+									uint64_t last,
+									std::vector<AccessResult> &out)
+{
+	const auto &entry{index_[b]};
+	BlockHeader header;
+	file_.clear();
+	file_.seekg(static_cast<std::streamoff>(entry.offset));
+	if (!BinaryIO::Read(file_, header) ||
+		header.first_access != entry.first_access ||
+		header.accesses != entry.accesses)
+		return false;
+
+	std::string runs(header.runs_bytes, '\0');
+	std::string victims(header.victims_bytes, '\0');
+	file_.read(runs.data(), static_cast<std::streamsize>(runs.size()));
+	file_.read(victims.data(), static_cast<std::streamsize>(victims.size()));
+	if (!file_)
+		return false;
+
+	size_t run_pos{};
+	size_t victim_pos{};
+	uint64_t access{entry.first_access};
+	const uint64_t end{std::min(last, entry.first_access + entry.accesses)};
+	address_t last_victim{};
+	bool hit{true};
+	uint64_t length;
+	while (access < end)
+	{
+		if (!Pull(runs, run_pos, length))
+			return false;
+
+		for (; length > 0 && access < end; length--, access++)
+		{
+			AccessResult ar{.hit = hit};
+			// victims are decoded from the block start so the deltas add up
+			if (!hit && victims_)
+			{
+				uint64_t v;
+				if (!Pull(victims, victim_pos, v))
+					return false;
+				if (v != 0)
+				{
+					v--;
+					const auto zigzag{static_cast<uint32_t>(v >> 1)};
+					last_victim += (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+					ar.evicted = true;
+					ar.victim = {.block_address = static_cast<address_t>(
+									 last_victim << offset_size_),
+								 .dirty = static_cast<bool>(v & 1)};
+				}
+			}
+			if (access >= first)
+				out.push_back(ar);
+		}
+		hit = !hit;
+	}
+	return true;
+}
+
+std::vector<AccessResult> EventStreamReader::Read(uint64_t first,
+												  uint64_t count)
+{
+	std::vector<AccessResult> out;
+	const uint64_t last{std::min(accesses_, first + count)};
+	if (first >= last)
+		return out;
+	out.reserve(last - first);
+
+	// the block holding first
+	auto it{std::upper_bound(
+		index_.begin(),
+		index_.end(),
+		first,
+		[](uint64_t a, const EventBlockIndex &e) { return a < e.first_access; })};
+	for (auto b{static_cast<size_t>(it - index_.begin()) - 1};
+		 b < index_.size() && index_[b].first_access < last;
+		 b++)
+		if (!DecodeBlock(b, first, last, out))
+			return {};
+
+	return out;
+}
+
+uint64_t EventStreamReader::CountMisses(uint64_t first, uint64_t count)
+{
+	const uint64_t last{std::min(accesses_, first + count)};
+	uint64_t misses{};
+	for (size_t b{}; b < index_.size(); b++)
+	{
+		const auto &e{index_[b]};
+		const uint64_t end{e.first_access + e.accesses};
+		if (end <= first || e.first_access >= last)
+			continue;
+		if (e.first_access >= first && end <= last)
+		{
+			misses += e.misses;
+			continue;
+		}
+
+		// a block cut by the interval is decoded
+		std::vector<AccessResult> part;
+		if (!DecodeBlock(b, std::max(first, e.first_access), last, part))
+			return 0;
+		misses += static_cast<uint64_t>(std::count_if(
+			part.begin(), part.end(), [](const auto &ar) { return !ar.hit; }));
+	}
+	return misses;
+}
@@ -0,0 +1,201 @@
+/**
+ * filename: event_stream.hpp
+ *
+ * description: header file for the per access hit and miss event stream
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cache_block.hpp"
+
+/**
+ * @brief an entry of the index at the end of an event stream file
+ **/
+struct EventBlockIndex
+{
+	uint64_t first_access;
+	uint64_t offset;
+	uint32_t accesses;
+	uint32_t misses;
+};
+
+/**
+ * @brief writes the outcome of every access to a file
+ * @description Accesses are grouped into blocks of block_size accesses. A
+ *block holds the lengths of its alternating runs of hits and misses as
+ *varints, starting with a run of hits, then optionally the victim of every
+ *miss as a varint of the zigzag block delta to the previous victim with its
+ *dirty bit, or 0 when nothing was evicted. Each block decodes on its own. The
+ *file ends with an index of the blocks, so a reader can jump to any access.
+ *Full blocks are written by a background thread, Record never waits on the
+ *disk.
+ **/
+class EventStreamWriter
+{
+private:
+	std::ofstream file_;
+	const bool victims_;
+	const uint32_t block_size_;
+	const uint_fast8_t offset_size_;
+
+	// the block being encoded
+	std::string runs_;
+	std::string victim_bytes_;
+	bool run_hit_{true};
+	uint64_t run_length_{};
+	uint32_t block_accesses_{};
+	uint32_t block_misses_{};
+	address_t last_victim_{};
+
+	uint64_t accesses_{};
+	uint64_t offset_;
+	std::vector<EventBlockIndex> index_;
+
+	// encoded blocks waiting for the writer thread
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<std::string> queue_;
+	bool closing_{false};
+	std::jthread writer_;
+
+	void FinishBlock();
+	void Write();
+
+public:
+	/**
+	 * @param victims also record the block evicted by each miss
+	 * @param offset_size bits of the block offset, victims are stored as
+	 *block numbers
+	 **/
+	EventStreamWriter(const std::string &path,
+					  bool victims,
+					  uint_fast8_t offset_size,
+					  uint32_t block_size = 1 << 16);
+
+	// closes the file if Close was not called
+	~EventStreamWriter();
+
+	// false if the file could not be opened
+	bool is_open() const
+	{
+		return file_.is_open();
+	};
+
+	void Record(const AccessResult &ar)
+	{
+		if (ar.hit != run_hit_)
+		{
+			Push(runs_, run_length_);
+			run_hit_ = ar.hit;
+			run_length_ = 0;
+		}
+		run_length_++;
+
+		if (!ar.hit)
+		{
+			block_misses_++;
+			if (victims_)
+				RecordVictim(ar);
+		}
+
+		if (++block_accesses_ == block_size_) [[unlikely]]
+			FinishBlock();
+	};
+
+	/**
+	 * @brief write the last block and the index, and wait for the file
+	 * @return false if writing failed
+	 **/
+	bool Close();
+
+	// append a varint
+	static void Push(std::string &bytes, uint64_t v)
+	{
+		for (; v >= 0x80; v >>= 7)
+			bytes.push_back(static_cast<char>(v | 0x80));
+		bytes.push_back(static_cast<char>(v));
+	};
+
+private:
+	void RecordVictim(const AccessResult &ar)
+	{
+		if (!ar.evicted)
+		{
+			Push(victim_bytes_, 0);
+			return;
+		}
+		const address_t block{
+			static_cast<address_t>(ar.victim.block_address >> offset_size_)};
+		const uint32_t delta{block - last_victim_};
+		// zigzag the delta so small negative strides stay small
+		const uint32_t zigzag{(delta << 1) ^ (0u - (delta >> 31))};
+		Push(victim_bytes_,
+			 (static_cast<uint64_t>(zigzag) << 1 | ar.victim.dirty) + 1);
+		last_victim_ = block;
+	};
+};
+
+/**
+ * @brief reads the outcomes written by an EventStreamWriter
+ * @description Only the blocks holding the requested accesses are decoded.
+ **/
+class EventStreamReader
+{
+private:
+	std::ifstream file_;
+	bool victims_;
+	uint_fast8_t offset_size_;
+	uint64_t accesses_;
+	std::vector<EventBlockIndex> index_;
+
+	EventStreamReader() = default;
+
+	// decode block b, appending the outcomes from its access first onwards
+	bool DecodeBlock(size_t b,
+					 uint64_t first,
+					 uint64_t last,
+					 std::vector<AccessResult> &out);
+
+public:
+	// nullptr if the file is missing, damaged or was not closed
+	static std::unique_ptr<EventStreamReader> Open(const std::string &path);
+
+	uint64_t get_access_count() const
+	{
+		return accesses_;
+	};
+
+	bool has_victims() const
+	{
+		return victims_;
+	};
+
+	const std::vector<EventBlockIndex> &get_index() const
+	{
+		return index_;
+	};
+
+	/**
+	 * @brief outcomes of the accesses [first, first + count), the victims are
+	 *only set when the stream has them
+	 **/
+	std::vector<AccessResult> Read(uint64_t first, uint64_t count);
+
+	/**
+	 * @brief misses among the accesses [first, first + count), blocks that
+	 *are wholly inside come from the index without decoding
+	 **/
+	uint64_t CountMisses(uint64_t first, uint64_t count);
+};
@@ -9,33 +9,86 @@
 #include "fifo_cache.hpp"
 
 // Fifo
-bool FifoCache::AccessMemory(const address_t& address, const bool& is_read)
+AccessResult FifoCache::Access(const address_t& address, const bool& is_read)
 {
-	bool hit{true};
+	auto& ci{Index(address)};
 
-	const auto index{get_index(address)};
+	const auto it{ci.map.find(cache_block_t{address, false})};
 
-	const auto it{cache_[index].map.find(cache_block_t{address, is_read})};
+	// in cache
+	if (it != ci.map.end())
+	{
+		// a write hit on a write-back cache leaves the block dirty
+		if (!is_read && is_write_allocate_)
+			(*it)->dirty = true;
+		return {.hit = true};
+	}
+
+	// if we have a miss a write with a no-write allocate cache then we
+	// return here without adding the block to the cache
+	if (!is_read && !is_write_allocate_)
+		return {.hit = false};
+
+	return Insert(address, !is_read);
+};
+
+AccessResult FifoCache::Fill(const address_t& address, const bool& dirty)
+{
+	auto& ci{Index(address)};
+
+	const auto it{ci.map.find(cache_block_t{address, false})};
+
+	if (it != ci.map.end())
+	{
+		(*it)->dirty |= dirty;
+		return {.hit = true};
+	}
+
+	return Insert(address, dirty);
+};
+
+std::optional<cache_block_t> FifoCache::Invalidate(const address_t& address)
+{
+	auto& ci{Index(address)};
+
+	const auto it{ci.map.find(cache_block_t{address, false})};
+
+	if (it == ci.map.end())
+		return {};
+
+	const auto pos{*it};
+	const cache_block_t cb{*pos};
+	ci.map.erase(it);
+	ci.list.erase(pos);
+
+	// erasing from the middle of the buffer shifts the blocks behind it, so
+	// the iterators held by the map have to be rebuilt
+	ci.map.clear();
+	for (auto i{ci.list.begin()}; i != ci.list.end(); ++i)
+		ci.map.insert(i);
+
+	return cb;
+};
+
+AccessResult FifoCache::Insert(const address_t& address, const bool& dirty)
+{
+	AccessResult ar{.hit = false};
+
+	auto& ci{Index(address)};
 
-	// not in cache
-	if (it == cache_[index].map.end())
+	// map is full
+	if (ci.map.size() == associativity_)
 	{
-		hit = false;
-
-		// if we have a miss a write with a no-write allocate cache then we
-		// return here without adding the block to the cache
-		if (!is_read && !is_write_allocate_)
-			return hit;
-
-		// map is full
-		if (cache_[index].map.size() == associativity_)
-			// remove the element from the back of the map
-			cache_[index].map.erase(std::prev(cache_[index].list.end()));
-		// add the block address to the map, this overwrites the first element
-		// if full
-		cache_[index].list.push_front({address, is_read});
-		cache_[index].map.insert(cache_[index].list.begin());
+		const auto back{std::prev(ci.list.end())};
+		ar.evicted = true;
+		ar.victim = *back;
+		// remove the element from the back of the map
+		ci.map.erase(back);
 	}
+	// add the block address to the map, this overwrites the last element
+	// if full
+	ci.list.push_front({address, dirty});
+	ci.map.insert(ci.list.begin());
 
-	return hit;
+	return ar;
 };
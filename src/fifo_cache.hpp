@@ -16,5 +16,11 @@ class FifoCache : public Cache<boost::circular_buffer<cache_block_t>>
 {
 public:
 	FifoCache(CacheConf cc) : Cache(cc){};
-	bool AccessMemory(const address_t &address, const bool &read) override;
+	AccessResult Access(const address_t &address, const bool &read) override;
+	AccessResult Fill(const address_t &address, const bool &dirty) override;
+	std::optional<cache_block_t> Invalidate(const address_t &address) override;
+
+private:
+	// push a block that is not in the cache onto the front of its index
+	AccessResult Insert(const address_t &address, const bool &dirty);
 };
@@ -0,0 +1,265 @@
+/**
+ * filename: line_trace.cpp
+ *
+ * description: traces of dense line IDs and the engines that run on them
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "line_trace.hpp"
+
+#include <algorithm>
+#include <boost/unordered/concurrent_flat_map.hpp>
+#include <limits>
+#include <queue>
+#include <thread>
+#include <utility>
+
+#include "cache_factory.hpp"
+
+namespace
+{
+constexpr uint32_t kNone{std::numeric_limits<uint32_t>::max()};
+constexpr uint64_t kNever{std::numeric_limits<uint64_t>::max()};
+
+// run f(chunk, first, last) on equal parts of [0, size) on their own threads
+template <typename F>
+void ForChunks(size_t size, size_t threads, F f)
+{
+	std::vector<std::jthread> workers;
+	for (size_t t{}; t < threads; ++t)
+		workers.emplace_back(
+			f, t, size * t / threads, size * (t + 1) / threads);
+}
+
+/**
+ * @brief a fully associative LRU cache of line IDs, a doubly linked list in
+ *arrays indexed by ID
+ **/
+class ShadowCache
+{
+private:
+	const uint64_t capacity_;
+	uint64_t size_{};
+	std::vector<uint32_t> prev_;
+	std::vector<uint32_t> next_;
+	std::vector<bool> present_;
+	// most and least recently used
+	uint32_t head_{kNone};
+	uint32_t tail_{kNone};
+
+	void Unlink(uint32_t id)
+	{
+		(prev_[id] == kNone ? head_ : next_[prev_[id]]) = next_[id];
+		(next_[id] == kNone ? tail_ : prev_[next_[id]]) = prev_[id];
+	};
+
+	void PushFront(uint32_t id)
+	{
+		prev_[id] = kNone;
+		next_[id] = head_;
+		(head_ == kNone ? tail_ : prev_[head_]) = id;
+		head_ = id;
+	};
+
+public:
+	ShadowCache(uint64_t capacity, size_t lines)
+		: capacity_{capacity},
+		  prev_(lines, kNone),
+		  next_(lines, kNone),
+		  present_(lines)
+	{}
+
+	// true on a hit, the line is the most recently used after either
+	bool Access(uint32_t id)
+	{
+		if (present_[id])
+		{
+			Unlink(id);
+			PushFront(id);
+			return true;
+		}
+
+		if (size_ == capacity_)
+		{
+			const auto victim{tail_};
+			Unlink(victim);
+			present_[victim] = false;
+			size_--;
+		}
+		present_[id] = true;
+		PushFront(id);
+		size_++;
+		return false;
+	};
+};
+
+// misses of a fully associative cache of capacity lines with Belady's
+// replacement, evicting the line used furthest in the future
+uint64_t OptMisses(const LineTrace &lt, uint64_t capacity)
+{
+	const auto &accesses{lt.accesses};
+
+	// next access to the same line of every access
+	std::vector<uint64_t> next_use(accesses.size());
+	std::vector<uint64_t> upcoming(lt.lines.size(), kNever);
+	for (size_t i{accesses.size()}; i-- > 0;)
+	{
+		const auto id{accesses[i].get_id()};
+		next_use[i] = upcoming[id];
+		upcoming[id] = i;
+	}
+
+	// the heap holds stale entries, an entry is current when its next use
+	// is still the next use of its line
+	std::vector<uint64_t> current(lt.lines.size(), kNever);
+	std::vector<bool> present(lt.lines.size());
+	std::priority_queue<std::pair<uint64_t, uint32_t>> furthest;
+	uint64_t size{};
+	uint64_t misses{};
+	for (size_t i{}; i < accesses.size(); ++i)
+	{
+		const auto id{accesses[i].get_id()};
+		if (!present[id])
+		{
+			misses++;
+			if (size == capacity)
+			{
+				while (true)
+				{
+					const auto [use, victim]{furthest.top()};
+					furthest.pop();
+					if (present[victim] && current[victim] == use)
+					{
+						present[victim] = false;
+						break;
+					}
+				}
+				size--;
+			}
+			present[id] = true;
+			size++;
+		}
+		current[id] = next_use[i];
+		furthest.emplace(next_use[i], id);
+	}
+	return misses;
+}
+}  // namespace
+
+namespace LineTraces
+{
+LineTrace Intern(const StackTrace &st,
+				 uint_fast8_t offset_size,
+				 size_t threads)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	// every thread gets at least a few pages of the trace
+	threads = std::max<size_t>(1, std::min(threads, st.size() / 4096));
+
+	// first access of every line
+	boost::concurrent_flat_map<address_t, uint64_t> ids;
+	ForChunks(st.size(),
+			  threads,
+			  [&](size_t, size_t first, size_t last)
+			  {
+				  // runs of the same line only touch the map once
+				  address_t previous{};
+				  for (size_t i{first}; i < last; ++i)
+				  {
+					  const address_t line{st[i].address >> offset_size};
+					  if (i != first && line == previous)
+						  continue;
+					  previous = line;
+					  ids.emplace_or_visit(line,
+										   i,
+										   [i](auto &kv) {
+											   kv.second =
+												   std::min(kv.second, i);
+										   });
+				  }
+			  });
+
+	// IDs in first touch order
+	std::vector<std::pair<uint64_t, address_t>> firsts;
+	firsts.reserve(ids.size());
+	ids.visit_all([&](auto &kv) { firsts.emplace_back(kv.second, kv.first); });
+	std::ranges::sort(firsts);
+
+	LineTrace lt{.offset_size = offset_size,
+				 .lines = {},
+				 .accesses = std::vector<LineAccess>(st.size()),
+				 .instructions = 0};
+	lt.lines.reserve(firsts.size());
+	for (const auto &first : firsts)
+	{
+		const auto id{lt.lines.size()};
+		ids.visit(first.second, [id](auto &kv) { kv.second = id; });
+		lt.lines.push_back(first.second);
+	}
+
+	std::vector<uint64_t> instructions(threads);
+	ForChunks(st.size(),
+			  threads,
+			  [&](size_t chunk, size_t first, size_t last)
+			  {
+				  address_t previous{};
+				  uint32_t id{};
+				  uint64_t count{};
+				  for (size_t i{first}; i < last; ++i)
+				  {
+					  const address_t line{st[i].address >> offset_size};
+					  if (i == first || line != previous)
+					  {
+						  ids.cvisit(line,
+									 [&id](const auto &kv) {
+										 id = static_cast<uint32_t>(kv.second);
+									 });
+						  previous = line;
+					  }
+					  lt.accesses[i].packed = id << 1 | st[i].is_read;
+					  count += st[i].last_memory_access_count + 1u;
+				  }
+				  instructions[chunk] = count;
+			  });
+	for (const auto count : instructions)
+		lt.instructions += count;
+	return lt;
+}
+
+MissClasses ClassifyMisses(const LineTrace &lt, const CacheConf &cc)
+{
+	auto cache{CacheFactory::CreateCache(cc)};
+	const uint64_t capacity{cc.cache_size_ / cc.line_size_};
+	ShadowCache shadow{capacity, lt.lines.size()};
+
+	MissClasses mc{.accesses = lt.accesses.size(),
+				   .misses = 0,
+				   .compulsory = 0,
+				   .capacity = 0,
+				   .conflict = 0,
+				   .opt_misses = OptMisses(lt, capacity)};
+	// lines touched so far, the next new line has this ID
+	uint32_t seen{};
+	for (const auto &la : lt.accesses)
+	{
+		const auto id{la.get_id()};
+		const bool hit{cache->AccessMemory(lt.get_address(id), la.is_read())};
+		const bool shadow_hit{shadow.Access(id)};
+		const bool first_touch{id == seen};
+		seen += first_touch;
+		if (hit)
+			continue;
+
+		mc.misses++;
+		if (first_touch)
+			mc.compulsory++;
+		else if (!shadow_hit)
+			mc.capacity++;
+		else
+			mc.conflict++;
+	}
+	return mc;
+}
+}  // namespace LineTraces
@@ -0,0 +1,95 @@
+/**
+ * filename: line_trace.hpp
+ *
+ * description: header file for traces of dense line IDs and the engines that
+ *run on them
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief an access to a line by its dense ID, half the size of a MemoryAccess
+ **/
+struct LineAccess
+{
+	// ID << 1 | is_read
+	uint32_t packed;
+
+	uint32_t get_id() const
+	{
+		return packed >> 1;
+	};
+
+	bool is_read() const
+	{
+		return packed & 1;
+	};
+};
+
+/**
+ * @brief a trace of one line size with every line replaced by a dense ID
+ * @description IDs are handed out in the order lines are first touched, so an
+ *access is the first touch of its line exactly when its ID is the number of
+ *lines seen before it. Engines keep their per line state in arrays indexed by
+ *ID instead of hash tables keyed by address. The instruction gaps between
+ *accesses are only kept as their total.
+ **/
+struct LineTrace
+{
+	uint_fast8_t offset_size;
+	// line address of every ID
+	std::vector<address_t> lines;
+	std::vector<LineAccess> accesses;
+	// instructions of the whole trace, as counted by SimulateTrace
+	uint64_t instructions;
+
+	address_t get_address(uint32_t id) const
+	{
+		return lines[id] << offset_size;
+	};
+};
+
+/**
+ * @brief misses of a cache split by their cause
+ * @description compulsory : first touch of the line
+ * capacity : a fully associative LRU cache of the same size missed as well
+ * conflict : the fully associative cache hit
+ * opt_misses are the misses of a fully associative cache of the same size
+ *with Belady's optimal replacement, a lower bound for any replacement policy
+ **/
+struct MissClasses
+{
+	uint64_t accesses;
+	uint64_t misses;
+	uint64_t compulsory;
+	uint64_t capacity;
+	uint64_t conflict;
+	uint64_t opt_misses;
+};
+
+namespace LineTraces
+{
+/**
+ * @brief intern the lines of st, offset_size bits of each address are the
+ *line offset
+ * @param threads 0 uses one per hardware thread
+ * @description The trace is split between the threads, which share one
+ *concurrent hash map from line to ID. It is only needed while interning.
+ **/
+LineTrace Intern(const StackTrace &st,
+				 uint_fast8_t offset_size,
+				 size_t threads = 0);
+
+/**
+ * @brief simulate a cache on a line trace of its line size, and classify
+ *every miss
+ **/
+MissClasses ClassifyMisses(const LineTrace &lt, const CacheConf &cc);
+}  // namespace LineTraces
@@ -12,6 +12,8 @@
 #include <matplot/matplot.h>
 
 #include <algorithm>
+#include <bit>
+#include <charconv>
 #include <boost/program_options.hpp>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/parsers.hpp>
@@ -21,11 +23,30 @@
 #include <fstream>
 #include <future>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <mutex>
 #include <ranges>
+#include <sstream>
 #include <thread>
 
+#include "address_map.hpp"
+#include "cache_hierarchy.hpp"
 #include "cache_sim.hpp"
+#include "characterize.hpp"
+#include "coherent_sim.hpp"
+#include "event_stream.hpp"
+#include "line_trace.hpp"
+#include "numa.hpp"
+#include "perf_counters.hpp"
+#include "progress.hpp"
+#include "result_cache.hpp"
+#include "shared_cache_sim.hpp"
+#include "results_table.hpp"
+#include "shm_ring.hpp"
+#include "sim_server.hpp"
+#include "thread_pool.hpp"
+#include "trace_stages.hpp"
 #include "util.hpp"
 
 namespace po = boost::program_options;
@@ -34,8 +55,39 @@ void CreateOutputFiles(
 	std::map<std::string, std::map<std::string, Results>> &results_map,
 	std::string &output_folder);
 
+void CreateResultsTable(
+	std::map<std::string, std::map<std::string, Results>> &results_map,
+	std::map<std::string, CacheConf> &result_confs,
+	ResultsTable::Format format,
+	std::string &output_folder);
+
 void CreateOutputImages(
 	std::map<std::string, std::map<std::string, Results>> &results_map,
+	std::string &output_folder,
+	ThreadPool &pool);
+
+void CreateHierarchyOutputFiles(
+	std::map<std::string, std::map<std::string, HierarchyResults>>
+		&hierarchy_results_map,
+	std::string &output_folder);
+
+void CreateSharedOutputFiles(
+	std::map<std::string, SharedResults> &shared_results_map,
+	std::vector<std::string> &source_names,
+	std::string &output_folder);
+
+void CreateCoherentOutputFiles(
+	std::map<std::string, CoherentResults> &coherent_results_map,
+	std::vector<std::string> &core_names,
+	std::string &output_folder);
+
+void PrintProfile(
+	std::vector<std::pair<std::string, std::optional<PerfSample>>> &phases,
+	std::vector<std::pair<std::string, std::optional<PerfSample>>> &sims,
+	std::vector<uint64_t> &sim_accesses);
+
+void CreateClassesOutputFiles(
+	std::map<std::string, std::map<std::string, MissClasses>> &classes_map,
 	std::string &output_folder);
 
 int main(int argc, char **argv)
@@ -48,8 +100,60 @@ int main(int argc, char **argv)
 	std::vector<std::pair<CacheConf, std::string>> cc_arr;
 	// Cache Sims
 	std::vector<std::pair<CacheSimulator, std::string>> cs_arr;
+	// Trace simulated by every cache sim before the stack traces
+	std::optional<StackTrace> warmup_trace;
+	// Snapshot of each cache sim restored before every stack trace, empty to
+	// start every stack trace with a flushed cache
+	std::vector<std::string> warm_states;
 	// [Stack trace][Cache config] results
 	std::map<std::string, std::map<std::string, Results>> results_map;
+	// First level shared by every hierarchy. <config,name>
+	std::optional<std::pair<CacheConf, std::string>> l1_conf;
+	// Levels below the first level. <configs,name>
+	std::vector<std::pair<std::vector<CacheConf>, std::string>> lower_arr;
+	InclusionPolicy inclusion_policy{NON_INCLUSIVE};
+	// Prefetcher put in front of every cache sim
+	std::optional<PrefetchConf> prefetch_conf;
+	// TLB put beside every cache sim
+	std::optional<TlbConf> tlb_conf;
+	// Estimate the cache sim results from intervals of each trace
+	std::optional<SamplingConf> sampling_conf;
+	// Estimate the cache sim results from 1 / 2^bits of the sets
+	std::optional<uint_fast8_t> set_sample_bits;
+	// Set sample filters of each trace, shared by the configs with the same
+	// index bits
+	std::map<IndexBits, std::vector<SetSampleFilter>> set_filters;
+	// Counts of earlier runs, and the content hash of each trace to find them
+	std::optional<ResultCache> result_cache;
+	std::vector<uint64_t> trace_hashes;
+	// Ring a producer process streams accesses into, read by every cache sim
+	std::unique_ptr<ShmRing> ring;
+	std::string ring_trace;
+	// NUMA nodes the cache sims are pinned to, empty when they are not pinned
+	std::vector<NumaNode> numa_nodes;
+	// [Node][Stack trace] copy of every trace local to each node, empty with
+	// one node
+	std::vector<std::vector<StackTrace>> trace_replicas;
+	// Ways of a shared cache given to each trace, empty to share every way
+	std::vector<uint_fast8_t> way_partition;
+	InterleavePolicy interleave_policy{ROUND_ROBIN};
+	// [Cache config] results of every trace sharing one cache
+	std::map<std::string, SharedResults> shared_results_map;
+	// [Cache config] results of every trace on its own core, with a private
+	// copy of the cache kept coherent
+	std::map<std::string, CoherentResults> coherent_results_map;
+	// [Stack trace][Hierarchy] results
+	std::map<std::string, std::map<std::string, HierarchyResults>>
+		hierarchy_results_map;
+	// [Line offset bits] every trace interned once per line size
+	std::map<uint_fast8_t, std::vector<std::shared_future<LineTrace>>>
+		line_traces;
+	// [Stack trace][Cache config] misses by cause
+	std::map<std::string, std::map<std::string, MissClasses>> classes_map;
+	// Lazy stages every stack trace passes through on its way to the cache sims
+	std::vector<Stage> stages;
+	// Simulate the stack traces as one trace, "concat" or "interleave"
+	std::optional<std::string> combine;
 
 	/************************
 	 * Command line options *
@@ -64,7 +168,56 @@ int main(int argc, char **argv)
 	desc.add_options()("help,h", "Help prompt")
 		("stack-trace,s", po::value<std::vector<std::string>>()->multitoken()->composing(), "Stack Trace files")
 		("cache-conf,c", po::value<std::vector<std::string>>()->multitoken()->composing(), "Cache Configuration files")
-		("output-folder,o", po::value<std::string>(), "Output Folder, defaults to '$CWD/output/'");
+		("output-folder,o", po::value<std::string>(), "Output Folder, defaults to '$CWD/output/'")
+		("replacement-seed", po::value<unsigned int>(), "Seed of the random replacement of every Cache Config, instead of the seed in its file or 0")
+		("l1-conf", po::value<std::string>(), "First level Cache Configuration file shared by every hierarchy")
+		("lower-levels", po::value<std::vector<std::string>>()->multitoken()->composing(), "Comma separated Cache Configuration files below the first level, one hierarchy per argument")
+		("inclusion", po::value<std::string>()->default_value("non-inclusive"), "Hierarchy inclusion policy: inclusive, exclusive or non-inclusive")
+		("prefetcher", po::value<std::string>(), "Prefetcher in front of every cache: next-line, stride or stream")
+		("prefetch-degree", po::value<unsigned int>()->default_value(1), "Blocks prefetched per trigger")
+		("prefetch-distance", po::value<unsigned int>()->default_value(1), "Blocks between the trigger and the first prefetch")
+		("prefetch-table", po::value<unsigned int>()->default_value(16), "Stride table or stream tracker entries")
+		("mshrs", po::value<unsigned int>(), "Time every cache as a non-blocking cache with this many MSHRs")
+		("tlb-conf", po::value<std::string>(), "TLB Configuration file, the TLB is put beside every cache")
+		("victim-cache", po::value<unsigned int>(), "Put a fully associative victim cache of this many blocks behind every cache")
+		("victim-latency", po::value<unsigned int>()->default_value(1), "Cycles to swap a block back from the victim cache")
+		("write-buffer", po::value<unsigned int>(), "Put a coalescing write buffer of this many lines between every cache and memory")
+		("write-buffer-drain", po::value<unsigned int>(), "Cycles to write one line of the write buffer to memory, defaults to the miss penalty of each cache")
+		("shared", "Also interleave every stack trace into one shared cache per config")
+		("interleave", po::value<std::string>()->default_value("round-robin"), "Shared cache interleaving: round-robin or timestamp")
+		("way-partition", po::value<std::string>(), "Comma separated ways of every index given to each stack trace of a shared cache")
+		("coherent", "Also simulate the stack traces as the threads of one program, each on its own core with a private copy of every cache, kept coherent with MESI")
+		("coherence", po::value<std::string>()->default_value("snoop"), "How the coherent cores find the other copies of a line: snoop or directory")
+		("epoch", po::value<unsigned int>()->default_value(1000), "Instructions each coherent core runs between the barriers applying the coherence traffic")
+		("warmup-trace", po::value<std::string>(), "Stack Trace file simulated once by every cache, each stack trace then starts from the warmed cache")
+		("save-checkpoint", po::value<std::string>(), "Folder to save the warmed state of every cache to, as <cache config>.ckpt")
+		("load-checkpoint", po::value<std::string>(), "Folder to load the warmed state of every cache from, instead of a warmup trace")
+		("sample-intervals", po::value<unsigned int>(), "Estimate the results of every cache from this many intervals of each stack trace")
+		("sample-length", po::value<unsigned int>()->default_value(10000), "Accesses in each sampled interval")
+		("sample-policy", po::value<std::string>()->default_value("periodic"), "Sampled interval placement: periodic or random")
+		("sample-warming", po::value<unsigned int>(), "Accesses before each interval that warm the cache, the rest are skipped, defaults to 8 times the blocks of each cache")
+		("sample-seed", po::value<unsigned int>()->default_value(0), "Seed of the random interval placement")
+		("set-sample", po::value<unsigned int>(), "Estimate the results of every cache from one in this many of its sets, a power of 2")
+		("set-sample-seed", po::value<unsigned int>()->default_value(0), "Seed picking the sampled sets")
+		("result-cache", po::value<std::string>(), "Folder remembering the results of every trace and cache simulated, later runs reuse them")
+		("trace-cache", po::value<std::string>()->implicit_value(""), "Keep a binary copy of every parsed Stack Trace file, next to it or in the given folder, later runs load it instead of parsing")
+		("serve", po::value<std::string>(), "Serve simulations on this Unix domain socket instead, see SimClient")
+		("threads", po::value<unsigned int>()->default_value(0), "Simulations the server runs at once, threads characterizing each Stack Trace, or threads running the cores of each coherent simulation, defaults to one per hardware thread, or one per core")
+		("shm-ring", po::value<std::string>(), "Simulate the accesses a producer writes into a shared memory ring of this name instead of Stack Trace files, see TraceReplayer")
+		("shm-capacity", po::value<unsigned int>()->default_value(1 << 20), "Accesses the shared memory ring holds")
+		("events", po::value<std::string>(), "Folder to record the hit or miss of every access to, as <stack trace>.<cache config>.events")
+		("event-victims", "Also record the block each miss evicted")
+		("results-format", po::value<std::string>()->default_value("out"), "out: one .out file per stack trace and cache config, csv or jsonl: every result in one results.csv or results.jsonl")
+		("no-plots", "Do not draw the result graphs")
+		("plot-threads", po::value<unsigned int>()->default_value(0), "Graphs drawn at once, defaults to one per hardware thread")
+		("profile", "Count the cycles, instructions, branch misses and cache misses of every phase and cache sim with perf events, only times them when perf events are not permitted")
+		("progress", po::value<unsigned int>()->implicit_value(1), "Print the throughput, ETA and slowest cache sims every this many seconds")
+		("status-file", po::value<std::string>(), "File the progress is also written to as JSON, rewritten with every report")
+		("characterize", "Only write the footprint, read ratio, page density, strides and instruction gaps of every Stack Trace, into <stack trace>.character.out")
+		("stage", po::value<std::vector<std::string>>()->multitoken()->composing(), "Lazy stages every Stack Trace passes through before the cache sims, in order: loads, stores, range:<first>:<last>, every:<n>[:<phase>], slice:<first>:<count> or xor:<mask>, addresses and masks in hex")
+		("combine", po::value<std::string>(), "Simulate the Stack Traces as one trace, one after the other with concat or one access of each in turn with interleave")
+		("classify-misses", "Also split the misses of every cache into compulsory, capacity and conflict misses, with the misses of optimal replacement, into <stack trace>.<cache config>.classes.out")
+		("pin", "Pin every cache sim to its own core, spread over the NUMA nodes, each node simulates from its own copy of the Stack Traces");
 	// clang-format on
 
 	po::variables_map vm;
@@ -72,21 +225,73 @@ int main(int argc, char **argv)
 
 	po::notify(vm);
 
+	const bool profile{vm.count("profile") > 0};
+	// counters of each trace read, cache sim and phase when profiling
+	std::vector<std::optional<PerfSample>> parse_profile;
+	std::vector<std::optional<PerfSample>> sim_profile;
+	std::vector<uint64_t> sim_accesses;
+	std::optional<PerfCounters> main_counters;
+	std::vector<std::pair<std::string, std::optional<PerfSample>>>
+		phase_profile;
+
 #ifdef TIMER
 	Util::Timer t{"Trace read"};
 	t.start();
 #endif
 	std::vector<std::pair<std::future<std::optional<StackTrace>>, std::string>>
 		st_read_files;
+	// renumbering of each trace with addresses wider than address_t
+	std::vector<std::optional<AddressMap>> address_maps;
+	const auto read_trace{
+		[&vm](const std::string &st_file,
+			  std::optional<AddressMap> *address_map = nullptr)
+		{
+			return vm.count("trace-cache")
+					   ? Util::ReadStackTraceFile(
+							 st_file,
+							 vm["trace-cache"].as<std::string>(),
+							 address_map)
+					   : Util::ReadStackTraceFile(st_file, address_map);
+		}};
+	if (vm.count("serve"))
+	{
+		const auto socket_path{vm["serve"].as<std::string>()};
+		SimServer server{socket_path, read_trace, vm["threads"].as<unsigned int>()};
+		std::cout << "Serving on " << socket_path << std::endl;
+		if (!server.Run())
+		{
+			std::cerr << "Could not listen on " << socket_path << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
 	if (vm.count("stack-trace"))
 	{
 		// start multithreaded read
+		parse_profile.resize(
+			vm["stack-trace"].as<std::vector<std::string>>().size());
+		address_maps.resize(parse_profile.size());
 		for (const std::string &st_file :
 			 vm["stack-trace"].as<std::vector<std::string>>())
 		{
 			st_read_files.emplace_back(
 				std::async(std::launch::async,
-						   [=]() { return Util::ReadStackTraceFile(st_file); }),
+						   [=,
+							&parse_profile,
+							&address_maps,
+							k = st_read_files.size()]()
+						   {
+							   if (!profile)
+								   return read_trace(st_file, &address_maps[k]);
+							   // counters only count the thread that opened
+							   // them
+							   PerfCounters pc;
+							   pc.Start();
+							   auto st{read_trace(st_file, &address_maps[k])};
+							   parse_profile[k] = pc.Stop();
+							   return st;
+						   }),
 				st_file);
 		}
 	}
@@ -109,6 +314,300 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (vm.count("l1-conf"))
+	{
+		const auto cc_file{vm["l1-conf"].as<std::string>()};
+		auto cc{Util::ReadCacheConfFile(cc_file)};
+		if (!cc.has_value())
+		{
+			std::cerr << "Cache Config file " << cc_file << " not found"
+					  << std::endl;
+			return 1;
+		}
+		l1_conf = {cc.value(), std::filesystem::path(cc_file).filename()};
+	}
+
+	if (vm.count("lower-levels"))
+	{
+		if (!l1_conf.has_value())
+		{
+			std::cerr << "--lower-levels requires --l1-conf" << std::endl;
+			return 1;
+		}
+		for (const std::string &levels :
+			 vm["lower-levels"].as<std::vector<std::string>>())
+		{
+			std::vector<CacheConf> confs;
+			std::string name{l1_conf->second};
+			for (const auto cc_range : levels | std::views::split(','))
+			{
+				const std::string cc_file{cc_range.begin(), cc_range.end()};
+				auto cc{Util::ReadCacheConfFile(cc_file)};
+				if (!cc.has_value())
+				{
+					std::cerr << "Cache Config file " << cc_file
+							  << " not found" << std::endl;
+					return 1;
+				}
+				confs.push_back(cc.value());
+				name += "+" + std::filesystem::path(cc_file).filename().string();
+			}
+			lower_arr.emplace_back(std::move(confs), std::move(name));
+		}
+	}
+
+	if (vm.count("replacement-seed"))
+	{
+		const auto seed{vm["replacement-seed"].as<unsigned int>()};
+		for (auto &cc : cc_arr)
+			cc.first.seed_ = seed;
+		if (l1_conf.has_value())
+			l1_conf->first.seed_ = seed;
+		for (auto &levels : lower_arr)
+			for (auto &cc : levels.first)
+				cc.seed_ = seed;
+	}
+
+	{
+		auto policy{
+			Util::ParseInclusionPolicy(vm["inclusion"].as<std::string>())};
+		if (!policy.has_value())
+		{
+			std::cerr << "Unknown inclusion policy "
+					  << vm["inclusion"].as<std::string>() << std::endl;
+			return 1;
+		}
+		inclusion_policy = policy.value();
+	}
+
+	if (vm.count("prefetcher"))
+	{
+		auto type{Util::ParsePrefetcherType(vm["prefetcher"].as<std::string>())};
+		if (!type.has_value())
+		{
+			std::cerr << "Unknown prefetcher "
+					  << vm["prefetcher"].as<std::string>() << std::endl;
+			return 1;
+		}
+		prefetch_conf = PrefetchConf{
+			.type_ = type.value(),
+			.degree_ = static_cast<uint_fast8_t>(
+				vm["prefetch-degree"].as<unsigned int>()),
+			.distance_ = static_cast<uint_fast8_t>(
+				vm["prefetch-distance"].as<unsigned int>()),
+			.table_size_ = static_cast<uint16_t>(
+				vm["prefetch-table"].as<unsigned int>())};
+	}
+
+	if (vm.count("mshrs") &&
+		(vm["mshrs"].as<unsigned int>() == 0 ||
+		 vm["mshrs"].as<unsigned int>() >
+			 std::numeric_limits<uint_fast8_t>::max()))
+	{
+		std::cerr << "--mshrs must be from 1 to "
+				  << +std::numeric_limits<uint_fast8_t>::max() << std::endl;
+		return 1;
+	}
+
+	const bool has_victim{vm.count("victim-cache") > 0};
+	const bool has_buffer{vm.count("write-buffer") > 0};
+	if ((has_victim || has_buffer) &&
+		(vm.count("prefetcher") ||
+		 (has_victim && vm["victim-cache"].as<unsigned int>() == 0) ||
+		 (has_buffer && vm["write-buffer"].as<unsigned int>() == 0)))
+	{
+		std::cerr << "--victim-cache and --write-buffer need at least one entry "
+					 "and can not be combined with --prefetcher"
+				  << std::endl;
+		return 1;
+	}
+
+	if (vm.count("tlb-conf"))
+	{
+		const auto tc_file{vm["tlb-conf"].as<std::string>()};
+		tlb_conf = Util::ReadTlbConfFile(tc_file);
+		if (!tlb_conf.has_value())
+		{
+			std::cerr << "TLB Config file " << tc_file
+					  << " not found or invalid" << std::endl;
+			return 1;
+		}
+	}
+
+	{
+		auto policy{
+			Util::ParseInterleavePolicy(vm["interleave"].as<std::string>())};
+		if (!policy.has_value())
+		{
+			std::cerr << "Unknown interleave policy "
+					  << vm["interleave"].as<std::string>() << std::endl;
+			return 1;
+		}
+		interleave_policy = policy.value();
+	}
+
+	CoherenceProtocol coherence_protocol{SNOOP};
+	if (vm.count("coherent"))
+	{
+		auto protocol{
+			Util::ParseCoherenceProtocol(vm["coherence"].as<std::string>())};
+		if (!protocol.has_value())
+		{
+			std::cerr << "Unknown coherence protocol "
+					  << vm["coherence"].as<std::string>() << std::endl;
+			return 1;
+		}
+		coherence_protocol = protocol.value();
+		if (vm.count("stack-trace") &&
+			vm["stack-trace"].as<std::vector<std::string>>().size() > 64)
+		{
+			std::cerr << "--coherent simulates at most 64 Stack Traces"
+					  << std::endl;
+			return 1;
+		}
+	}
+
+	if (vm.count("way-partition"))
+		for (const auto ways_range :
+			 vm["way-partition"].as<std::string>() | std::views::split(','))
+		{
+			const std::string ways{ways_range.begin(), ways_range.end()};
+			unsigned int n{};
+			const auto [end, ec]{
+				std::from_chars(ways.data(), ways.data() + ways.size(), n)};
+			// every trace needs at least one way of its own
+			if (ec != std::errc{} || end != ways.data() + ways.size() ||
+				n == 0 || n > std::numeric_limits<uint_fast8_t>::max())
+			{
+				std::cerr << "Invalid way partition entry " << ways
+						  << ", every entry must be a number of ways from 1 to "
+							 "the associativity"
+						  << std::endl;
+				return 1;
+			}
+			way_partition.push_back(static_cast<uint_fast8_t>(n));
+		}
+	if (vm.count("shared"))
+	{
+		if (vm.count("stack-trace") &&
+			vm["stack-trace"].as<std::vector<std::string>>().size() >
+				SharedCacheSimulator::kMaxSources)
+		{
+			std::cerr << "--shared simulates at most "
+					  << SharedCacheSimulator::kMaxSources << " Stack Traces"
+					  << std::endl;
+			return 1;
+		}
+		unsigned int ways{};
+		for (const auto w : way_partition)
+			ways += w;
+		for (auto &cc : cc_arr)
+			if (ways > cc.first.associativity_)
+			{
+				std::cerr << "Way partition does not fit in " << cc.second
+						  << std::endl;
+				return 1;
+			}
+	}
+
+	if (vm.count("sample-intervals"))
+	{
+		auto policy{
+			Util::ParseSamplingPolicy(vm["sample-policy"].as<std::string>())};
+		if (!policy.has_value())
+		{
+			std::cerr << "Unknown sampling policy "
+					  << vm["sample-policy"].as<std::string>() << std::endl;
+			return 1;
+		}
+		sampling_conf = SamplingConf{
+			.policy_ = policy.value(),
+			.intervals_ = vm["sample-intervals"].as<unsigned int>(),
+			.interval_length_ = vm["sample-length"].as<unsigned int>(),
+			.warming_length_ = {},
+			.seed_ = vm["sample-seed"].as<unsigned int>()};
+		if (vm.count("sample-warming"))
+			sampling_conf->warming_length_ =
+				vm["sample-warming"].as<unsigned int>();
+	}
+
+	if (vm.count("set-sample"))
+	{
+		const auto ratio{vm["set-sample"].as<unsigned int>()};
+		if (!std::has_single_bit(ratio) || vm.count("sample-intervals"))
+		{
+			std::cerr << "--set-sample must be a power of 2, and can not be "
+						 "combined with --sample-intervals"
+					  << std::endl;
+			return 1;
+		}
+		set_sample_bits = static_cast<uint_fast8_t>(std::countr_zero(ratio));
+	}
+
+	if (vm.count("stage"))
+		for (const auto &spec : vm["stage"].as<std::vector<std::string>>())
+		{
+			auto stage{TraceStages::ParseStage(spec)};
+			if (!stage.has_value())
+			{
+				std::cerr << "Unknown stage " << spec << std::endl;
+				return 1;
+			}
+			stages.push_back(stage.value());
+		}
+	if (vm.count("combine"))
+	{
+		combine = vm["combine"].as<std::string>();
+		if (combine != "concat" && combine != "interleave")
+		{
+			std::cerr << "Unknown combine mode " << combine.value()
+					  << std::endl;
+			return 1;
+		}
+	}
+	// the stages only feed full simulations of the cache sims
+	if ((!stages.empty() || combine.has_value()) &&
+		(sampling_conf.has_value() || set_sample_bits.has_value() ||
+		 vm.count("events") || vm.count("shared") || vm.count("l1-conf") ||
+		 vm.count("classify-misses") || vm.count("shm-ring")))
+	{
+		std::cerr << "--stage and --combine can not be combined with sampling, "
+					 "events, shared caches, hierarchies, miss classification "
+					 "or a shared memory ring"
+				  << std::endl;
+		return 1;
+	}
+
+	if (vm.count("warmup-trace") && vm.count("load-checkpoint"))
+	{
+		std::cerr << "--warmup-trace and --load-checkpoint can not be combined"
+				  << std::endl;
+		return 1;
+	}
+	if (vm.count("save-checkpoint") && !vm.count("warmup-trace"))
+	{
+		std::cerr << "--save-checkpoint requires --warmup-trace" << std::endl;
+		return 1;
+	}
+
+	if (vm.count("warmup-trace"))
+	{
+		const auto st_file{vm["warmup-trace"].as<std::string>()};
+		std::optional<AddressMap> warmup_map;
+		warmup_trace = read_trace(st_file, &warmup_map);
+		if (!warmup_trace.has_value())
+		{
+			std::cerr << "Stack Trace file " << st_file << " not found"
+					  << std::endl;
+			return 1;
+		}
+		if (warmup_map.has_value())
+			std::cerr << "Warning: warmup trace " << st_file
+					  << " has addresses wider than 32 bits, it is renumbered "
+						 "apart from the stack traces it warms up"
+					  << std::endl;
+	}
+
 	if (vm.count("output-folder"))
 		output_folder = vm["output-folder"].as<std::string>();
 	else
@@ -117,6 +616,20 @@ int main(int argc, char **argv)
 	if (!std::filesystem::exists(output_folder))
 		std::filesystem::create_directory(output_folder);
 
+	// .out files when not set
+	std::optional<ResultsTable::Format> results_format;
+	if (vm["results-format"].as<std::string>() != "out")
+	{
+		results_format =
+			Util::ParseResultsFormat(vm["results-format"].as<std::string>());
+		if (!results_format.has_value())
+		{
+			std::cerr << "Unknown results format "
+					  << vm["results-format"].as<std::string>() << std::endl;
+			return 1;
+		}
+	}
+
 	// joins the futures
 	for (auto &st : st_read_files)
 	{
@@ -131,6 +644,73 @@ int main(int argc, char **argv)
 			return 1;
 		}
 	}
+
+	// traces sharing a cache or a directory must agree on every address, so
+	// wide traces are renumbered together
+	if (vm.count("shared") || vm.count("coherent") || combine.has_value())
+	{
+		std::vector<std::reference_wrapper<StackTrace>> traces;
+		for (auto &st : st_arr)
+			traces.emplace_back(st.first);
+		if (auto map{AddressMap::Unify(traces, address_maps)}; map.has_value())
+			for (auto &address_map : address_maps)
+				address_map = map;
+	}
+
+	// wide traces are only simulated exactly by geometries that split
+	// addresses within the bits the renumbering keeps
+	for (size_t i{}; i < address_maps.size(); ++i)
+	{
+		if (!address_maps[i].has_value())
+			continue;
+		const auto &map{address_maps[i].value()};
+		const auto check{[&](const std::string &name, unsigned int bits)
+						 {
+							 if (!map.IsExact(static_cast<uint_fast8_t>(bits)))
+								 std::cerr << "Warning: " << name << " uses "
+										   << bits << " address bits, "
+										   << st_arr[i].second
+										   << " is only exact to "
+										   << +map.low_bits << std::endl;
+						 }};
+		const auto cache_bits{[](const CacheConf &cc)
+							  {
+								  const auto bits{GetIndexBits(cc)};
+								  return static_cast<unsigned int>(
+									  bits.offset_size + bits.index_size);
+							  }};
+		for (const auto &cc : cc_arr)
+			check(cc.second, cache_bits(cc.first));
+		if (l1_conf.has_value())
+			check(l1_conf->second, cache_bits(l1_conf->first));
+		for (const auto &levels : lower_arr)
+			for (const auto &cc : levels.first)
+				check(levels.second, cache_bits(cc));
+		if (tlb_conf.has_value())
+		{
+			// page number bits plus the set index bits of the entries
+			const auto tlb_bits{[](address_t page_size,
+								   unsigned int entries,
+								   unsigned int associativity)
+								{
+									return static_cast<unsigned int>(
+										std::bit_width(page_size) - 1 +
+										std::bit_width(std::max(
+											entries / std::max(associativity, 1u),
+											1u)) -
+										1);
+								}};
+			check("TLB",
+				  tlb_bits(tlb_conf->page_size_,
+						   tlb_conf->entries_,
+						   tlb_conf->associativity_));
+			if (tlb_conf->huge_entries_ > 0)
+				check("TLB",
+					  tlb_bits(tlb_conf->huge_page_size_,
+							   tlb_conf->huge_entries_,
+							   tlb_conf->huge_associativity_));
+		}
+	}
 #ifdef TIMER
 	t.stop();
 	t.print();
@@ -148,10 +728,81 @@ int main(int argc, char **argv)
 	Util::Timer t4{"create confs"};
 	t4.start();
 #endif
+	if (profile)
+	{
+		main_counters.emplace();
+		main_counters->Start();
+	}
+
+	if (vm.count("characterize"))
+	{
+		for (const auto &st : st_arr)
+		{
+			std::ofstream output_file(
+				output_folder + "/" + st.second + ".character.out",
+				std::ios::trunc | std::ios::out);
+			if (!output_file)
+				std::cerr << "error creating output file\n";
+			Characterize::Write(
+				output_file,
+				Characterize::Run(st.first, vm["threads"].as<unsigned int>()));
+		}
+		return 0;
+	}
+
 	// Create the cache sims
+	const auto make_sim{
+		[&](const CacheConf &cc)
+		{
+			CacheSimulator cs{cc};
+			if (prefetch_conf.has_value())
+				cs.set_prefetcher(prefetch_conf.value());
+			if (tlb_conf.has_value())
+				cs.set_tlb(tlb_conf.value());
+			if (vm.count("mshrs"))
+				cs.set_timing_model(
+					static_cast<uint_fast8_t>(vm["mshrs"].as<unsigned int>()));
+			if (vm.count("victim-cache"))
+				cs.set_victim_cache(
+					{.entries_ = static_cast<uint16_t>(
+						 vm["victim-cache"].as<unsigned int>()),
+					 .hit_latency_ = static_cast<uint16_t>(
+						 vm["victim-latency"].as<unsigned int>())});
+			if (vm.count("write-buffer"))
+				cs.set_write_buffer(
+					{.depth_ = static_cast<uint16_t>(
+						 vm["write-buffer"].as<unsigned int>()),
+					 .drain_cycles_ = static_cast<uint16_t>(
+						 vm.count("write-buffer-drain")
+							 ? vm["write-buffer-drain"].as<unsigned int>()
+							 : cc.miss_penalty_)});
+			return cs;
+		}};
 	for (auto &cc : cc_arr)
-		cs_arr.emplace_back(cc.first, cc.second);
+		cs_arr.emplace_back(make_sim(cc.first), cc.second);
+
+	// memory is placed on the node of the thread that first writes it, so
+	// each node copies the stack traces from one of its own cores
+	if (vm.count("pin"))
+	{
+		numa_nodes = Numa::ReadTopology(Numa::GetAllowedCpus());
+		if (numa_nodes.size() > 1)
+		{
+			trace_replicas.resize(numa_nodes.size());
+			std::vector<std::jthread> copiers;
+			for (size_t n{}; n < numa_nodes.size(); ++n)
+				copiers.push_back(std::jthread(
+					[&, n]()
+					{
+						Numa::PinThread(numa_nodes[n].cpus);
+						for (auto &st : st_arr)
+							trace_replicas[n].push_back(st.first);
+					}));
+		}
+	}
 
+	if (profile)
+		phase_profile.emplace_back("construct", main_counters->Stop());
 #ifdef TIMER
 	t4.stop();
 	t4.print();
@@ -161,27 +812,530 @@ int main(int argc, char **argv)
 	Util::Timer t3{"run sims "};
 	t3.start();
 #endif
-	// multithreading go brrt
+	if (vm.count("shm-ring"))
+	{
+		if (!st_arr.empty() || warmup_trace.has_value() ||
+			vm.count("load-checkpoint"))
+		{
+			std::cerr << "--shm-ring can not be combined with Stack Trace "
+						 "files or warm starts"
+					  << std::endl;
+			return 1;
+		}
+		// every cache sim is a consumer of the ring
+		if (cs_arr.empty() || cs_arr.size() > ShmRingHeader::kMaxConsumers)
+		{
+			std::cerr << "--shm-ring needs from 1 to "
+					  << ShmRingHeader::kMaxConsumers << " Cache Configs"
+					  << std::endl;
+			return 1;
+		}
+
+		const auto name{vm["shm-ring"].as<std::string>()};
+		ring = ShmRing::Create(name,
+							   vm["shm-capacity"].as<unsigned int>(),
+							   static_cast<uint32_t>(cs_arr.size()));
+		if (!ring)
+		{
+			std::cerr << "Could not create the ring " << name
+					  << ", it may exist already or the capacity is invalid"
+					  << std::endl;
+			return 1;
+		}
+		// the results are named after the ring
+		ring_trace = std::filesystem::path(name).filename();
+		for (auto &cs : cs_arr)
+			results_map[ring_trace][cs.second];
+		std::cout << "Waiting for a producer on " << name << std::endl;
+	}
+
+	// create every result up front, the threads below only write to their
+	// own entries
+	if (combine.has_value())
+		for (auto &cs : cs_arr)
+			results_map[combine.value()][cs.second];
+	for (auto &st : st_arr)
+	{
+		for (auto &cs : cs_arr)
+			if (!combine.has_value())
+				results_map[st.second][cs.second];
+		for (auto &lower : lower_arr)
+		{
+			results_map[st.second][lower.second];
+			hierarchy_results_map[st.second][lower.second];
+		}
+	}
+
+	// validate the checkpoints up front, the threads below restore them from
+	// memory
+	warm_states.resize(cs_arr.size());
+	if (vm.count("load-checkpoint"))
+	{
+		const std::filesystem::path folder{
+			vm["load-checkpoint"].as<std::string>()};
+		for (size_t i{}; i < cs_arr.size(); ++i)
+		{
+			const auto file{folder / (cs_arr[i].second + ".ckpt")};
+			std::ifstream is{file, std::ios::binary};
+			if (!cs_arr[i].first.LoadCheckpoint(is))
+			{
+				std::cerr << "Checkpoint " << file.string()
+						  << " not found or does not match "
+						  << cs_arr[i].second << std::endl;
+				return 1;
+			}
+			std::ostringstream os;
+			cs_arr[i].first.SaveCheckpoint(os);
+			warm_states[i] = os.str();
+		}
+	}
+
+	// filter each trace once for every distinct set of index bits
+	if (set_sample_bits.has_value())
+	{
+		std::vector<std::pair<IndexBits, std::future<std::vector<SetSampleFilter>>>>
+			filter_futures;
+		for (auto &cc : cc_arr)
+		{
+			const auto bits{GetIndexBits(cc.first)};
+			if (std::ranges::any_of(filter_futures,
+									[&](const auto &f) { return f.first == bits; }))
+				continue;
+			filter_futures.emplace_back(
+				bits,
+				std::async(std::launch::async,
+						   [&, bits]()
+						   {
+							   std::vector<SetSampleFilter> filters;
+							   for (auto &st : st_arr)
+								   filters.emplace_back(
+									   st.first,
+									   bits,
+									   set_sample_bits.value(),
+									   vm["set-sample-seed"].as<unsigned int>());
+							   return filters;
+						   }));
+		}
+		for (auto &f : filter_futures)
+			set_filters.emplace(f.first, f.second.get());
+	}
+
+	if (vm.count("result-cache"))
+	{
+		result_cache.emplace(vm["result-cache"].as<std::string>());
+		std::vector<std::future<uint64_t>> hash_futures;
+		for (auto &st : st_arr)
+			hash_futures.push_back(
+				std::async(std::launch::async,
+						   [&]() { return ResultCache::HashTrace(st.first); }));
+		for (auto &h : hash_futures)
+			trace_hashes.push_back(h.get());
+	}
+
+	std::optional<std::filesystem::path> events_folder;
+	if (vm.count("events"))
+	{
+		events_folder = vm["events"].as<std::string>();
+		std::filesystem::create_directories(events_folder.value());
+	}
+
+	sim_profile.resize(cs_arr.size());
+	sim_accesses.resize(cs_arr.size());
+
+	// one job per cache sim, each simulating every trace
+	std::optional<ProgressReporter> progress;
+	std::vector<ProgressJob *> progress_jobs;
+	if (vm.count("progress") || vm.count("status-file"))
+	{
+		progress.emplace(
+			std::chrono::seconds{vm.count("progress")
+									 ? vm["progress"].as<unsigned int>()
+									 : 1},
+			vm.count("progress") ? &std::cout : nullptr,
+			vm.count("status-file") ? vm["status-file"].as<std::string>()
+									: "");
+		uint64_t total{};
+		for (auto &st : st_arr)
+			total += st.first.size();
+		for (auto &cs : cs_arr)
+			progress_jobs.push_back(&progress->AddJob(cs.second, total));
+		progress->Start();
+	}
+
+	// pins the calling thread to the core of worker i, returns its node
+	const auto pin_worker{
+		[&](size_t i, const std::string &name) -> size_t
+		{
+			const auto place{Numa::Place(numa_nodes, i)};
+			if (!Numa::PinThread({place.cpu}))
+				std::cerr << "Could not pin " << name << " to core "
+						  << place.cpu << std::endl;
+			return place.node;
+		}};
+	// workers past the cache sims, the hierarchies, shared caches and miss
+	// classifications, are placed after them
+	size_t next_worker{cs_arr.size()};
+
+	// multithreading go brrt, the ring threads below simulate the cache sims
+	// of a ring instead
 	std::vector<std::jthread> sim_threads;
-	for (auto &cs : cs_arr)
+	const size_t trace_sims{ring ? 0 : cs_arr.size()};
+	for (size_t i{}; i < trace_sims; ++i)
 	{
 		// we don't edit the stack trace so we wont have concurrency issues
 		// if we multithread by cache
 		sim_threads.push_back(std::jthread(
-			[&]()
+			[&, i]()
 			{
-				for (auto &st : st_arr)
+				auto &cs{cs_arr[i]};
+				auto &warm_state{warm_states[i]};
+				size_t node{};
+				if (!numa_nodes.empty())
+				{
+					node = pin_worker(i, cs.second);
+					// rebuilt so the cache is allocated on this node
+					cs.first = make_sim(cs.first.get_cache_config());
+				}
+				if (warmup_trace.has_value())
 				{
 					cs.first.ClearCache();
-					results_map[st.second][cs.second] =
-						cs.first.SimulateTrace(st.first);
+					cs.first.SimulateTrace(warmup_trace.value());
+					std::ostringstream os;
+					cs.first.SaveCheckpoint(os);
+					warm_state = os.str();
+				}
+
+				// a full simulation of a flushed cache only depends on the
+				// trace and the config
+				const auto cc{cs.first.get_cache_config()};
+				const bool memoize{result_cache.has_value() &&
+								   !events_folder.has_value() &&
+								   stages.empty() && !combine.has_value() &&
+								   warm_state.empty() &&
+								   !cs.first.has_components() &&
+								   !set_sample_bits.has_value() &&
+								   !sampling_conf.has_value()};
+
+				std::optional<PerfCounters> counters;
+				if (profile)
+				{
+					counters.emplace();
+					counters->Start();
+				}
+
+				// SimulateTrace counts its own progress, the rest count
+				// whole traces
+				auto *job{progress ? progress_jobs[i] : nullptr};
+				if (job)
+					cs.first.set_progress(&job->done);
+				const bool counts_progress{!set_sample_bits.has_value() &&
+										   !sampling_conf.has_value()};
+
+				// the accesses through the stages, accesses the stages drop
+				// still count as progress
+				const auto simulate_staged{
+					[&](auto &&accesses, const std::string &name, uint64_t size)
+					{
+						if (warm_state.empty())
+							cs.first.ClearCache();
+						else
+						{
+							std::istringstream is{warm_state};
+							cs.first.LoadCheckpoint(is);
+						}
+						results_map.at(name).at(cs.second) =
+							cs.first.SimulateTrace(
+								std::forward<decltype(accesses)>(accesses) |
+								TraceStages::Apply{stages});
+						const auto &counts{cs.first.get_counts()};
+						sim_accesses[i] += counts.reads + counts.writes;
+						if (job)
+							job->done += size - counts.reads - counts.writes;
+					}};
+				if (combine.has_value())
+				{
+					std::vector<std::reference_wrapper<const StackTrace>> traces;
+					uint64_t size{};
+					for (size_t j{}; j < st_arr.size(); ++j)
+					{
+						traces.push_back(trace_replicas.empty()
+											 ? st_arr[j].first
+											 : trace_replicas[node][j]);
+						size += traces.back().get().size();
+					}
+					if (combine == "concat")
+						simulate_staged(
+							TraceStages::Concat(traces), combine.value(), size);
+					else
+						simulate_staged(TraceStages::Interleave(traces),
+										combine.value(),
+										size);
+				}
+
+				// combined traces were simulated as one above
+				const size_t traces{combine.has_value() ? 0 : st_arr.size()};
+				for (size_t j{}; j < traces; ++j)
+				{
+					auto &st{st_arr[j]};
+					const StackTrace &trace{trace_replicas.empty()
+												? st.first
+												: trace_replicas[node][j]};
+					if (!stages.empty())
+					{
+						simulate_staged(trace, st.second, trace.size());
+						continue;
+					}
+					if (memoize)
+					{
+						const auto counts{
+							result_cache->Find(trace_hashes[j], cc)};
+						if (counts.has_value())
+						{
+							results_map.at(st.second).at(cs.second) =
+								counts->ToResults(cc.miss_penalty_);
+							if (job)
+								job->done += trace.size();
+							continue;
+						}
+					}
+
+					if (warm_state.empty())
+						cs.first.ClearCache();
+					else
+					{
+						std::istringstream is{warm_state};
+						cs.first.LoadCheckpoint(is);
+					}
+					if (set_sample_bits.has_value())
+						results_map.at(st.second).at(cs.second) =
+							cs.first.SimulateSetSample(
+								set_filters.at(GetIndexBits(cc)).at(j));
+					else if (sampling_conf.has_value())
+						results_map.at(st.second).at(cs.second) =
+							cs.first.SampleTrace(trace, sampling_conf.value());
+					else if (events_folder.has_value())
+					{
+						const auto file{events_folder.value() /
+										(st.second + "." + cs.second +
+										 ".events")};
+						EventStreamWriter events{
+							file.string(),
+							vm.count("event-victims") > 0,
+							GetIndexBits(cc).offset_size};
+						cs.first.set_event_stream(&events);
+						results_map.at(st.second).at(cs.second) =
+							cs.first.SimulateTrace(trace);
+						cs.first.set_event_stream(nullptr);
+						if (!events.Close())
+							std::cerr << "Could not write events "
+									  << file.string() << std::endl;
+					}
+					else
+						results_map.at(st.second).at(cs.second) =
+							cs.first.SimulateTrace(trace);
+
+					sim_accesses[i] += trace.size();
+					if (job && !counts_progress)
+						job->done += trace.size();
+
+					if (memoize &&
+						!result_cache->Store(
+							trace_hashes[j], cc, cs.first.get_counts()))
+						std::cerr << "Could not store the results of "
+								  << st.second << " on " << cs.second
+								  << std::endl;
+				}
+
+				if (counters)
+					sim_profile[i] = counters->Stop();
+				if (job)
+				{
+					cs.first.set_progress(nullptr);
+					job->finished = true;
+				}
+			}));
+	}
+
+	// every cache sim reads every access of the ring as it arrives
+	if (ring)
+		for (size_t i{}; i < cs_arr.size(); ++i)
+			sim_threads.push_back(std::jthread(
+				[&, i]()
+				{
+					ShmRingConsumer consumer{*ring, static_cast<uint32_t>(i)};
+					auto &cs{cs_arr[i]};
+					if (!numa_nodes.empty())
+					{
+						pin_worker(i, cs.second);
+						cs.first = make_sim(cs.first.get_cache_config());
+					}
+					cs.first.ClearCache();
+
+					std::optional<PerfCounters> counters;
+					if (profile)
+					{
+						counters.emplace();
+						counters->Start();
+					}
+					if (progress)
+						cs.first.set_progress(&progress_jobs[i]->done);
+					results_map.at(ring_trace).at(cs.second) =
+						cs.first.SimulateStream([&]() { return consumer.Next(); });
+					const auto &counts{cs.first.get_counts()};
+					sim_accesses[i] = counts.reads + counts.writes;
+					if (counters)
+						sim_profile[i] = counters->Stop();
+					if (progress)
+						progress_jobs[i]->finished = true;
+				}));
+
+	// the first level is simulated once per trace, every hierarchy replays
+	// its miss stream. Replays do not back-invalidate the first level, so
+	// inclusive hierarchies simulate every trace in full
+	const bool replay_misses{inclusion_policy != INCLUSIVE};
+	std::vector<MissStream> ms_arr;
+	if (!lower_arr.empty() && replay_misses)
+	{
+		std::vector<std::future<MissStream>> ms_futures;
+		for (auto &st : st_arr)
+			ms_futures.push_back(std::async(
+				std::launch::async,
+				[&]()
+				{
+					return CacheHierarchy{{l1_conf->first}, inclusion_policy}
+						.RecordMissStream(st.first);
+				}));
+		for (auto &ms : ms_futures)
+			ms_arr.push_back(ms.get());
+	}
+
+	std::vector<std::reference_wrapper<const StackTrace>> shared_traces;
+	std::vector<std::string> shared_names;
+	if (vm.count("shared"))
+	{
+		for (auto &st : st_arr)
+		{
+			shared_traces.emplace_back(st.first);
+			shared_names.push_back(st.second);
+		}
+		for (auto &cc : cc_arr)
+			shared_results_map[cc.second];
+		for (auto &cc : cc_arr)
+			sim_threads.push_back(std::jthread(
+				[&, worker = next_worker++]()
+				{
+					if (!numa_nodes.empty())
+						pin_worker(worker, "shared " + cc.second);
+					SharedCacheSimulator scs{cc.first, way_partition};
+					shared_results_map.at(cc.second) =
+						scs.SimulateTraces(shared_traces, interleave_policy);
+				}));
+	}
+
+	std::vector<std::reference_wrapper<const StackTrace>> coherent_traces;
+	std::vector<std::string> core_names;
+	if (vm.count("coherent"))
+	{
+		for (auto &st : st_arr)
+		{
+			coherent_traces.emplace_back(st.first);
+			core_names.push_back(st.second);
+		}
+		for (auto &cc : cc_arr)
+			coherent_results_map[cc.second];
+		// not pinned, each runs a thread per group of cores of its own
+		for (auto &cc : cc_arr)
+			sim_threads.push_back(std::jthread(
+				[&]()
+				{
+					CoherentSimulator cohs{cc.first,
+										   coherent_traces.size(),
+										   coherence_protocol,
+										   vm["epoch"].as<unsigned int>(),
+										   vm["threads"].as<unsigned int>()};
+					coherent_results_map.at(cc.second) =
+						cohs.SimulateTraces(coherent_traces);
+				}));
+	}
+
+	for (auto &lower : lower_arr)
+	{
+		sim_threads.push_back(std::jthread(
+			[&, worker = next_worker++]()
+			{
+				if (!numa_nodes.empty())
+					pin_worker(worker, lower.second);
+				std::vector<CacheConf> confs{l1_conf->first};
+				confs.insert(confs.end(), lower.first.begin(), lower.first.end());
+				CacheHierarchy ch{std::move(confs), inclusion_policy};
+				for (size_t i{}; i < st_arr.size(); ++i)
+				{
+					ch.ClearCache();
+					auto hr{replay_misses
+								? ch.SimulateMissStream(ms_arr[i])
+								: ch.SimulateTrace(st_arr[i].first)};
+					results_map.at(st_arr[i].second).at(lower.second) =
+						hr.combined;
+					hierarchy_results_map.at(st_arr[i].second)
+						.at(lower.second) = std::move(hr);
 				}
 			}));
 	}
 
+	// the configs of each line size classify their misses from the same line
+	// traces
+	if (vm.count("classify-misses"))
+	{
+		for (auto &cc : cc_arr)
+		{
+			auto &traces{line_traces[GetIndexBits(cc.first).offset_size]};
+			if (traces.empty())
+				for (auto &st : st_arr)
+					traces.push_back(std::async(
+						std::launch::async,
+						[&st, offset_size = GetIndexBits(cc.first).offset_size]()
+						{ return LineTraces::Intern(st.first, offset_size); }));
+			for (auto &st : st_arr)
+				classes_map[st.second][cc.second];
+		}
+		for (size_t i{}; i < cc_arr.size(); ++i)
+			sim_threads.push_back(std::jthread(
+				[&, i, worker = next_worker++]()
+				{
+					const auto &cc{cc_arr[i]};
+					if (!numa_nodes.empty())
+						pin_worker(worker, "classification of " + cc.second);
+					const auto &traces{
+						line_traces.at(GetIndexBits(cc.first).offset_size)};
+					for (size_t j{}; j < st_arr.size(); ++j)
+						classes_map.at(st_arr[j].second).at(cc.second) =
+							LineTraces::ClassifyMisses(traces[j].get(),
+													   cc.first);
+				}));
+	}
+
 	// join up our simulation threads
 	for (auto &i : sim_threads)
 		i.join();
+	if (progress)
+		progress->Stop();
+
+	if (vm.count("save-checkpoint"))
+	{
+		const std::filesystem::path folder{
+			vm["save-checkpoint"].as<std::string>()};
+		std::filesystem::create_directories(folder);
+		for (size_t i{}; i < cs_arr.size(); ++i)
+		{
+			const auto file{folder / (cs_arr[i].second + ".ckpt")};
+			std::ofstream os{file, std::ios::binary};
+			os.write(warm_states[i].data(),
+					 static_cast<std::streamsize>(warm_states[i].size()));
+			if (!os)
+				std::cerr << "Could not write checkpoint " << file.string()
+						  << std::endl;
+		}
+	}
 #ifdef TIMER
 	t3.stop();
 	t3.print();
@@ -194,12 +1348,66 @@ int main(int argc, char **argv)
 	Util::Timer t1{"Write output"};
 	t.start();
 #endif
-	CreateOutputFiles(results_map, output_folder);
-	CreateOutputImages(results_map, output_folder);
+	if (profile)
+		main_counters->Start();
+	// the graphs are drawn while the result files are written
+	std::optional<ThreadPool> plot_pool;
+	if (!vm.count("no-plots"))
+	{
+		plot_pool.emplace(vm["plot-threads"].as<unsigned int>());
+		CreateOutputImages(results_map, output_folder, plot_pool.value());
+	}
+	if (results_format.has_value())
+	{
+		// [Cache config] config of the results, the first level of a
+		// hierarchy
+		std::map<std::string, CacheConf> result_confs;
+		for (auto &cc : cc_arr)
+			result_confs.emplace(cc.second, cc.first);
+		for (auto &lower : lower_arr)
+			result_confs.emplace(lower.second, l1_conf->first);
+		CreateResultsTable(
+			results_map, result_confs, results_format.value(), output_folder);
+	}
+	else
+		CreateOutputFiles(results_map, output_folder);
+	CreateHierarchyOutputFiles(hierarchy_results_map, output_folder);
+	CreateClassesOutputFiles(classes_map, output_folder);
+	CreateSharedOutputFiles(shared_results_map, shared_names, output_folder);
+	CreateCoherentOutputFiles(coherent_results_map, core_names, output_folder);
+	// waits for the graphs
+	plot_pool.reset();
 #ifdef TIMER
 	t1.stop();
 	t1.print();
 #endif
+
+	if (profile)
+	{
+		// the graphs are drawn by gnuplot, only the wait for them is counted
+		phase_profile.emplace_back("output", main_counters->Stop());
+
+		// the phases run on several threads are the sum of their threads
+		const auto sum{[](const std::vector<std::optional<PerfSample>> &v)
+					   {
+						   std::optional<PerfSample> total;
+						   for (const auto &sample : v)
+							   if (sample && total)
+								   *total += *sample;
+							   else if (sample)
+								   total = sample;
+						   return total;
+					   }};
+		phase_profile.insert(phase_profile.begin(),
+							 {"parse", sum(parse_profile)});
+		phase_profile.insert(phase_profile.begin() + 2,
+							 {"simulate", sum(sim_profile)});
+
+		std::vector<std::pair<std::string, std::optional<PerfSample>>> sims;
+		for (size_t i{}; i < cs_arr.size(); ++i)
+			sims.emplace_back(cs_arr[i].second, sim_profile[i]);
+		PrintProfile(phase_profile, sims, sim_accesses);
+	}
 }
 
 void CreateOutputFiles(
@@ -226,13 +1434,359 @@ void CreateOutputFiles(
 			output_file << "Total Run Time\t : " << res.run_time << std::endl;
 			output_file << "Average Memory Access Latency\t : "
 						<< res.average_memory_access_time << std::endl;
+			if (res.prefetch.has_value())
+			{
+				output_file << "Prefetches Issued\t : " << res.prefetch->issued
+							<< std::endl;
+				output_file << "Useful Prefetches\t : " << res.prefetch->useful
+							<< std::endl;
+				output_file << "Late Prefetches\t : " << res.prefetch->late
+							<< std::endl;
+				output_file << "Useless Prefetches\t : "
+							<< res.prefetch->useless << std::endl;
+				output_file << "Demand Blocks Evicted By Prefetches\t : "
+							<< res.prefetch->demand_evictions << std::endl;
+				output_file << "Prefetch Accuracy\t : "
+							<< res.prefetch->accuracy << std::endl;
+				output_file << "Prefetch Coverage\t : "
+							<< res.prefetch->coverage << std::endl;
+			}
+			if (res.timing.has_value())
+			{
+				output_file << "Non-Blocking Run Time\t : "
+							<< res.timing->run_time << std::endl;
+				output_file << "Non-Blocking Average Memory Access Latency\t : "
+							<< res.timing->average_memory_access_time
+							<< std::endl;
+				output_file << "MSHR Stall Cycles\t : "
+							<< res.timing->mshr_stall_cycles << std::endl;
+				output_file << "Dependency Stall Cycles\t : "
+							<< res.timing->dependency_stall_cycles << std::endl;
+				output_file << "Merged Misses\t : "
+							<< res.timing->merged_misses << std::endl;
+				output_file << "Memory Level Parallelism\t : "
+							<< res.timing->memory_level_parallelism
+							<< std::endl;
+			}
+			if (res.tlb.has_value())
+			{
+				output_file << "TLB Hit Rate\t : " << res.tlb->hit_rate
+							<< std::endl;
+				output_file << "Huge Page TLB Hit Rate\t : "
+							<< res.tlb->huge_hit_rate << std::endl;
+				output_file << "TLB Misses\t : " << res.tlb->misses
+							<< std::endl;
+				output_file << "Page Walk Cycles\t : " << res.tlb->walk_cycles
+							<< std::endl;
+			}
+			if (res.victim.has_value())
+			{
+				output_file << "Victim Cache Hit Rate\t : "
+							<< res.victim->hit_rate << std::endl;
+				output_file << "Victim Cache Hits\t : " << res.victim->hits
+							<< std::endl;
+				output_file << "Victim Cache Writebacks\t : "
+							<< res.victim->writebacks << std::endl;
+				output_file << "Victim Swap Cycles\t : "
+							<< res.victim->swap_cycles << std::endl;
+			}
+			if (res.write_buffer.has_value())
+			{
+				output_file << "Buffered Writes\t : "
+							<< res.write_buffer->writes << std::endl;
+				output_file << "Write Coalesce Rate\t : "
+							<< res.write_buffer->coalesce_rate << std::endl;
+				output_file << "Memory Writes\t : "
+							<< res.write_buffer->memory_writes << std::endl;
+				output_file << "Write Buffer Stall Cycles\t : "
+							<< res.write_buffer->stall_cycles << std::endl;
+			}
+			if (res.sampling.has_value())
+			{
+				output_file << "Sampled Intervals\t : "
+							<< res.sampling->intervals << std::endl;
+				output_file << "Sampled Accesses\t : "
+							<< res.sampling->sampled_accesses << " of "
+							<< res.sampling->total_accesses << std::endl;
+				output_file << "Warmed Accesses\t : "
+							<< res.sampling->warmed_accesses << std::endl;
+				output_file << "Total Hit Rate Error (95%)\t : "
+							<< res.sampling->total_hit_rate_error << std::endl;
+				output_file << "Total Run Time Error (95%)\t : "
+							<< res.sampling->run_time_error << std::endl;
+				output_file
+					<< "Average Memory Access Latency Error (95%)\t : "
+					<< res.sampling->average_memory_access_time_error
+					<< std::endl;
+			}
+			if (res.set_sampling.has_value())
+			{
+				output_file << "Sampled Sets\t : "
+							<< res.set_sampling->sampled_sets << " of "
+							<< res.set_sampling->total_sets << std::endl;
+				output_file << "Set Sampling Ratio\t : "
+							<< res.set_sampling->sampling_ratio << std::endl;
+				output_file << "Sampled Accesses\t : "
+							<< res.set_sampling->sampled_accesses << " of "
+							<< res.set_sampling->total_accesses << std::endl;
+				output_file << "Total Hit Rate Error (95%)\t : "
+							<< res.set_sampling->total_hit_rate_error
+							<< std::endl;
+			}
 		}
 	}
 }
 
-void CreateOutputImages(
+void CreateResultsTable(
 	std::map<std::string, std::map<std::string, Results>> &results_map,
+	std::map<std::string, CacheConf> &result_confs,
+	ResultsTable::Format format,
 	std::string &output_folder)
+{
+	std::vector<ResultsTable::Row> rows;
+	for (auto &st_res : results_map)
+		for (auto &cc_res : st_res.second)
+		{
+			// a result without a known config keeps zeroed config columns
+			const auto conf{result_confs.find(cc_res.first)};
+			rows.push_back({.stack_trace = st_res.first,
+							.cache_config = cc_res.first,
+							.cc = conf != result_confs.end() ? conf->second
+															 : CacheConf{},
+							.results = cc_res.second});
+		}
+
+	const std::string output_file_name{
+		output_folder + "/results" +
+		(format == ResultsTable::CSV ? ".csv" : ".jsonl")};
+	std::ofstream output_file(output_file_name, std::ios::trunc | std::ios::out);
+	if (!ResultsTable::Write(output_file, rows, format))
+		std::cerr << "error creating output file\n";
+}
+
+void PrintProfile(
+	std::vector<std::pair<std::string, std::optional<PerfSample>>> &phases,
+	std::vector<std::pair<std::string, std::optional<PerfSample>>> &sims,
+	std::vector<uint64_t> &sim_accesses)
+{
+	const auto counter{[](const PerfSample &sample, PerfEvent event)
+					   {
+						   std::ostringstream ss;
+						   if (sample.counters[event])
+							   ss << *sample.counters[event];
+						   else
+							   ss << "-";
+						   return ss.str();
+					   }};
+	const auto ipc{[](const PerfSample &sample)
+				   {
+					   std::ostringstream ss;
+					   if (sample.get_ipc())
+						   ss << std::setprecision(3) << *sample.get_ipc();
+					   else
+						   ss << "-";
+					   return ss.str();
+				   }};
+
+	if (!PerfCounters{}.is_available())
+		std::cout << "perf events are not permitted, only timing"
+				  << std::endl;
+
+	std::cout << "phase\t ms\t IPC\t cycles\t instructions\t branch "
+				 "misses\t cache misses"
+			  << std::endl;
+	for (auto &phase : phases)
+	{
+		if (!phase.second)
+			continue;
+		const auto &sample{phase.second.value()};
+		std::cout << phase.first << "\t " << sample.ns / 1000000 << "\t "
+				  << ipc(sample) << "\t " << counter(sample, CYCLES) << "\t "
+				  << counter(sample, INSTRUCTIONS) << "\t "
+				  << counter(sample, BRANCH_MISSES) << "\t "
+				  << counter(sample, CACHE_MISSES) << std::endl;
+	}
+
+	std::cout << "cache config\t accesses\t ns/access\t IPC\t branch "
+				 "misses/access\t cache misses/access"
+			  << std::endl;
+	for (size_t i{}; i < sims.size(); ++i)
+	{
+		if (!sims[i].second || sim_accesses[i] == 0)
+			continue;
+		const auto &sample{sims[i].second.value()};
+		const auto accesses{static_cast<double>(sim_accesses[i])};
+		const auto per_access{
+			[&](PerfEvent event)
+			{
+				std::ostringstream ss;
+				if (sample.counters[event])
+					ss << std::setprecision(3)
+					   << static_cast<double>(*sample.counters[event]) /
+							  accesses;
+				else
+					ss << "-";
+				return ss.str();
+			}};
+		std::cout << sims[i].first << "\t " << sim_accesses[i] << "\t "
+				  << std::fixed << std::setprecision(1)
+				  << static_cast<double>(sample.ns) / accesses
+				  << std::defaultfloat << "\t "
+				  << ipc(sample) << "\t " << per_access(BRANCH_MISSES)
+				  << "\t " << per_access(CACHE_MISSES) << std::endl;
+	}
+}
+
+void CreateHierarchyOutputFiles(
+	std::map<std::string, std::map<std::string, HierarchyResults>>
+		&hierarchy_results_map,
+	std::string &output_folder)
+{
+	for (auto &st_res : hierarchy_results_map)
+	{
+		for (auto &ch_res : st_res.second)
+		{
+			std::string output_file_name{output_folder + "/" + st_res.first +
+										 "." + ch_res.first + ".levels.out"};
+			std::ofstream output_file(
+				std::move(output_file_name), std::ios::trunc | std::ios::out);
+			if (!output_file)
+				std::cerr << "error creating output file\n";
+			for (size_t i{}; i < ch_res.second.levels.size(); ++i)
+			{
+				const auto &level{ch_res.second.levels[i]};
+				output_file << "L" << i + 1 << std::endl;
+				output_file << "Total Hit Rate\t : "
+							<< level.results.total_hit_rate << std::endl;
+				output_file << "Load Hit Rate\t : "
+							<< level.results.read_hit_rate << std::endl;
+				output_file << "Write Hit Rate\t : "
+							<< level.results.write_hit_rate << std::endl;
+				output_file << "Misses\t : "
+							<< level.counts.read_misses +
+								   level.counts.write_misses
+							<< std::endl;
+				output_file << "Write Backs\t : " << level.writebacks
+							<< std::endl;
+				output_file << "Back Invalidations\t : "
+							<< level.back_invalidations << std::endl;
+			}
+		}
+	}
+}
+
+void CreateClassesOutputFiles(
+	std::map<std::string, std::map<std::string, MissClasses>> &classes_map,
+	std::string &output_folder)
+{
+	for (auto &st_res : classes_map)
+	{
+		for (auto &cc_res : st_res.second)
+		{
+			std::string output_file_name{output_folder + "/" + st_res.first +
+										 "." + cc_res.first + ".classes.out"};
+			std::ofstream output_file(
+				std::move(output_file_name), std::ios::trunc | std::ios::out);
+			if (!output_file)
+				std::cerr << "error creating output file\n";
+			const auto &mc{cc_res.second};
+			output_file << "Misses\t : " << mc.misses << std::endl;
+			output_file << "Compulsory Misses\t : " << mc.compulsory
+						<< std::endl;
+			output_file << "Capacity Misses\t : " << mc.capacity << std::endl;
+			output_file << "Conflict Misses\t : " << mc.conflict << std::endl;
+			output_file << "Optimal Replacement Misses\t : " << mc.opt_misses
+						<< std::endl;
+		}
+	}
+}
+
+void CreateSharedOutputFiles(
+	std::map<std::string, SharedResults> &shared_results_map,
+	std::vector<std::string> &source_names,
+	std::string &output_folder)
+{
+	for (auto &cc_res : shared_results_map)
+	{
+		std::string output_file_name{output_folder + "/shared." +
+									 cc_res.first + ".out"};
+		std::ofstream output_file(
+			std::move(output_file_name), std::ios::trunc | std::ios::out);
+		if (!output_file)
+			std::cerr << "error creating output file\n";
+		const auto &sr{cc_res.second};
+		output_file << "Total Hit Rate\t : " << sr.combined.total_hit_rate
+					<< std::endl;
+		for (size_t i{}; i < sr.sources.size(); ++i)
+		{
+			const auto &source{sr.sources[i]};
+			output_file << source_names[i] << std::endl;
+			output_file << "Total Hit Rate\t : "
+						<< source.results.total_hit_rate << std::endl;
+			output_file << "Load Hit Rate\t : " << source.results.read_hit_rate
+						<< std::endl;
+			output_file << "Write Hit Rate\t : "
+						<< source.results.write_hit_rate << std::endl;
+			output_file << "Total Run Time\t : " << source.results.run_time
+						<< std::endl;
+			output_file << "Evictions Caused\t : " << source.evictions_caused
+						<< std::endl;
+			output_file << "Evictions Suffered\t : "
+						<< source.evictions_suffered << std::endl;
+			for (size_t j{}; j < sr.sources.size(); ++j)
+				output_file << "Evicted From " << source_names[j] << "\t : "
+							<< sr.evictions[i][j] << std::endl;
+		}
+	}
+}
+
+void CreateCoherentOutputFiles(
+	std::map<std::string, CoherentResults> &coherent_results_map,
+	std::vector<std::string> &core_names,
+	std::string &output_folder)
+{
+	for (auto &cc_res : coherent_results_map)
+	{
+		std::string output_file_name{output_folder + "/coherent." +
+									 cc_res.first + ".out"};
+		std::ofstream output_file(
+			std::move(output_file_name), std::ios::trunc | std::ios::out);
+		if (!output_file)
+			std::cerr << "error creating output file\n";
+		const auto &cr{cc_res.second};
+		output_file << "Total Hit Rate\t : " << cr.combined.total_hit_rate
+					<< std::endl;
+		output_file << "Epochs\t : " << cr.epochs << std::endl;
+		for (size_t i{}; i < cr.cores.size(); ++i)
+		{
+			const auto &core{cr.cores[i]};
+			output_file << core_names[i] << std::endl;
+			output_file << "Total Hit Rate\t : " << core.results.total_hit_rate
+						<< std::endl;
+			output_file << "Load Hit Rate\t : " << core.results.read_hit_rate
+						<< std::endl;
+			output_file << "Write Hit Rate\t : " << core.results.write_hit_rate
+						<< std::endl;
+			output_file << "Total Run Time\t : " << core.results.run_time
+						<< std::endl;
+			output_file << "Coherence Misses\t : " << core.coherence_misses
+						<< std::endl;
+			output_file << "Upgrades\t : " << core.upgrades << std::endl;
+			output_file << "Invalidations Sent\t : " << core.invalidations_sent
+						<< std::endl;
+			output_file << "Invalidations Received\t : "
+						<< core.invalidations_received << std::endl;
+			output_file << "Writebacks\t : " << core.writebacks << std::endl;
+			output_file << "Coherence Messages\t : " << core.messages
+						<< std::endl;
+		}
+	}
+}
+
+void CreateOutputImages(
+	std::map<std::string, std::map<std::string, Results>> &results_map,
+	std::string &output_folder,
+	ThreadPool &pool)
 {
 	using namespace matplot;
 
@@ -252,47 +1806,66 @@ void CreateOutputImages(
 		std::vector<std::string>{"Total-Hit-Rate", "Total Hit Rate"},
 		[](Results &r) { return r.total_hit_rate; });
 
-	// creates the table for each output type listed in the tables vector
+	// matplot keeps every figure in one registry
+	static std::mutex figure_mutex;
+
+	// each graph is drawn by its own gnuplot process, so they are drawn in
+	// parallel. Only the figure itself is touched, not the current figure
 	for (auto &table : tables)
 	{
 		for (auto &stack_res : results_map)
 		{
-			auto f = figure();
-			f->quiet_mode(true);
-
 			auto cache_res_v{stack_res.second | std::views::values |
 							 std::views::transform(table.second)};
-
 			vector_1d y{cache_res_v.begin(), cache_res_v.end()};
-			auto b{bar(y)};
-
-			std::vector<double> label_x;
-			std::vector<double> label_y;
-			std::vector<std::string> labels;
-			double max{*std::max_element(y.begin(), y.end())};
-			for (size_t i = 0; i < y.size(); ++i)
-			{
-				label_x.emplace_back(b->x_end_point(i, 0) * 1.21 - 0.35);
-				label_y.emplace_back(y[i] + (max * .05));
-				std::stringstream ss;
-				ss << std::setprecision(3) << y[i];
-				labels.emplace_back(ss.str());
-			}
-			hold(on);
-			text(label_x, label_y, labels)->font("Times New Roman");
 
-			auto cache_names{
+			auto cache_names_v{
 				std::views::keys(stack_res.second) |
 				std::views::transform(
 					[](std::string s) {
 						return s.erase(s.find_last_of("."), std::string::npos);
 					})};
-			xticklabels({cache_names.begin(), cache_names.end()});
-			xtickangle(24.0);
-			ylabel(table.first[1]);
-			title(stack_res.first);
-			save(output_folder + table.first[0] + "-" + stack_res.first +
-				 ".jpg");
+			std::vector<std::string> cache_names{cache_names_v.begin(),
+												 cache_names_v.end()};
+
+			const std::string file{output_folder + table.first[0] + "-" +
+								   stack_res.first + ".jpg"};
+			pool.Submit(
+				[y = std::move(y),
+				 cache_names = std::move(cache_names),
+				 y_label = table.first[1],
+				 graph_title = stack_res.first,
+				 file]()
+				{
+					figure_handle f;
+					{
+						std::lock_guard lock{figure_mutex};
+						f = figure(true);
+					}
+					auto ax{f->current_axes()};
+					auto b{ax->bar(y)};
+
+					std::vector<double> label_x;
+					std::vector<double> label_y;
+					std::vector<std::string> labels;
+					double max{*std::max_element(y.begin(), y.end())};
+					for (size_t i = 0; i < y.size(); ++i)
+					{
+						label_x.emplace_back(b->x_end_point(i, 0) * 1.21 - 0.35);
+						label_y.emplace_back(y[i] + (max * .05));
+						std::stringstream ss;
+						ss << std::setprecision(3) << y[i];
+						labels.emplace_back(ss.str());
+					}
+					ax->hold(on);
+					ax->text(label_x, label_y, labels)->font("Times New Roman");
+
+					ax->xticklabels(cache_names);
+					ax->xtickangle(24.0);
+					ax->ylabel(y_label);
+					ax->title(graph_title);
+					f->save(file);
+				});
 		}
 	}
 }
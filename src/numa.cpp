@@ -0,0 +1,111 @@
+/**
+ * filename: numa.cpp
+ *
+ * description: NUMA topology discovery and thread pinning
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "numa.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+
+namespace Numa
+{
+std::vector<uint32_t> ParseCpuList(const std::string &s)
+{
+	std::vector<uint32_t> cpus;
+	const char *p{s.data()};
+	const char *const end{s.data() + s.size()};
+	while (p < end)
+	{
+		uint32_t first;
+		auto res{std::from_chars(p, end, first)};
+		if (res.ec != std::errc{})
+			break;
+		uint32_t last{first};
+		if (res.ptr < end && *res.ptr == '-')
+		{
+			res = std::from_chars(res.ptr + 1, end, last);
+			if (res.ec != std::errc{})
+				break;
+		}
+		for (auto cpu{first}; cpu <= last; ++cpu)
+			cpus.push_back(cpu);
+
+		// the separator, or the newline at the end
+		p = res.ptr + 1;
+	}
+	return cpus;
+}
+
+std::vector<uint32_t> GetAllowedCpus()
+{
+	std::vector<uint32_t> cpus;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (::sched_getaffinity(0, sizeof(set), &set) != 0)
+		return cpus;
+	for (uint32_t cpu{}; cpu < CPU_SETSIZE; ++cpu)
+		if (CPU_ISSET(cpu, &set))
+			cpus.push_back(cpu);
+	return cpus;
+}
+
+std::vector<NumaNode> ReadTopology(const std::vector<uint32_t> &allowed,
+								   const std::string &sysfs)
+{
+	std::vector<NumaNode> nodes;
+	std::error_code ec;
+	for (const auto &entry : std::filesystem::directory_iterator(sysfs, ec))
+	{
+		const auto name{entry.path().filename().string()};
+		if (!name.starts_with("node") || name.size() == 4 ||
+			!std::all_of(name.begin() + 4,
+						 name.end(),
+						 [](unsigned char c) { return std::isdigit(c) != 0; }))
+			continue;
+
+		std::ifstream file{entry.path() / "cpulist"};
+		std::string list;
+		if (!std::getline(file, list))
+			continue;
+
+		NumaNode node{.id = {}, .cpus = {}};
+		std::from_chars(name.data() + 4, name.data() + name.size(), node.id);
+		for (const auto cpu : ParseCpuList(list))
+			if (std::ranges::find(allowed, cpu) != allowed.end())
+				node.cpus.push_back(cpu);
+		if (!node.cpus.empty())
+			nodes.push_back(std::move(node));
+	}
+
+	std::ranges::sort(nodes, {}, &NumaNode::id);
+	if (nodes.empty() && !allowed.empty())
+		nodes.push_back({.id = 0, .cpus = allowed});
+	return nodes;
+}
+
+WorkerPlacement Place(const std::vector<NumaNode> &nodes, size_t i)
+{
+	const auto node{i % nodes.size()};
+	const auto &cpus{nodes[node].cpus};
+	return {.node = node, .cpu = cpus[(i / nodes.size()) % cpus.size()]};
+}
+
+bool PinThread(const std::vector<uint32_t> &cpus)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (const auto cpu : cpus)
+		CPU_SET(cpu, &set);
+	return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+}  // namespace Numa
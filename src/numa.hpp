@@ -0,0 +1,56 @@
+/**
+ * filename: numa.hpp
+ *
+ * description: header file for NUMA topology discovery and thread pinning
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct NumaNode
+{
+	uint32_t id;
+	// CPUs of the node this process may run on
+	std::vector<uint32_t> cpus;
+};
+
+// where a worker runs, node is an index into the topology
+struct WorkerPlacement
+{
+	size_t node;
+	uint32_t cpu;
+};
+
+namespace Numa
+{
+/**
+ * @brief parse a sysfs CPU list such as 0-3,8,10-11
+ **/
+std::vector<uint32_t> ParseCpuList(const std::string &s);
+
+// CPUs this process may run on
+std::vector<uint32_t> GetAllowedCpus();
+
+/**
+ * @brief the NUMA nodes with at least one of the allowed CPUs, in node order
+ * @description Without a node topology in sysfs, every allowed CPU is put in
+ *one node.
+ **/
+std::vector<NumaNode> ReadTopology(
+	const std::vector<uint32_t> &allowed,
+	const std::string &sysfs = "/sys/devices/system/node");
+
+/**
+ * @brief the core of worker i, workers are spread round robin over the
+ *nodes and then over the cores of each node
+ **/
+WorkerPlacement Place(const std::vector<NumaNode> &nodes, size_t i);
+
+// run the calling thread on only these CPUs, false if it could not be pinned
+bool PinThread(const std::vector<uint32_t> &cpus);
+}  // namespace Numa
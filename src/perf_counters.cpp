@@ -0,0 +1,87 @@
+/**
+ * filename: perf_counters.cpp
+ *
+ * description: hardware event counters of the calling thread
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "perf_counters.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace
+{
+constexpr std::array<uint64_t, kPerfEvents> kConfigs{
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_BRANCH_MISSES,
+	PERF_COUNT_HW_CACHE_MISSES};
+
+int Open(uint64_t config)
+{
+	perf_event_attr attr{};
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	// this thread on any cpu
+	return static_cast<int>(
+		::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+}  // namespace
+
+PerfCounters::PerfCounters()
+{
+	for (size_t i{}; i < kPerfEvents; ++i)
+		fds_[i] = Open(kConfigs[i]);
+}
+
+PerfCounters::~PerfCounters()
+{
+	for (const auto fd : fds_)
+		if (fd >= 0)
+			::close(fd);
+}
+
+bool PerfCounters::is_available() const
+{
+	return std::ranges::any_of(fds_, [](int fd) { return fd >= 0; });
+}
+
+void PerfCounters::Start()
+{
+	for (const auto fd : fds_)
+		if (fd >= 0)
+		{
+			::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	start_ = std::chrono::steady_clock::now();
+}
+
+PerfSample PerfCounters::Stop()
+{
+	const auto stop{std::chrono::steady_clock::now()};
+	PerfSample sample{};
+	for (size_t i{}; i < kPerfEvents; ++i)
+	{
+		if (fds_[i] < 0)
+			continue;
+		::ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+		uint64_t count;
+		if (::read(fds_[i], &count, sizeof(count)) == sizeof(count))
+			sample.counters[i] = count;
+	}
+	sample.ns = static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start_)
+			.count());
+	return sample;
+}
@@ -0,0 +1,89 @@
+/**
+ * filename: perf_counters.hpp
+ *
+ * description: header file for hardware event counters of the calling thread
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+/**
+ * @brief CYCLES : cpu cycles
+ * INSTRUCTIONS : retired instructions
+ * BRANCH_MISSES : mispredicted branches
+ * CACHE_MISSES : last level cache misses
+ **/
+enum PerfEvent
+{
+	CYCLES,
+	INSTRUCTIONS,
+	BRANCH_MISSES,
+	CACHE_MISSES
+};
+
+inline constexpr size_t kPerfEvents{4};
+
+/**
+ * @brief what a thread did between a Start and Stop, counters that could not
+ *be opened are not set
+ **/
+struct PerfSample
+{
+	uint64_t ns{};
+	std::array<std::optional<uint64_t>, kPerfEvents> counters{};
+
+	// instructions per cycle, when both were counted
+	std::optional<double> get_ipc() const
+	{
+		if (!counters[CYCLES] || !counters[INSTRUCTIONS] || !*counters[CYCLES])
+			return {};
+		return static_cast<double>(*counters[INSTRUCTIONS]) /
+			   static_cast<double>(*counters[CYCLES]);
+	};
+
+	PerfSample &operator+=(const PerfSample &rhs)
+	{
+		ns += rhs.ns;
+		for (size_t i{}; i < kPerfEvents; ++i)
+			if (counters[i] && rhs.counters[i])
+				*counters[i] += *rhs.counters[i];
+			else
+				counters[i].reset();
+		return *this;
+	};
+};
+
+/**
+ * @brief counts the hardware events of the thread that created it, with
+ *perf_event_open
+ * @description Each event is opened on its own, events the kernel does not
+ *permit or the cpu does not have are left out and only the wall clock time
+ *is measured for them. User space only, so it works with a
+ *perf_event_paranoid of 2.
+ **/
+class PerfCounters
+{
+private:
+	// -1 when the event could not be opened
+	std::array<int, kPerfEvents> fds_;
+	std::chrono::steady_clock::time_point start_;
+
+public:
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters &) = delete;
+	PerfCounters &operator=(const PerfCounters &) = delete;
+
+	// true if at least one event is counted
+	bool is_available() const;
+
+	void Start();
+	PerfSample Stop();
+};
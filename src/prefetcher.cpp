@@ -0,0 +1,219 @@
+/**
+ * filename: prefetcher.cpp
+ *
+ * description: object file for the hardware prefetcher models
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "prefetcher.hpp"
+
+#include <algorithm>
+
+void NextLinePrefetcher::OnAccess(address_t address,
+								  bool trigger,
+								  std::vector<address_t> &prefetches)
+{
+	if (!trigger)
+		return;
+
+	const address_t line_size{1u << offset_size_};
+	for (uint_fast8_t i{}; i < prefetch_conf_.degree_; ++i)
+		prefetches.push_back(
+			static_cast<address_t>(
+				address + (prefetch_conf_.distance_ + i) * line_size));
+}
+
+void StridePrefetcher::OnAccess(address_t address,
+								bool,
+								std::vector<address_t> &prefetches)
+{
+	if (table_.empty())
+		return;
+
+	const address_t region{address >> kRegionShift};
+	auto &entry{table_[region % table_.size()]};
+
+	if (!entry.valid || entry.region != region)
+	{
+		entry = {.region = region,
+				 .last_address = address,
+				 .stride = 0,
+				 .confidence = 0,
+				 .valid = true};
+		return;
+	}
+
+	const int64_t delta{static_cast<int64_t>(address) -
+						static_cast<int64_t>(entry.last_address)};
+	entry.last_address = address;
+	// repeated accesses to the same address say nothing about the stride
+	if (delta == 0)
+		return;
+
+	if (delta != entry.stride)
+	{
+		if (entry.confidence > 1)
+			entry.confidence--;
+		else
+		{
+			entry.stride = delta;
+			entry.confidence = 1;
+		}
+		return;
+	}
+	entry.confidence = std::min<uint8_t>(entry.confidence + 1, kMaxConfidence);
+	if (entry.confidence < kIssueConfidence)
+		return;
+
+	// strides smaller than a block still walk through the blocks one by one
+	const int64_t line_size{int64_t{1} << offset_size_};
+	int64_t step{entry.stride};
+	if (step > 0 && step < line_size)
+		step = line_size;
+	else if (step < 0 && -step < line_size)
+		step = -line_size;
+
+	for (uint_fast8_t i{}; i < prefetch_conf_.degree_; ++i)
+		prefetches.push_back(static_cast<address_t>(
+			static_cast<int64_t>(address) +
+			step * (prefetch_conf_.distance_ + i)));
+}
+
+void StridePrefetcher::Clear()
+{
+	std::fill(table_.begin(), table_.end(), StrideEntry{});
+}
+
+void StreamPrefetcher::OnAccess(address_t address,
+								bool trigger,
+								std::vector<address_t> &prefetches)
+{
+	if (!trigger || streams_.empty())
+		return;
+
+	tick_++;
+	const int64_t block{address >> offset_size_};
+
+	auto stream{std::find_if(streams_.begin(),
+							 streams_.end(),
+							 [&](const Stream &s)
+							 {
+								 return s.valid &&
+										std::abs(block - s.last_block) <=
+											kStreamWindow;
+							 })};
+
+	// start tracking a new stream in place of the least recently used one
+	if (stream == streams_.end())
+	{
+		stream = std::min_element(streams_.begin(),
+								  streams_.end(),
+								  [](const Stream &a, const Stream &b) {
+									  return a.last_use < b.last_use;
+								  });
+		*stream = {.last_block = block,
+				   .direction = 0,
+				   .confidence = 0,
+				   .last_use = tick_,
+				   .valid = true};
+		return;
+	}
+
+	stream->last_use = tick_;
+	const int64_t direction{block > stream->last_block ? 1 : -1};
+	if (block == stream->last_block)
+		return;
+	stream->last_block = block;
+
+	if (direction != stream->direction)
+	{
+		if (stream->confidence > 1)
+			stream->confidence--;
+		else
+		{
+			stream->direction = direction;
+			stream->confidence = 1;
+		}
+		return;
+	}
+	stream->confidence =
+		std::min<uint8_t>(stream->confidence + 1, kMaxConfidence);
+	if (stream->confidence < kIssueConfidence)
+		return;
+
+	for (uint_fast8_t i{}; i < prefetch_conf_.degree_; ++i)
+		prefetches.push_back(static_cast<address_t>(
+			(block + direction * (prefetch_conf_.distance_ + i))
+			<< offset_size_));
+}
+
+void StreamPrefetcher::Clear()
+{
+	std::fill(streams_.begin(), streams_.end(), Stream{});
+	tick_ = 0;
+}
+
+bool PrefetchStage::AccessMemory(address_t address, bool is_read, uint64_t now)
+{
+	const auto ar{cache_.Access(address, is_read)};
+	Evicted(ar, false);
+
+	bool trigger{!ar.hit};
+	if (ar.hit)
+	{
+		const auto it{unused_.find(cache_.get_block_address(address))};
+		if (it != unused_.end())
+		{
+			if (now < it->second)
+				stats_.late++;
+			else
+				stats_.useful++;
+			unused_.erase(it);
+			// keep a prefetched stream going once it is used
+			trigger = true;
+		}
+	}
+	else
+		misses_++;
+
+	prefetches_.clear();
+	prefetcher_->OnAccess(address, trigger, prefetches_);
+
+	for (const auto prefetch : prefetches_)
+	{
+		if (cache_.Contains(prefetch))
+			continue;
+
+		stats_.issued++;
+		const auto far{cache_.Fill(prefetch, false)};
+		Evicted(far, true);
+		unused_[cache_.get_block_address(prefetch)] = now + fill_latency_;
+	}
+
+	return ar.hit;
+}
+
+void PrefetchStage::Evicted(const AccessResult &ar, bool by_prefetch)
+{
+	if (!ar.evicted)
+		return;
+
+	if (unused_.erase(cache_.get_block_address(ar.victim.block_address)))
+		stats_.useless++;
+	else if (by_prefetch)
+		stats_.demand_evictions++;
+}
+
+PrefetchStats PrefetchStage::get_stats() const
+{
+	PrefetchStats ps{stats_};
+	const auto used{ps.useful + ps.late};
+
+	ps.useless += unused_.size();
+	ps.accuracy = static_cast<double>(used) / static_cast<double>(ps.issued);
+	ps.coverage =
+		static_cast<double>(used) / static_cast<double>(used + misses_);
+
+	return ps;
+}
@@ -0,0 +1,194 @@
+/**
+ * filename: prefetcher.hpp
+ *
+ * description: header file for the hardware prefetcher models
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "base_structs.hpp"
+#include "cache.hpp"
+
+/**
+ * @brief Virtual base class for prefetchers
+ * @description A prefetcher watches the demand accesses to a cache and
+ *proposes addresses to bring in ahead of time.
+ **/
+class Prefetcher
+{
+protected:
+	const PrefetchConf prefetch_conf_;
+	const uint_fast8_t offset_size_;
+
+	// confidence of a stride or stream is a saturating counter, a new one
+	// starts at 1 and is prefetched along from kIssueConfidence on
+	static constexpr uint8_t kMaxConfidence{3};
+	static constexpr uint8_t kIssueConfidence{2};
+
+public:
+	Prefetcher(PrefetchConf pc, uint_fast8_t offset_size)
+		: prefetch_conf_{pc}, offset_size_{offset_size} {};
+
+	virtual ~Prefetcher() = default;
+
+	/**
+	 * @brief train on a demand access and append addresses to prefetch
+	 * @param trigger true on a demand miss, or on the first use of a
+	 *prefetched block
+	 **/
+	virtual void OnAccess(address_t address,
+						  bool trigger,
+						  std::vector<address_t> &prefetches) = 0;
+
+	// forget everything that was learned
+	virtual void Clear() = 0;
+};
+
+/**
+ * @brief prefetch the blocks following a missing block
+ **/
+class NextLinePrefetcher : public Prefetcher
+{
+public:
+	NextLinePrefetcher(PrefetchConf pc, uint_fast8_t offset_size)
+		: Prefetcher{pc, offset_size} {};
+
+	void OnAccess(address_t address,
+				  bool trigger,
+				  std::vector<address_t> &prefetches) override;
+
+	void Clear() override{};
+};
+
+/**
+ * @brief PC-less stride prefetcher
+ * @description Each entry of a direct mapped table tracks the last address and
+ *address delta seen in one 4KB region. Once the same delta is seen twice in a
+ *row the region is prefetched along the stride. A different delta lowers the
+ *confidence and only replaces the stride once the confidence is back at 1, so
+ *one odd access does not stop a confident stride.
+ **/
+class StridePrefetcher : public Prefetcher
+{
+private:
+	static constexpr uint_fast8_t kRegionShift{12};
+
+	struct StrideEntry
+	{
+		address_t region;
+		address_t last_address;
+		int64_t stride;
+		uint8_t confidence;
+		bool valid;
+	};
+
+	std::vector<StrideEntry> table_;
+
+public:
+	StridePrefetcher(PrefetchConf pc, uint_fast8_t offset_size)
+		: Prefetcher{pc, offset_size}, table_(pc.table_size_) {};
+
+	void OnAccess(address_t address,
+				  bool trigger,
+				  std::vector<address_t> &prefetches) override;
+
+	void Clear() override;
+};
+
+/**
+ * @brief sequential stream prefetcher
+ * @description Tracks up to table_size streams of misses moving through
+ *neighbouring blocks. Once a stream has moved twice in the same direction it
+ *runs ahead of the demand accesses by distance blocks. A step the other way
+ *lowers the confidence and only turns the stream around once the confidence
+ *is back at 1.
+ **/
+class StreamPrefetcher : public Prefetcher
+{
+private:
+	// blocks between a miss and the stream it can join
+	static constexpr int64_t kStreamWindow{16};
+
+	struct Stream
+	{
+		int64_t last_block;
+		int64_t direction;
+		uint8_t confidence;
+		uint64_t last_use;
+		bool valid;
+	};
+
+	std::vector<Stream> streams_;
+	uint64_t tick_{};
+
+public:
+	StreamPrefetcher(PrefetchConf pc, uint_fast8_t offset_size)
+		: Prefetcher{pc, offset_size}, streams_(pc.table_size_) {};
+
+	void OnAccess(address_t address,
+				  bool trigger,
+				  std::vector<address_t> &prefetches) override;
+
+	void Clear() override;
+};
+
+/**
+ * @brief sits in front of a cache, issuing prefetches and tracking their use
+ * @description Prefetched blocks are placed with CacheBase::Fill so they go
+ *through the cache's own replacement policy and can evict demand blocks. A
+ *prefetch arrives miss_penalty cycles after it is issued, a demand access
+ *before then counts as late.
+ **/
+class PrefetchStage
+{
+private:
+	CacheBase &cache_;
+	std::unique_ptr<Prefetcher> prefetcher_;
+	const uint64_t fill_latency_;
+
+	// prefetched blocks that have not been used yet, and when they arrive
+	std::unordered_map<address_t, uint64_t> unused_;
+	std::vector<address_t> prefetches_;
+	PrefetchStats stats_{};
+	uint64_t misses_{};
+
+	// account for a block leaving the cache
+	void Evicted(const AccessResult &ar, bool by_prefetch);
+
+public:
+	PrefetchStage(CacheBase &cache,
+				  std::unique_ptr<Prefetcher> prefetcher,
+				  uint64_t fill_latency)
+		: cache_{cache},
+		  prefetcher_{std::move(prefetcher)},
+		  fill_latency_{fill_latency} {};
+
+	/**
+	 * @brief demand access through the prefetcher, true on hit
+	 * @param now cycle of the access, used to find late prefetches
+	 **/
+	bool AccessMemory(address_t address, bool is_read, uint64_t now);
+
+	// statistics since the last call to ResetStats
+	PrefetchStats get_stats() const;
+
+	void ResetStats()
+	{
+		stats_ = {};
+		misses_ = 0;
+	};
+
+	// forget the prefetcher's training and the unused blocks
+	void Clear()
+	{
+		prefetcher_->Clear();
+		unused_.clear();
+	};
+};
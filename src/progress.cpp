@@ -0,0 +1,224 @@
+/**
+ * filename: progress.cpp
+ *
+ * description: reporting the progress of running simulations
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "progress.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+// slowest jobs printed with every report
+constexpr size_t kSlowestPrinted{3};
+
+std::string Rate(double rate)
+{
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	if (rate >= 1e6)
+		ss << rate / 1e6 << "M";
+	else if (rate >= 1e3)
+		ss << rate / 1e3 << "K";
+	else
+		ss << rate;
+	ss << " accesses/s";
+	return ss.str();
+}
+
+std::string Percent(uint64_t done, uint64_t total)
+{
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision(1)
+	   << (total ? 100.0 * static_cast<double>(done) /
+					   static_cast<double>(total)
+				 : 0.0)
+	   << "%";
+	return ss.str();
+}
+
+void AppendJson(std::ostream &os, const std::string &s)
+{
+	os << '"';
+	for (const char c : s)
+	{
+		if (c == '"' || c == '\\')
+			os << '\\';
+		os << c;
+	}
+	os << '"';
+}
+}  // namespace
+
+ProgressReporter::ProgressReporter(std::chrono::milliseconds interval,
+								   std::ostream *os,
+								   std::string status_path)
+	: interval_{interval}, os_{os}, status_path_{std::move(status_path)}
+{}
+
+ProgressReporter::~ProgressReporter()
+{
+	Stop();
+}
+
+ProgressJob &ProgressReporter::AddJob(std::string name, uint64_t total)
+{
+	auto &job{jobs_.emplace_back()};
+	job.name = std::move(name);
+	job.total = total;
+	return job;
+}
+
+void ProgressReporter::Start()
+{
+	start_ = std::chrono::steady_clock::now();
+	last_ = start_;
+	last_done_.assign(jobs_.size(), 0);
+	thread_ = std::jthread(
+		[this](std::stop_token stop)
+		{
+			std::mutex mutex;
+			std::condition_variable_any cv;
+			std::unique_lock lock{mutex};
+			// wakes early when stopped
+			while (!cv.wait_for(lock, stop, interval_, [] { return false; }))
+			{
+				if (stop.stop_requested())
+					break;
+				const auto snapshot{Snapshot()};
+				Print(snapshot);
+				WriteStatus(snapshot);
+			}
+		});
+}
+
+void ProgressReporter::Stop()
+{
+	if (!thread_.joinable())
+		return;
+	thread_.request_stop();
+	thread_.join();
+
+	const auto snapshot{Snapshot()};
+	Print(snapshot);
+	WriteStatus(snapshot);
+}
+
+ProgressSnapshot ProgressReporter::Snapshot()
+{
+	const auto now{std::chrono::steady_clock::now()};
+	const auto since_last{
+		std::chrono::duration<double>(now - last_).count()};
+	last_ = now;
+	last_done_.resize(jobs_.size());
+
+	ProgressSnapshot snapshot{
+		.elapsed_seconds = std::chrono::duration<double>(now - start_).count(),
+		.done = 0,
+		.total = 0,
+		.rate = 0,
+		.eta_seconds = -1,
+		.jobs = {},
+		.slowest = {}};
+	for (size_t i{}; i < jobs_.size(); ++i)
+	{
+		auto &job{jobs_[i]};
+		const bool finished{job.finished.load(std::memory_order_relaxed)};
+		const auto done{job.done.load(std::memory_order_relaxed)};
+		const double rate{since_last > 0
+							  ? static_cast<double>(done - last_done_[i]) /
+									since_last
+							  : 0};
+		last_done_[i] = done;
+
+		snapshot.done += done;
+		snapshot.total += job.total;
+		snapshot.rate += rate;
+		snapshot.jobs.push_back({.name = job.name,
+								 .done = done,
+								 .total = job.total,
+								 .rate = rate,
+								 .finished = finished});
+		if (!finished)
+			snapshot.slowest.push_back(i);
+	}
+
+	std::ranges::stable_sort(snapshot.slowest,
+							 {},
+							 [&](size_t i) { return snapshot.jobs[i].rate; });
+
+	if (snapshot.done > 0 && snapshot.total >= snapshot.done)
+		snapshot.eta_seconds =
+			static_cast<double>(snapshot.total - snapshot.done) *
+			snapshot.elapsed_seconds / static_cast<double>(snapshot.done);
+	return snapshot;
+}
+
+void ProgressReporter::Print(const ProgressSnapshot &snapshot)
+{
+	if (!os_)
+		return;
+
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision(1) << "[" << snapshot.elapsed_seconds
+	   << "s] " << Percent(snapshot.done, snapshot.total) << " "
+	   << Rate(snapshot.rate);
+	if (snapshot.eta_seconds >= 0)
+		ss << " ETA " << snapshot.eta_seconds << "s";
+	ss << " " << snapshot.jobs.size() - snapshot.slowest.size() << "/"
+	   << snapshot.jobs.size() << " jobs done\n";
+	for (size_t k{};
+		 k < std::min(kSlowestPrinted, snapshot.slowest.size());
+		 ++k)
+	{
+		const auto &job{snapshot.jobs[snapshot.slowest[k]]};
+		ss << "  slow : " << job.name << " " << Rate(job.rate) << " "
+		   << Percent(job.done, job.total) << "\n";
+	}
+	*os_ << ss.str() << std::flush;
+}
+
+void ProgressReporter::WriteStatus(const ProgressSnapshot &snapshot)
+{
+	if (status_path_.empty())
+		return;
+
+	// written under another name first, so a poller never sees half of it
+	const std::string tmp{status_path_ + ".tmp"};
+	{
+		std::ofstream os{tmp, std::ios::trunc};
+		os << "{\"elapsed_seconds\":" << snapshot.elapsed_seconds
+		   << ",\"done\":" << snapshot.done << ",\"total\":" << snapshot.total
+		   << ",\"rate\":" << snapshot.rate
+		   << ",\"eta_seconds\":" << snapshot.eta_seconds << ",\"jobs\":[";
+		for (size_t i{}; i < snapshot.jobs.size(); ++i)
+		{
+			const auto &job{snapshot.jobs[i]};
+			os << (i ? "," : "") << "{\"name\":";
+			AppendJson(os, job.name);
+			os << ",\"done\":" << job.done << ",\"total\":" << job.total
+			   << ",\"rate\":" << job.rate << ",\"finished\":"
+			   << (job.finished ? "true" : "false") << "}";
+		}
+		os << "],\"slowest\":[";
+		for (size_t k{}; k < snapshot.slowest.size(); ++k)
+		{
+			os << (k ? "," : "");
+			AppendJson(os, snapshot.jobs[snapshot.slowest[k]].name);
+		}
+		os << "]}\n";
+		if (!os)
+			return;
+	}
+	std::error_code ec;
+	std::filesystem::rename(tmp, status_path_, ec);
+}
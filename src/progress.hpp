@@ -0,0 +1,105 @@
+/**
+ * filename: progress.hpp
+ *
+ * description: header file for reporting the progress of running simulations
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief accesses a job has simulated, published by its worker
+ * @description Workers add to done with relaxed stores every few thousand
+ *accesses, the reporter only needs an eventually consistent count.
+ **/
+struct ProgressJob
+{
+	std::string name;
+	// 0 when not known ahead
+	uint64_t total;
+	std::atomic<uint64_t> done{};
+	std::atomic<bool> finished{};
+};
+
+struct JobProgress
+{
+	std::string name;
+	uint64_t done;
+	uint64_t total;
+	// accesses per second since the last snapshot
+	double rate;
+	bool finished;
+};
+
+struct ProgressSnapshot
+{
+	double elapsed_seconds;
+	uint64_t done;
+	uint64_t total;
+	// accesses per second of every job since the last snapshot
+	double rate;
+	// from the average rate so far, negative when not known
+	double eta_seconds;
+	std::vector<JobProgress> jobs;
+	// indices of the unfinished jobs, slowest first
+	std::vector<size_t> slowest;
+};
+
+/**
+ * @brief prints the throughput, ETA and slowest jobs of the registered jobs
+ *every interval from its own thread, and can also write them to a status file
+ *as JSON for other tools to poll
+ **/
+class ProgressReporter
+{
+private:
+	// a deque so the jobs never move while workers write to them
+	std::deque<ProgressJob> jobs_;
+	const std::chrono::milliseconds interval_;
+	// nullptr to only write the status file
+	std::ostream *os_;
+	const std::string status_path_;
+	std::chrono::steady_clock::time_point start_;
+	std::chrono::steady_clock::time_point last_;
+	std::vector<uint64_t> last_done_;
+	std::jthread thread_;
+
+	void Print(const ProgressSnapshot &snapshot);
+	void WriteStatus(const ProgressSnapshot &snapshot);
+
+public:
+	/**
+	 * @param status_path file rewritten with every report, empty for none
+	 **/
+	ProgressReporter(std::chrono::milliseconds interval,
+					 std::ostream *os,
+					 std::string status_path = "");
+
+	~ProgressReporter();
+
+	/**
+	 * @brief register a job, every job must be added before Start
+	 **/
+	ProgressJob &AddJob(std::string name, uint64_t total);
+
+	void Start();
+
+	// stop reporting, with one last report
+	void Stop();
+
+	/**
+	 * @brief the progress of every job since the last snapshot, only called
+	 *from one thread at a time
+	 **/
+	ProgressSnapshot Snapshot();
+};
@@ -8,49 +8,145 @@
 
 #include "rand_cache.hpp"
 
-bool RandCache::AccessMemory(const address_t& address, const bool& is_read)
+#include <sstream>
+#include <string>
+
+AccessResult RandCache::Access(const address_t& address, const bool& is_read)
 {
-	bool hit{true};
-	const auto index{get_index(address)};
+	auto& ci{Index(address)};
+
+	const auto it{ci.map.find(cache_block_t{address, false})};
 
-	// not in cache
-	if (!cache_[index].map.contains(cache_block_t{address, is_read}))
+	// in cache
+	if (it != ci.map.end())
 	{
-		hit = false;
-		// if we have a miss a write with a no-write allocate cache
-		// then we return here without adding the block to the cache
-		if (!is_read && !is_write_allocate_)
-			return hit;
-
-		// list is full
-		if (cache_[index].map.size() == associativity_)
-		{
-			size_t i;
-			if (associativity_ == 0)
-				i = 0;
-			else
-			{
-				std::uniform_int_distribution<std::size_t> dist(
-					0, cache_[index].list.size() - 1);
-
-				i = static_cast<size_t>(dist(kGen));
-			}
-			// remove the random block in the cache
-			cache_[index].map.erase(
-				std::next(cache_[index].list.begin(), static_cast<long>(i)));
-			cache_[index].list[i] = {address, is_read};
-			cache_[index].map.emplace(
-				std::next(cache_[index].list.begin(), static_cast<long>(i)));
-		}
+		// a write hit on a write-back cache leaves the block dirty
+		if (!is_read && is_write_allocate_)
+			(*it)->dirty = true;
+		return {.hit = true};
+	}
+
+	// if we have a miss a write with a no-write allocate cache
+	// then we return here without adding the block to the cache
+	if (!is_read && !is_write_allocate_)
+		return {.hit = false};
+
+	return Insert(address, !is_read);
+};
+
+AccessResult RandCache::Fill(const address_t& address, const bool& dirty)
+{
+	auto& ci{Index(address)};
+
+	const auto it{ci.map.find(cache_block_t{address, false})};
+
+	if (it != ci.map.end())
+	{
+		(*it)->dirty |= dirty;
+		return {.hit = true};
+	}
+
+	return Insert(address, dirty);
+};
+
+std::optional<cache_block_t> RandCache::Invalidate(const address_t& address)
+{
+	auto& ci{Index(address)};
+
+	const auto it{ci.map.find(cache_block_t{address, false})};
+
+	if (it == ci.map.end())
+		return {};
+
+	const auto pos{*it};
+	const cache_block_t cb{*pos};
+	ci.map.erase(it);
+
+	// move the last block into the hole so the list stays packed
+	const auto last{std::prev(ci.list.end())};
+	if (pos != last)
+	{
+		ci.map.erase(last);
+		*pos = *last;
+		ci.map.insert(pos);
+	}
+	ci.list.pop_back();
+
+	return cb;
+};
+
+AccessResult RandCache::Insert(const address_t& address, const bool& dirty)
+{
+	AccessResult ar{.hit = false};
+
+	auto& ci{Index(address)};
+
+	// list is full
+	if (ci.map.size() == associativity_)
+	{
+		size_t i;
+		if (associativity_ == 0)
+			i = 0;
 		else
 		{
-			// put the new block into the cache
-			cache_[index].list.emplace_back(address, is_read);
-			cache_[index].map.emplace(std::prev(cache_[index].list.end()));
+			std::uniform_int_distribution<std::size_t> dist(
+				0, ci.list.size() - 1);
+
+			i = static_cast<size_t>(dist(gen_));
 		}
+		ar.evicted = true;
+		ar.victim = ci.list[i];
+		// remove the random block in the cache
+		ci.map.erase(
+			std::next(ci.list.begin(), static_cast<long>(i)));
+		ci.list[i] = {address, dirty};
+		ci.map.emplace(
+			std::next(ci.list.begin(), static_cast<long>(i)));
+	}
+	else
+	{
+		// put the new block into the cache
+		ci.list.emplace_back(address, dirty);
+		ci.map.emplace(std::prev(ci.list.end()));
 	}
 
-	return hit;
+	return ar;
 };
 
-std::mt19937 RandCache::kGen(std::random_device{}());
+void RandCache::SaveState(std::ostream& os) const
+{
+	Cache::SaveState(os);
+
+	// the standard only gives the generator state as text
+	std::ostringstream state;
+	state << gen_;
+	const std::string text{state.str()};
+	BinaryIO::Write(os, static_cast<uint32_t>(text.size()));
+	os.write(text.data(), static_cast<std::streamsize>(text.size()));
+};
+
+bool RandCache::LoadState(std::istream& is)
+{
+	if (!Cache::LoadState(is))
+		return false;
+
+	uint32_t size;
+	std::string text;
+	std::mt19937 gen;
+
+	// the 624 words of state take under 7KB as text
+	if (BinaryIO::Read(is, size) && size <= 8192)
+	{
+		text.resize(size);
+		is.read(text.data(), static_cast<std::streamsize>(size));
+		std::istringstream state{text};
+		if (is && state >> gen)
+		{
+			gen_ = gen;
+			return true;
+		}
+	}
+
+	ClearCache();
+	return false;
+};
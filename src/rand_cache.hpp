@@ -16,9 +16,29 @@
 class RandCache : public Cache<std::vector<cache_block_t>>
 {
 public:
-	RandCache(CacheConf cc) : Cache(cc){};
-	bool AccessMemory(const address_t &address, const bool &read) override;
+	RandCache(CacheConf cc) : Cache(cc), seed_{cc.seed_}, gen_{cc.seed_} {};
+	AccessResult Access(const address_t &address, const bool &read) override;
+	AccessResult Fill(const address_t &address, const bool &dirty) override;
+	std::optional<cache_block_t> Invalidate(const address_t &address) override;
+
+	// a flushed cache picks the same victims as a new one
+	void ClearCache() override
+	{
+		Cache::ClearCache();
+		gen_.seed(seed_);
+	};
+
+	// the blocks are followed by the generator state, so a restored cache
+	// picks the same victims as the one that was saved
+	void SaveState(std::ostream &os) const override;
+	bool LoadState(std::istream &is) override;
 
 private:
-	static std::mt19937 kGen;
+	// put a block that is not in the cache into a random way of its index
+	AccessResult Insert(const address_t &address, const bool &dirty);
+
+	// each cache has its own generator, seeded from its config, so its
+	// victims depend only on the seed and its own accesses
+	const uint32_t seed_;
+	std::mt19937 gen_;
 };
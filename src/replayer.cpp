@@ -0,0 +1,75 @@
+/**
+ * filename: replayer.cpp
+ *
+ * description: fills a shared memory ring from a trace file, standing in for
+ *an instrumentation tool
+ *
+ * authors: Chamberlain, David
+ *
+ **/
+
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "shm_ring.hpp"
+#include "util.hpp"
+
+namespace po = boost::program_options;
+
+int main(int argc, char **argv)
+{
+	// clang-format off
+	po::options_description desc{"Options"};
+	desc.add_options()("help,h", "Help prompt")
+		("ring", po::value<std::string>()->default_value("/cache_sim"), "Name of the shared memory ring, created by Main --shm-ring")
+		("stack-trace,s", po::value<std::string>(), "Stack Trace file to replay")
+		("wait", po::value<unsigned int>()->default_value(10), "Seconds to wait for the ring to be created");
+	// clang-format on
+
+	po::variables_map vm;
+	po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+	po::notify(vm);
+
+	if (vm.count("help") || !vm.count("stack-trace"))
+	{
+		std::cout << desc << std::endl;
+		return vm.count("help") ? 0 : 1;
+	}
+
+	const auto st_file{vm["stack-trace"].as<std::string>()};
+	const auto st{Util::ReadStackTraceFile(st_file)};
+	if (!st.has_value())
+	{
+		std::cerr << "Stack Trace file " << st_file << " not found"
+				  << std::endl;
+		return 1;
+	}
+
+	const auto name{vm["ring"].as<std::string>()};
+	const auto deadline{std::chrono::steady_clock::now() +
+						std::chrono::seconds(vm["wait"].as<unsigned int>())};
+	auto ring{ShmRing::Open(name)};
+	while (!ring && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		ring = ShmRing::Open(name);
+	}
+	if (!ring)
+	{
+		std::cerr << "No ring named " << name << std::endl;
+		return 1;
+	}
+
+	ShmRingProducer producer{*ring};
+	for (const auto &ma : st.value())
+		producer.Push(ma);
+	producer.Close();
+
+	std::cout << "Replayed " << st->size() << " accesses, waited for the "
+			  << "consumers " << producer.get_stall_count() << " times"
+			  << std::endl;
+	return 0;
+}
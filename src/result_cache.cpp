@@ -0,0 +1,146 @@
+/**
+ * filename: result_cache.cpp
+ *
+ * description: object file for the on disk cache of simulation results
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "result_cache.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+#include <unistd.h>
+
+#include "binary_io.hpp"
+#include "cache_sim.hpp"
+
+namespace
+{
+// "CSRC" read as a little endian word
+constexpr uint32_t kEntryMagic{0x43525343};
+
+// the key of an entry, stored in the entry to catch hash collisions. Laid out
+// without padding so it can be written as is
+struct EntryKey
+{
+	uint64_t trace_hash;
+	uint32_t magic;
+	uint32_t simulator_version;
+	address_t cache_size;
+	uint8_t line_size;
+	uint8_t associativity;
+	uint8_t replacement_policy;
+	uint8_t write_allocate;
+	uint32_t seed;
+	uint32_t reserved;
+
+	bool operator==(const EntryKey &) const = default;
+};
+
+EntryKey Key(uint64_t trace_hash, const CacheConf &cc)
+{
+	return {trace_hash,
+			kEntryMagic,
+			CacheSimulator::kVersion,
+			cc.cache_size_,
+			static_cast<uint8_t>(cc.line_size_),
+			static_cast<uint8_t>(cc.associativity_),
+			static_cast<uint8_t>(cc.replacement_policy_),
+			cc.write_allocate_,
+			cc.seed_,
+			0};
+}
+
+// 64 bit finalizer of murmur3
+uint64_t Mix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+}  // namespace
+
+ResultCache::ResultCache(std::filesystem::path folder)
+	: folder_{std::move(folder)}
+{
+	std::error_code ec;
+	std::filesystem::create_directories(folder_, ec);
+}
+
+uint64_t ResultCache::HashTrace(const StackTrace &st)
+{
+	// the fields are combined by hand, the padding of MemoryAccess is not
+	// part of the trace
+	uint64_t h{st.size()};
+	for (const auto &ma : st)
+		h = Mix(h ^ (uint64_t{ma.address} << 24 |
+					 uint64_t{ma.last_memory_access_count} << 8 | ma.is_read)) +
+			0x9e3779b97f4a7c15ull;
+	return h;
+}
+
+std::filesystem::path ResultCache::EntryPath(uint64_t trace_hash,
+											 const CacheConf &cc) const
+{
+	const auto key{Key(trace_hash, cc)};
+	uint64_t h{key.trace_hash};
+	h = Mix(h ^ key.simulator_version);
+	h = Mix(h ^ key.cache_size);
+	h = Mix(h ^ (uint64_t{key.line_size} << 24 | uint64_t{key.associativity} << 16 |
+				 uint64_t{key.replacement_policy} << 8 | key.write_allocate));
+	h = Mix(h ^ key.seed);
+
+	std::ostringstream name;
+	name << std::hex << h << ".res";
+	return folder_ / name.str();
+}
+
+std::optional<AccessCounts> ResultCache::Find(uint64_t trace_hash,
+											  const CacheConf &cc) const
+{
+	std::ifstream is{EntryPath(trace_hash, cc), std::ios::binary};
+
+	EntryKey key;
+	AccessCounts counts;
+	if (!BinaryIO::Read(is, key) || !(key == Key(trace_hash, cc)) ||
+		!BinaryIO::Read(is, counts))
+		return {};
+
+	return counts;
+}
+
+bool ResultCache::Store(uint64_t trace_hash,
+						const CacheConf &cc,
+						const AccessCounts &counts) const
+{
+	const auto path{EntryPath(trace_hash, cc)};
+	// a name no other thread or process writing the same entry uses
+	std::ostringstream tmp_name;
+	tmp_name << path.filename().string() << "."
+			 << std::hash<std::thread::id>{}(std::this_thread::get_id()) << "."
+			 << ::getpid() << ".tmp";
+	const auto tmp{folder_ / tmp_name.str()};
+
+	{
+		std::ofstream os{tmp, std::ios::binary | std::ios::trunc};
+		BinaryIO::Write(os, Key(trace_hash, cc));
+		BinaryIO::Write(os, counts);
+		if (!os)
+			return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmp, path, ec);
+	if (!ec)
+		return true;
+
+	std::filesystem::remove(tmp, ec);
+	return false;
+}
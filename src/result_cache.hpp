@@ -0,0 +1,54 @@
+/**
+ * filename: result_cache.hpp
+ *
+ * description: header file for the on disk cache of simulation results
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief remembers the counts of every trace and config simulated before
+ * @description One file per trace and config, keyed by a hash of the trace
+ *contents, the config without its miss penalty and the simulator version.
+ *The counts do not depend on the miss penalty, so one entry gives the results
+ *for every penalty. Safe to share between threads, an entry is written to a
+ *temporary file and renamed into place.
+ **/
+class ResultCache
+{
+private:
+	const std::filesystem::path folder_;
+
+	std::filesystem::path EntryPath(uint64_t trace_hash,
+									const CacheConf &cc) const;
+
+public:
+	// creates the folder if it does not exist
+	ResultCache(std::filesystem::path folder);
+
+	/**
+	 * @brief hash of the accesses of a trace, independent of where it was read
+	 *from
+	 **/
+	static uint64_t HashTrace(const StackTrace &st);
+
+	/**
+	 * @brief the counts stored for the trace and config, nothing if they were
+	 *never stored or were stored by another simulator version
+	 **/
+	std::optional<AccessCounts> Find(uint64_t trace_hash,
+									 const CacheConf &cc) const;
+
+	// false if the entry could not be written
+	bool Store(uint64_t trace_hash,
+			   const CacheConf &cc,
+			   const AccessCounts &counts) const;
+};
@@ -0,0 +1,287 @@
+/**
+ * filename: results_table.cpp
+ *
+ * description: writing results as one row per simulation
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "results_table.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+
+namespace
+{
+// a column value, text is quoted and absent values are left out
+struct Field
+{
+	std::optional<std::string> value;
+	bool is_text{false};
+};
+
+template <typename T>
+std::optional<std::string> Number(T v)
+{
+	// shortest text that reads back as the same value
+	char buf[32];
+	const auto end{std::to_chars(buf, buf + sizeof(buf), v).ptr};
+	return std::string(buf, end);
+}
+
+// the fields of a row, in the order of get_columns
+std::vector<Field> Fields(const ResultsTable::Row &row)
+{
+	const auto &r{row.results};
+	std::vector<Field> fields{
+		{row.stack_trace, true},
+		{row.cache_config, true},
+		{Number(static_cast<unsigned int>(row.cc.line_size_))},
+		{Number(static_cast<unsigned int>(row.cc.associativity_))},
+		{Number(row.cc.cache_size_)},
+		{row.cc.replacement_policy_ == ReplacementPolicy::RAND
+			 ? std::string{"random"}
+			 : std::string{"fifo"},
+		 true},
+		{Number(static_cast<unsigned int>(row.cc.miss_penalty_))},
+		{Number(static_cast<unsigned int>(row.cc.write_allocate_))},
+		{Number(row.cc.seed_)},
+		{Number(r.total_hit_rate)},
+		{Number(r.read_hit_rate)},
+		{Number(r.write_hit_rate)},
+		{Number(r.run_time)},
+		{Number(r.average_memory_access_time)}};
+
+	// components that were not attached leave their columns empty
+	const auto add{[&](bool has_value, std::initializer_list<Field> values)
+				   {
+					   if (has_value)
+						   fields.insert(fields.end(), values);
+					   else
+						   fields.resize(fields.size() + values.size());
+				   }};
+
+	const auto pf{r.prefetch.value_or(PrefetchStats{})};
+	add(r.prefetch.has_value(),
+		{{Number(pf.issued)},
+		 {Number(pf.useful)},
+		 {Number(pf.late)},
+		 {Number(pf.useless)},
+		 {Number(pf.demand_evictions)},
+		 {Number(pf.accuracy)},
+		 {Number(pf.coverage)}});
+	const auto tm{r.timing.value_or(TimingStats{})};
+	add(r.timing.has_value(),
+		{{Number(tm.run_time)},
+		 {Number(tm.average_memory_access_time)},
+		 {Number(tm.mshr_stall_cycles)},
+		 {Number(tm.dependency_stall_cycles)},
+		 {Number(tm.merged_misses)},
+		 {Number(tm.memory_level_parallelism)}});
+	const auto tlb{r.tlb.value_or(TlbStats{})};
+	add(r.tlb.has_value(),
+		{{Number(tlb.accesses)},
+		 {Number(tlb.misses)},
+		 {Number(tlb.huge_accesses)},
+		 {Number(tlb.huge_misses)},
+		 {Number(tlb.hit_rate)},
+		 {Number(tlb.huge_hit_rate)},
+		 {Number(tlb.walk_cycles)}});
+	const auto vc{r.victim.value_or(VictimCacheStats{})};
+	add(r.victim.has_value(),
+		{{Number(vc.probes)},
+		 {Number(vc.hits)},
+		 {Number(vc.hit_rate)},
+		 {Number(vc.insertions)},
+		 {Number(vc.writebacks)},
+		 {Number(vc.swap_cycles)}});
+	const auto wb{r.write_buffer.value_or(WriteBufferStats{})};
+	add(r.write_buffer.has_value(),
+		{{Number(wb.writes)},
+		 {Number(wb.coalesced)},
+		 {Number(wb.coalesce_rate)},
+		 {Number(wb.memory_writes)},
+		 {Number(wb.stall_cycles)}});
+	const auto sm{r.sampling.value_or(SamplingStats{})};
+	add(r.sampling.has_value(),
+		{{Number(sm.intervals)},
+		 {Number(sm.sampled_accesses)},
+		 {Number(sm.warmed_accesses)},
+		 {Number(sm.total_accesses)},
+		 {Number(sm.total_hit_rate_error)},
+		 {Number(sm.run_time_error)},
+		 {Number(sm.average_memory_access_time_error)}});
+	const auto ss{r.set_sampling.value_or(SetSamplingStats{})};
+	add(r.set_sampling.has_value(),
+		{{Number(ss.sampled_sets)},
+		 {Number(ss.total_sets)},
+		 {Number(ss.sampling_ratio)},
+		 {Number(ss.sampled_accesses)},
+		 {Number(ss.total_accesses)},
+		 {Number(ss.total_hit_rate_error)}});
+	return fields;
+}
+
+void AppendCsv(std::string &out, const std::string &s, bool is_text)
+{
+	if (!is_text || s.find_first_of(",\"\n") == std::string::npos)
+	{
+		out += s;
+		return;
+	}
+	out += '"';
+	for (const char c : s)
+	{
+		if (c == '"')
+			out += '"';
+		out += c;
+	}
+	out += '"';
+}
+
+void AppendJson(std::string &out, const std::string &s)
+{
+	out += '"';
+	for (const char c : s)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char buf[8];
+			std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+			out += buf;
+		}
+		else
+			out += c;
+	}
+	out += '"';
+}
+}  // namespace
+
+namespace ResultsTable
+{
+const std::vector<std::string> &get_columns()
+{
+	static const std::vector<std::string> columns{
+		"stack_trace",
+		"cache_config",
+		"line_size",
+		"associativity",
+		"cache_size",
+		"replacement_policy",
+		"miss_penalty",
+		"write_allocate",
+		"replacement_seed",
+		"total_hit_rate",
+		"read_hit_rate",
+		"write_hit_rate",
+		"run_time",
+		"average_memory_access_time",
+		"prefetch_issued",
+		"prefetch_useful",
+		"prefetch_late",
+		"prefetch_useless",
+		"prefetch_demand_evictions",
+		"prefetch_accuracy",
+		"prefetch_coverage",
+		"timing_run_time",
+		"timing_average_memory_access_time",
+		"timing_mshr_stall_cycles",
+		"timing_dependency_stall_cycles",
+		"timing_merged_misses",
+		"timing_memory_level_parallelism",
+		"tlb_accesses",
+		"tlb_misses",
+		"tlb_huge_accesses",
+		"tlb_huge_misses",
+		"tlb_hit_rate",
+		"tlb_huge_hit_rate",
+		"tlb_walk_cycles",
+		"victim_probes",
+		"victim_hits",
+		"victim_hit_rate",
+		"victim_insertions",
+		"victim_writebacks",
+		"victim_swap_cycles",
+		"write_buffer_writes",
+		"write_buffer_coalesced",
+		"write_buffer_coalesce_rate",
+		"write_buffer_memory_writes",
+		"write_buffer_stall_cycles",
+		"sampling_intervals",
+		"sampling_sampled_accesses",
+		"sampling_warmed_accesses",
+		"sampling_total_accesses",
+		"sampling_total_hit_rate_error",
+		"sampling_run_time_error",
+		"sampling_average_memory_access_time_error",
+		"set_sampling_sampled_sets",
+		"set_sampling_total_sets",
+		"set_sampling_sampling_ratio",
+		"set_sampling_sampled_accesses",
+		"set_sampling_total_accesses",
+		"set_sampling_total_hit_rate_error"};
+	return columns;
+}
+
+bool Write(std::ostream &os, const std::vector<Row> &rows, Format format)
+{
+	const auto &columns{get_columns()};
+	// the rows are built in memory and written at once
+	std::string out;
+	if (format == CSV)
+	{
+		for (size_t i{}; i < columns.size(); ++i)
+		{
+			if (i)
+				out += ',';
+			out += columns[i];
+		}
+		out += '\n';
+	}
+
+	for (const auto &row : rows)
+	{
+		const auto fields{Fields(row)};
+		bool first{true};
+		out += format == CSV ? "" : "{";
+		for (size_t i{}; i < fields.size(); ++i)
+		{
+			const auto &f{fields[i]};
+			if (format == CSV)
+			{
+				if (i)
+					out += ',';
+				if (f.value.has_value())
+					AppendCsv(out, f.value.value(), f.is_text);
+				continue;
+			}
+
+			if (!f.value.has_value())
+				continue;
+			if (!first)
+				out += ',';
+			first = false;
+			AppendJson(out, columns[i]);
+			out += ':';
+			if (f.is_text)
+				AppendJson(out, f.value.value());
+			// nan and inf, a rate of no accesses, have no JSON number
+			else if (f.value->find_first_of("ni") != std::string::npos)
+				out += "null";
+			else
+				out += f.value.value();
+		}
+		out += format == CSV ? "\n" : "}\n";
+	}
+
+	os.write(out.data(), static_cast<std::streamsize>(out.size()));
+	return static_cast<bool>(os);
+}
+}  // namespace ResultsTable
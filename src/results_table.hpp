@@ -0,0 +1,47 @@
+/**
+ * filename: results_table.hpp
+ *
+ * description: header file for writing results as one row per simulation
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief results of every stack trace and cache config in one file
+ * @description Every row holds the names of the stack trace and cache config,
+ *the config parameters and every Results field. Fields of components that
+ *were not attached are empty in a CSV row and left out of a JSON line.
+ **/
+namespace ResultsTable
+{
+enum Format
+{
+	CSV,
+	JSONL
+};
+
+struct Row
+{
+	std::string stack_trace;
+	std::string cache_config;
+	CacheConf cc;
+	Results results;
+};
+
+// the column names, in the order of the CSV header
+const std::vector<std::string> &get_columns();
+
+/**
+ * @brief write the rows, with a header line for CSV
+ * @return false if writing failed
+ **/
+bool Write(std::ostream &os, const std::vector<Row> &rows, Format format);
+}  // namespace ResultsTable
@@ -0,0 +1,54 @@
+/**
+ * filename: set_sampling.cpp
+ *
+ * description: object file for simulating a hashed subset of the cache sets
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "set_sampling.hpp"
+
+#include <algorithm>
+#include <bit>
+
+IndexBits GetIndexBits(const CacheConf &cc)
+{
+	const address_t num_indicies{
+		cc.associativity_ ? cc.cache_size_ / (cc.associativity_ * cc.line_size_)
+						  : 1};
+	return {static_cast<uint_fast8_t>(std::bit_width(cc.line_size_) - 1),
+			static_cast<uint_fast8_t>(std::bit_width(num_indicies) - 1)};
+}
+
+SetSampleFilter::SetSampleFilter(const StackTrace &st,
+								 IndexBits index_bits,
+								 uint_fast8_t ratio_bits,
+								 address_t seed)
+	: index_bits_{index_bits},
+	  ratio_bits_{std::min(ratio_bits, index_bits.index_size)},
+	  seed_{seed}
+{
+	const address_t index_mask{get_total_sets() - 1};
+	for (const auto &ma : st)
+	{
+		if (ma.is_read)
+			totals_.reads++;
+		else
+			totals_.writes++;
+		totals_.instructions += ma.last_memory_access_count + 1;
+
+		if (IsSampled((ma.address >> index_bits_.offset_size) & index_mask))
+			accesses_.push_back(ma);
+	}
+}
+
+bool SetSampleFilter::IsSampled(address_t index) const
+{
+	if (ratio_bits_ == 0)
+		return true;
+
+	const address_t index_mask{get_total_sets() - 1};
+	const address_t shuffled{
+		static_cast<address_t>((index ^ seed_) * 0x9e3779b1u) & index_mask};
+	return shuffled >> (index_bits_.index_size - ratio_bits_) == 0;
+}
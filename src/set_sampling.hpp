@@ -0,0 +1,84 @@
+/**
+ * filename: set_sampling.hpp
+ *
+ * description: header file for simulating a hashed subset of the cache sets
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+
+#include "base_structs.hpp"
+
+// the address bits that pick the set of a cache
+struct IndexBits
+{
+	uint_fast8_t offset_size;
+	uint_fast8_t index_size;
+
+	bool operator==(const IndexBits &) const = default;
+	auto operator<=>(const IndexBits &) const = default;
+};
+
+IndexBits GetIndexBits(const CacheConf &cc);
+
+/**
+ * @brief the accesses of a trace that map into a hashed subset of the sets
+ * @description The sets are shuffled by an odd multiply of the index, a
+ *bijection, and the sets landing in the lowest 1 / 2^ratio_bits of the
+ *shuffled range are kept, so exactly that fraction of the sets is sampled
+ *without favouring any stride. The filter only depends on the index bits, so
+ *one filter serves every config with the same line size and number of sets.
+ **/
+class SetSampleFilter
+{
+private:
+	const IndexBits index_bits_;
+	const uint_fast8_t ratio_bits_;
+	const address_t seed_;
+
+	StackTrace accesses_;
+	// reads, writes and instructions of the whole trace
+	AccessCounts totals_{};
+
+public:
+	/**
+	 * @param ratio_bits sample 1 / 2^ratio_bits of the sets, capped at the
+	 *number of index bits
+	 * @param seed picks a different subset of the sets
+	 **/
+	SetSampleFilter(const StackTrace &st,
+					IndexBits index_bits,
+					uint_fast8_t ratio_bits,
+					address_t seed = 0);
+
+	// true if the set with this index is sampled
+	bool IsSampled(address_t index) const;
+
+	const StackTrace &get_accesses() const
+	{
+		return accesses_;
+	};
+
+	const AccessCounts &get_totals() const
+	{
+		return totals_;
+	};
+
+	IndexBits get_index_bits() const
+	{
+		return index_bits_;
+	};
+
+	address_t get_sampled_sets() const
+	{
+		return address_t{1} << (index_bits_.index_size - ratio_bits_);
+	};
+
+	address_t get_total_sets() const
+	{
+		return address_t{1} << index_bits_.index_size;
+	};
+};
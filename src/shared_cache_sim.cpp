@@ -0,0 +1,164 @@
+/**
+ * filename: shared_cache_sim.cpp
+ *
+ * description: object file for simulating several traces sharing one cache
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "shared_cache_sim.hpp"
+
+#include <algorithm>
+#include <limits>
+
+SharedCacheSimulator::SharedCacheSimulator(
+	CacheConf cache_conf,
+	std::vector<uint_fast8_t> way_partition)
+	: cache_conf_{cache_conf}, is_partitioned_{!way_partition.empty()}
+{
+	if (!is_partitioned_)
+	{
+		partitions_.push_back(CacheFactory::CreateCache(cache_conf));
+		return;
+	}
+
+	// every partition keeps the number of indicies of the whole cache
+	const address_t num_indicies{
+		cache_conf.associativity_
+			? cache_conf.cache_size_ /
+				  (cache_conf.associativity_ * cache_conf.line_size_)
+			: 1};
+	for (const auto ways : way_partition)
+	{
+		CacheConf pc{cache_conf};
+		pc.associativity_ = ways;
+		pc.cache_size_ = num_indicies * ways * cache_conf.line_size_;
+		partitions_.push_back(CacheFactory::CreateCache(pc));
+	}
+}
+
+void SharedCacheSimulator::ClearCache()
+{
+	for (auto &partition : partitions_)
+		partition->ClearCache();
+	owners_.clear();
+}
+
+bool SharedCacheSimulator::AccessMemory(uint8_t source,
+										const MemoryAccess &ma,
+										SharedResults &sr)
+{
+	auto &own{*partitions_[std::min<size_t>(source, partitions_.size() - 1)]};
+
+	// blocks in the other sources' ways can still be hit
+	if (is_partitioned_)
+		for (auto &partition : partitions_)
+			if (partition.get() != &own && partition->Contains(ma.address))
+				return partition->AccessMemory(ma.address, ma.is_read);
+
+	const auto ar{own.Access(ma.address, ma.is_read)};
+
+	if (ar.evicted)
+	{
+		const auto owner{
+			owners_.find(own.get_block_address(ar.victim.block_address))};
+		// blocks left over from an earlier run may belong to no source
+		if (owner != owners_.end())
+		{
+			if (owner->second < sr.sources.size())
+			{
+				sr.evictions[source][owner->second]++;
+				sr.sources[source].evictions_caused++;
+				sr.sources[owner->second].evictions_suffered++;
+			}
+			owners_.erase(owner);
+		}
+	}
+
+	if (!ar.hit && (ma.is_read || own.is_write_allocate_))
+		owners_[own.get_block_address(ma.address)] = source;
+
+	return ar.hit;
+}
+
+SharedResults SharedCacheSimulator::SimulateTraces(
+	const std::vector<std::reference_wrapper<const StackTrace>> &traces,
+	InterleavePolicy policy)
+{
+	const auto n{traces.size()};
+
+	SharedResults sr;
+	if (n > kMaxSources)
+		return sr;
+	sr.sources.assign(n, {});
+	sr.evictions.assign(n, std::vector<uint64_t>(n));
+
+	// next access of every trace, and its instruction count clock
+	std::vector<size_t> pos(n);
+	std::vector<uint64_t> clock(n);
+	size_t remaining{static_cast<size_t>(
+		std::count_if(traces.begin(),
+					  traces.end(),
+					  [](const StackTrace &st) { return !st.empty(); }))};
+	size_t next{};
+
+	while (remaining)
+	{
+		size_t source{};
+		if (policy == ROUND_ROBIN)
+		{
+			// skip the traces that have finished
+			while (pos[next] == traces[next].get().size())
+				next = (next + 1) % n;
+			source = next;
+			next = (next + 1) % n;
+		}
+		else
+		{
+			uint64_t earliest{std::numeric_limits<uint64_t>::max()};
+			for (size_t i{}; i < n; ++i)
+			{
+				if (pos[i] == traces[i].get().size())
+					continue;
+				const auto t{clock[i] +
+							 traces[i].get()[pos[i]].last_memory_access_count +
+							 1};
+				if (t < earliest)
+				{
+					earliest = t;
+					source = i;
+				}
+			}
+		}
+
+		const auto &ma{traces[source].get()[pos[source]++]};
+		auto &counts{sr.sources[source].counts};
+		if (ma.is_read)
+			counts.reads++;
+		else
+			counts.writes++;
+		counts.instructions += ma.last_memory_access_count + 1;
+		clock[source] += ma.last_memory_access_count + 1;
+
+		if (!AccessMemory(static_cast<uint8_t>(source), ma, sr))
+		{
+			if (ma.is_read)
+				counts.read_misses++;
+			else
+				counts.write_misses++;
+		}
+
+		if (pos[source] == traces[source].get().size())
+			remaining--;
+	}
+
+	AccessCounts total{};
+	for (auto &source : sr.sources)
+	{
+		source.results = source.counts.ToResults(cache_conf_.miss_penalty_);
+		total += source.counts;
+	}
+	sr.combined = total.ToResults(cache_conf_.miss_penalty_);
+
+	return sr;
+}
@@ -0,0 +1,103 @@
+/**
+ * filename: shared_cache_sim.hpp
+ *
+ * description: header file for simulating several traces sharing one cache
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "base_structs.hpp"
+#include "cache_factory.hpp"
+
+/**
+ * @brief the order accesses from different traces reach the shared cache
+ * @description ROUND_ROBIN : one access from each trace in turn
+ * TIMESTAMP : each trace keeps an instruction count clock from
+ *last_memory_access_count, the trace with the earliest next access goes first
+ **/
+enum InterleavePolicy
+{
+	ROUND_ROBIN,
+	TIMESTAMP
+};
+
+struct SourceResults
+{
+	Results results;
+	AccessCounts counts;
+	// blocks of any source evicted by this source's misses
+	uint64_t evictions_caused;
+	// blocks of this source evicted by any source's misses
+	uint64_t evictions_suffered;
+};
+
+struct SharedResults
+{
+	std::vector<SourceResults> sources;
+	// [evicting source][evicted source] block count
+	std::vector<std::vector<uint64_t>> evictions;
+	Results combined;
+};
+
+/**
+ * @brief several traces interleaved into one cache
+ * @description Every block remembers the source that brought it in, so
+ *evictions can be charged to the source that caused them. With a way
+ *partition each source only allocates into its own ways of every index, but
+ *can still hit on blocks in the other sources' ways.
+ **/
+class SharedCacheSimulator
+{
+private:
+	CacheConf cache_conf_;
+	const bool is_partitioned_;
+	// one cache when unpartitioned, otherwise one per source holding its ways
+	std::vector<std::unique_ptr<CacheBase>> partitions_;
+	// source that brought each block into the cache
+	std::unordered_map<address_t, uint8_t> owners_;
+
+	bool AccessMemory(uint8_t source,
+					  const MemoryAccess &ma,
+					  SharedResults &sr);
+
+public:
+	// sources are tracked in a byte per block
+	static constexpr size_t kMaxSources{256};
+
+	/**
+	 * @param way_partition ways of every index given to each source, empty to
+	 *share every way. Must not add up to more than the associativity, sources
+	 *past the end of the partition share the last partition
+	 **/
+	SharedCacheSimulator(CacheConf cache_conf,
+						 std::vector<uint_fast8_t> way_partition = {});
+
+	/**
+	 * @brief interleave the traces into the cache, trace i is source i. At
+	 *most kMaxSources traces are simulated, an empty result is returned for
+	 *more
+	 **/
+	SharedResults SimulateTraces(
+		const std::vector<std::reference_wrapper<const StackTrace>> &traces,
+		InterleavePolicy policy);
+
+	CacheConf get_cache_config() const
+	{
+		return cache_conf_;
+	};
+
+	bool is_partitioned() const
+	{
+		return is_partitioned_;
+	};
+
+	void ClearCache();
+};
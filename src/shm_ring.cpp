@@ -0,0 +1,207 @@
+/**
+ * filename: shm_ring.cpp
+ *
+ * description: object file for a ring buffer of memory accesses in POSIX
+ *shared memory
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "shm_ring.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <new>
+#include <thread>
+
+namespace
+{
+// "CRNG" read as a little endian word
+constexpr uint32_t kRingMagic{0x474e5243};
+
+// the records start on their own cache line after the header
+constexpr size_t kRecordOffset{(sizeof(ShmRingHeader) + 63) / 64 * 64};
+
+// spins first, then sleeps longer and longer while the other side catches up
+class Backoff
+{
+private:
+	unsigned int waits_{};
+
+public:
+	void Wait()
+	{
+		if (waits_++ < 64)
+			std::this_thread::yield();
+		else
+			std::this_thread::sleep_for(
+				std::chrono::microseconds(std::min(waits_ - 64, 100u)));
+	};
+};
+}  // namespace
+
+ShmRing::ShmRing(std::string name, bool owner, size_t size, void *data)
+	: name_{std::move(name)},
+	  owner_{owner},
+	  size_{size},
+	  header_{static_cast<ShmRingHeader *>(data)},
+	  records_{reinterpret_cast<MemoryAccess *>(static_cast<char *>(data) +
+												kRecordOffset)}
+{}
+
+std::unique_ptr<ShmRing> ShmRing::Create(const std::string &name,
+										 uint64_t capacity,
+										 uint32_t consumers)
+{
+	if (consumers == 0 || consumers > ShmRingHeader::kMaxConsumers ||
+		capacity == 0)
+		return nullptr;
+	capacity = std::bit_ceil(capacity);
+
+	const int fd{::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600)};
+	if (fd < 0)
+		return nullptr;
+
+	const size_t size{kRecordOffset + capacity * sizeof(MemoryAccess)};
+	void *data{MAP_FAILED};
+	if (::ftruncate(fd, static_cast<off_t>(size)) == 0)
+		data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		::shm_unlink(name.c_str());
+		return nullptr;
+	}
+
+	// the object starts zeroed, so only the fixed fields need setting. The
+	// magic goes last, Open refuses the ring until it is there
+	auto *header{new (data) ShmRingHeader{}};
+	header->consumers = consumers;
+	header->capacity = capacity;
+	std::atomic_ref<uint32_t>{header->magic}.store(kRingMagic,
+												   std::memory_order_release);
+
+	return std::unique_ptr<ShmRing>{new ShmRing{name, true, size, data}};
+}
+
+std::unique_ptr<ShmRing> ShmRing::Open(const std::string &name)
+{
+	const int fd{::shm_open(name.c_str(), O_RDWR, 0)};
+	if (fd < 0)
+		return nullptr;
+
+	struct stat sb;
+	void *data{MAP_FAILED};
+	size_t size{};
+	if (::fstat(fd, &sb) == 0 &&
+		static_cast<size_t>(sb.st_size) >= kRecordOffset)
+	{
+		size = static_cast<size_t>(sb.st_size);
+		data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	::close(fd);
+	if (data == MAP_FAILED)
+		return nullptr;
+
+	auto *header{static_cast<ShmRingHeader *>(data)};
+	if (std::atomic_ref<uint32_t>{header->magic}.load(
+			std::memory_order_acquire) != kRingMagic ||
+		size != kRecordOffset + header->capacity * sizeof(MemoryAccess))
+	{
+		::munmap(data, size);
+		return nullptr;
+	}
+
+	return std::unique_ptr<ShmRing>{new ShmRing{name, false, size, data}};
+}
+
+ShmRing::~ShmRing()
+{
+	::munmap(header_, size_);
+	if (owner_)
+		::shm_unlink(name_.c_str());
+}
+
+ShmRingProducer::ShmRingProducer(ShmRing &ring)
+	: ring_{ring},
+	  mask_{ring.get_capacity() - 1},
+	  head_{ring.get_header().head.load(std::memory_order_relaxed)},
+	  published_{head_},
+	  limit_{head_}
+{}
+
+void ShmRingProducer::WaitForSpace()
+{
+	// the consumers can only catch up on what was published
+	Flush();
+
+	auto &header{ring_.get_header()};
+	Backoff backoff;
+	while (true)
+	{
+		uint64_t slowest{head_};
+		for (uint32_t i{}; i < header.consumers; ++i)
+			slowest = std::min(
+				slowest,
+				header.tails[i].position.load(std::memory_order_acquire));
+
+		limit_ = slowest + header.capacity;
+		if (head_ < limit_)
+			return;
+
+		stalls_++;
+		backoff.Wait();
+	}
+}
+
+void ShmRingProducer::Flush()
+{
+	ring_.get_header().head.store(head_, std::memory_order_release);
+	published_ = head_;
+}
+
+void ShmRingProducer::Close()
+{
+	Flush();
+	ring_.get_header().closed.store(1, std::memory_order_release);
+}
+
+ShmRingConsumer::ShmRingConsumer(ShmRing &ring, uint32_t index)
+	: ring_{ring},
+	  index_{index},
+	  mask_{ring.get_capacity() - 1},
+	  tail_{ring.get_header().tails[index].position.load(
+		  std::memory_order_relaxed)}
+{}
+
+std::span<const MemoryAccess> ShmRingConsumer::Next()
+{
+	auto &header{ring_.get_header()};
+	tail_ += pending_;
+	pending_ = 0;
+	header.tails[index_].position.store(tail_, std::memory_order_release);
+
+	Backoff backoff;
+	while (true)
+	{
+		// closed is read first, a head read after it holds every access
+		const bool closed{header.closed.load(std::memory_order_acquire) != 0};
+		const auto head{header.head.load(std::memory_order_acquire)};
+		if (head > tail_)
+		{
+			// only up to the end of the ring, the rest comes with the next call
+			pending_ = std::min(head - tail_, header.capacity - (tail_ & mask_));
+			return {ring_.get_records() + (tail_ & mask_), pending_};
+		}
+		if (closed)
+			return {};
+
+		backoff.Wait();
+	}
+}
@@ -0,0 +1,169 @@
+/**
+ * filename: shm_ring.hpp
+ *
+ * description: header file for a ring buffer of memory accesses in POSIX
+ *shared memory
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief the start of the shared memory object, the records follow it
+ * @description The producer and every consumer keep their position on their
+ *own cache line. Positions count accesses since the ring was created, a
+ *record lives at position % capacity.
+ **/
+struct ShmRingHeader
+{
+	static constexpr uint32_t kMaxConsumers{16};
+
+	uint32_t magic;
+	uint32_t consumers;
+	uint64_t capacity;
+	// set by the producer after its last access was published
+	alignas(64) std::atomic<uint32_t> closed;
+	// accesses published by the producer
+	alignas(64) std::atomic<uint64_t> head;
+	// accesses every consumer is done with
+	struct alignas(64) Tail
+	{
+		std::atomic<uint64_t> position;
+	} tails[kMaxConsumers];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+			  "the ring positions are shared between processes");
+
+/**
+ * @brief a single producer ring of memory accesses in POSIX shared memory
+ * @description Every access is read by each of a fixed number of consumers,
+ *and the producer waits for the slowest one when the ring is full. The
+ *process that creates the ring removes its name when it is done with it.
+ **/
+class ShmRing
+{
+private:
+	const std::string name_;
+	const bool owner_;
+	const size_t size_;
+	ShmRingHeader *header_;
+	MemoryAccess *records_;
+
+	ShmRing(std::string name, bool owner, size_t size, void *data);
+
+public:
+	/**
+	 * @brief create a new ring named name, a name starts with a /
+	 * @param capacity accesses the ring holds, rounded up to a power of 2
+	 * @param consumers processes or threads reading every access
+	 * @return nullptr if the ring could not be created
+	 **/
+	static std::unique_ptr<ShmRing> Create(const std::string &name,
+										   uint64_t capacity,
+										   uint32_t consumers = 1);
+
+	// attach to a ring created by another process, nullptr if there is none
+	static std::unique_ptr<ShmRing> Open(const std::string &name);
+
+	ShmRing(const ShmRing &) = delete;
+	ShmRing &operator=(const ShmRing &) = delete;
+	~ShmRing();
+
+	ShmRingHeader &get_header()
+	{
+		return *header_;
+	};
+
+	MemoryAccess *get_records()
+	{
+		return records_;
+	};
+
+	uint64_t get_capacity() const
+	{
+		return header_->capacity;
+	};
+};
+
+/**
+ * @brief writes accesses into a ring, the producer library
+ * @description Accesses are published to the consumers in batches, Flush
+ *publishes the rest. Push waits while the slowest consumer is a whole ring
+ *behind.
+ **/
+class ShmRingProducer
+{
+private:
+	ShmRing &ring_;
+	const uint64_t mask_;
+	// accesses written and published so far
+	uint64_t head_;
+	uint64_t published_;
+	// head_ can grow up to here before the consumers have to be checked
+	uint64_t limit_;
+	uint64_t stalls_{};
+
+	void WaitForSpace();
+
+public:
+	explicit ShmRingProducer(ShmRing &ring);
+
+	void Push(const MemoryAccess &ma)
+	{
+		if (head_ == limit_) [[unlikely]]
+			WaitForSpace();
+		ring_.get_records()[head_ & mask_] = ma;
+		if (++head_ - published_ >= kPublishBatch) [[unlikely]]
+			Flush();
+	};
+
+	// publish every access pushed so far
+	void Flush();
+
+	// publish every access pushed so far and tell the consumers there are no
+	// more
+	void Close();
+
+	// times Push had to wait for a consumer
+	uint64_t get_stall_count() const
+	{
+		return stalls_;
+	};
+
+	static constexpr uint64_t kPublishBatch{256};
+};
+
+/**
+ * @brief reads every access of a ring, one of its consumers
+ **/
+class ShmRingConsumer
+{
+private:
+	ShmRing &ring_;
+	const uint32_t index_;
+	const uint64_t mask_;
+	uint64_t tail_;
+	// accesses returned by the last call to Next
+	uint64_t pending_{};
+
+public:
+	// index of the consumer, below the consumer count of the ring
+	ShmRingConsumer(ShmRing &ring, uint32_t index);
+
+	/**
+	 * @brief the next published accesses, handing the ones returned by the
+	 *last call back to the producer
+	 * @return waits for the producer, empty once the ring is closed and read
+	 **/
+	std::span<const MemoryAccess> Next();
+};
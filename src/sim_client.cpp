@@ -0,0 +1,130 @@
+/**
+ * filename: sim_client.cpp
+ *
+ * description: object file for a client of the simulation server
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "sim_client.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <sstream>
+
+#include "binary_io.hpp"
+#include "sim_protocol.hpp"
+
+SimClient::~SimClient()
+{
+	if (fd_ >= 0)
+		::close(fd_);
+}
+
+bool SimClient::Connect(const std::string &socket_path)
+{
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(addr.sun_path))
+	{
+		error_ = "socket path too long";
+		return false;
+	}
+	std::strcpy(addr.sun_path, socket_path.c_str());
+
+	fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd_ < 0 ||
+		::connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+	{
+		error_ = "no server listening on " + socket_path;
+		if (fd_ >= 0)
+			::close(fd_);
+		fd_ = -1;
+		return false;
+	}
+
+	return true;
+}
+
+std::optional<uint32_t> SimClient::LoadTrace(const std::string &path)
+{
+	if (!SimProtocol::WriteFrame(fd_, LOAD_TRACE, path))
+	{
+		error_ = "connection closed";
+		return {};
+	}
+
+	const auto frame{SimProtocol::ReadFrame(fd_)};
+	if (!frame.has_value() || frame->type != TRACE_LOADED)
+	{
+		error_ = frame.has_value() ? frame->payload : "connection closed";
+		return {};
+	}
+
+	std::istringstream is{frame->payload};
+	uint32_t id;
+	if (!BinaryIO::Read(is, id))
+	{
+		error_ = "invalid reply";
+		return {};
+	}
+	return id;
+}
+
+bool SimClient::Simulate(const std::vector<uint32_t> &trace_ids,
+						 const std::vector<CacheConf> &confs,
+						 const ResultHandler &handler)
+{
+	std::ostringstream os;
+	BinaryIO::Write(os, static_cast<uint32_t>(trace_ids.size()));
+	for (const auto id : trace_ids)
+		BinaryIO::Write(os, id);
+	BinaryIO::Write(os, static_cast<uint32_t>(confs.size()));
+	for (const auto &cc : confs)
+		SimProtocol::WriteCacheConf(os, cc);
+
+	if (!SimProtocol::WriteFrame(fd_, SIMULATE, os.str()))
+	{
+		error_ = "connection closed";
+		return false;
+	}
+
+	while (true)
+	{
+		const auto frame{SimProtocol::ReadFrame(fd_)};
+		if (!frame.has_value())
+		{
+			error_ = "connection closed";
+			return false;
+		}
+
+		switch (frame->type)
+		{
+			case DONE:
+				return true;
+			case RESULT:
+			{
+				std::istringstream is{frame->payload};
+				uint32_t trace, conf;
+				if (!BinaryIO::Read(is, trace) || !BinaryIO::Read(is, conf))
+					break;
+				const auto res{SimProtocol::ReadResults(is)};
+				if (!res.has_value())
+					break;
+				handler(trace, conf, res.value());
+				continue;
+			}
+			case ERROR:
+				error_ = frame->payload;
+				return false;
+			default:
+				break;
+		}
+
+		error_ = "invalid reply";
+		return false;
+	}
+}
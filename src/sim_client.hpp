@@ -0,0 +1,64 @@
+/**
+ * filename: sim_client.hpp
+ *
+ * description: header file for a client of the simulation server
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief one connection to a SimServer
+ * @description Requests are answered in order, so a client should only be
+ *used by one thread at a time.
+ **/
+class SimClient
+{
+public:
+	// trace and config positions in the request, and their results
+	using ResultHandler = std::function<void(uint32_t, uint32_t, const Results &)>;
+
+private:
+	int fd_{-1};
+	std::string error_;
+
+public:
+	SimClient() = default;
+	SimClient(const SimClient &) = delete;
+	SimClient &operator=(const SimClient &) = delete;
+	~SimClient();
+
+	// false if there is no server listening on the socket
+	bool Connect(const std::string &socket_path);
+
+	/**
+	 * @brief have the server load a Stack Trace file, or find it loaded
+	 *already
+	 * @return the id of the trace on the server
+	 **/
+	std::optional<uint32_t> LoadTrace(const std::string &path);
+
+	/**
+	 * @brief simulate every trace on every config, handler is called for
+	 *each result as it arrives
+	 * @return false if the server refused the request or went away
+	 **/
+	bool Simulate(const std::vector<uint32_t> &trace_ids,
+				  const std::vector<CacheConf> &confs,
+				  const ResultHandler &handler);
+
+	// why the last request failed
+	const std::string &get_error() const
+	{
+		return error_;
+	};
+};
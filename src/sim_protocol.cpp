@@ -0,0 +1,143 @@
+/**
+ * filename: sim_protocol.cpp
+ *
+ * description: object file for the framed protocol of the simulation server
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "sim_protocol.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include "binary_io.hpp"
+
+namespace
+{
+bool WriteAll(int fd, const char *data, size_t size)
+{
+	while (size)
+	{
+		// a client that went away must not kill the server with SIGPIPE
+		const auto n{::send(fd, data, size, MSG_NOSIGNAL)};
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= static_cast<size_t>(n);
+	}
+	return true;
+}
+
+bool ReadAll(int fd, char *data, size_t size)
+{
+	while (size)
+	{
+		const auto n{::recv(fd, data, size, 0)};
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= static_cast<size_t>(n);
+	}
+	return true;
+}
+}  // namespace
+
+namespace SimProtocol
+{
+bool WriteFrame(int fd, MessageType type, const std::string &payload)
+{
+	char header[5];
+	const auto size{static_cast<uint32_t>(payload.size())};
+	std::copy_n(reinterpret_cast<const char *>(&size), 4, header);
+	header[4] = static_cast<char>(type);
+
+	return WriteAll(fd, header, sizeof(header)) &&
+		   WriteAll(fd, payload.data(), payload.size());
+}
+
+std::optional<Frame> ReadFrame(int fd)
+{
+	char header[5];
+	if (!ReadAll(fd, header, sizeof(header)))
+		return {};
+
+	uint32_t size;
+	std::copy_n(header, 4, reinterpret_cast<char *>(&size));
+	const auto type{static_cast<uint8_t>(header[4])};
+	if (size > kMaxPayload || type < LOAD_TRACE || type > ERROR)
+		return {};
+
+	Frame frame{static_cast<MessageType>(type), std::string(size, '\0')};
+	if (!ReadAll(fd, frame.payload.data(), size))
+		return {};
+
+	return frame;
+}
+
+void WriteCacheConf(std::ostream &os, const CacheConf &cc)
+{
+	BinaryIO::Write(os, cc.cache_size_);
+	BinaryIO::Write(os, static_cast<uint8_t>(cc.line_size_));
+	BinaryIO::Write(os, static_cast<uint8_t>(cc.associativity_));
+	BinaryIO::Write(os, static_cast<uint8_t>(cc.replacement_policy_));
+	BinaryIO::Write(os, static_cast<uint8_t>(cc.write_allocate_));
+	BinaryIO::Write(os, static_cast<uint8_t>(cc.miss_penalty_));
+	BinaryIO::Write(os, cc.seed_);
+}
+
+std::optional<CacheConf> ReadCacheConf(std::istream &is)
+{
+	address_t cache_size;
+	uint8_t line_size, associativity, replacement_policy, write_allocate,
+		miss_penalty;
+	uint32_t seed;
+	if (!BinaryIO::Read(is, cache_size) || !BinaryIO::Read(is, line_size) ||
+		!BinaryIO::Read(is, associativity) ||
+		!BinaryIO::Read(is, replacement_policy) ||
+		!BinaryIO::Read(is, write_allocate) ||
+		!BinaryIO::Read(is, miss_penalty) || !BinaryIO::Read(is, seed))
+		return {};
+
+	if (replacement_policy > FIFO)
+		return {};
+
+	CacheConf cc{line_size,
+				 associativity,
+				 cache_size,
+				 static_cast<ReplacementPolicy>(replacement_policy),
+				 miss_penalty,
+				 write_allocate != 0};
+	cc.seed_ = seed;
+	return cc;
+}
+
+void WriteResults(std::ostream &os, const Results &res)
+{
+	BinaryIO::Write(os, res.total_hit_rate);
+	BinaryIO::Write(os, res.read_hit_rate);
+	BinaryIO::Write(os, res.write_hit_rate);
+	BinaryIO::Write(os, res.run_time);
+	BinaryIO::Write(os, res.average_memory_access_time);
+}
+
+std::optional<Results> ReadResults(std::istream &is)
+{
+	Results res{};
+	if (!BinaryIO::Read(is, res.total_hit_rate) ||
+		!BinaryIO::Read(is, res.read_hit_rate) ||
+		!BinaryIO::Read(is, res.write_hit_rate) ||
+		!BinaryIO::Read(is, res.run_time) ||
+		!BinaryIO::Read(is, res.average_memory_access_time))
+		return {};
+
+	return res;
+}
+}  // namespace SimProtocol
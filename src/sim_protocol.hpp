@@ -0,0 +1,67 @@
+/**
+ * filename: sim_protocol.hpp
+ *
+ * description: header file for the framed protocol of the simulation server
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief the messages of the simulation server
+ * @description Every message is a frame of a 4 byte payload length, a 1 byte
+ *type and the payload, in host byte order since both ends share a machine.
+ * LOAD_TRACE : client, path of a Stack Trace file on the server's machine
+ * TRACE_LOADED : server, 4 byte trace id and 8 byte access count
+ * SIMULATE : client, 4 byte trace count and trace ids, then 4 byte config
+ *count and configs. A config is its 4 byte cache size, 1 byte line size,
+ *associativity, replacement policy, write allocate and miss penalty, and 4
+ *byte replacement seed. Every trace is simulated on every config
+ * RESULT : server, 4 byte trace and config positions in the SIMULATE request,
+ *then the results. Sent as each simulation finishes, in no particular order
+ * DONE : server, every result of a SIMULATE request was sent
+ * ERROR : server, a message describing why a request failed
+ **/
+enum MessageType : uint8_t
+{
+	LOAD_TRACE = 1,
+	TRACE_LOADED,
+	SIMULATE,
+	RESULT,
+	DONE,
+	ERROR
+};
+
+struct Frame
+{
+	MessageType type;
+	std::string payload;
+};
+
+namespace SimProtocol
+{
+// largest payload accepted, guards against reading garbage as a length
+constexpr uint32_t kMaxPayload{64 * 1024 * 1024};
+
+// false if the socket was closed
+bool WriteFrame(int fd, MessageType type, const std::string &payload = {});
+
+// nothing if the socket was closed or the frame is invalid
+std::optional<Frame> ReadFrame(int fd);
+
+void WriteCacheConf(std::ostream &os, const CacheConf &cc);
+std::optional<CacheConf> ReadCacheConf(std::istream &is);
+
+// only the fields every simulation sets are sent
+void WriteResults(std::ostream &os, const Results &res);
+std::optional<Results> ReadResults(std::istream &is);
+}  // namespace SimProtocol
@@ -0,0 +1,254 @@
+/**
+ * filename: sim_server.cpp
+ *
+ * description: object file for the resident simulation server
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "sim_server.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <latch>
+#include <sstream>
+#include <thread>
+
+#include "binary_io.hpp"
+
+namespace
+{
+// a config the cache engines can be built from, the engines need at least
+// one way in every index
+bool IsValid(const CacheConf &cc)
+{
+	if (!std::has_single_bit(static_cast<unsigned int>(cc.line_size_)) ||
+		cc.cache_size_ < cc.line_size_ || !cc.associativity_)
+		return false;
+
+	const address_t set_size{
+		static_cast<address_t>(cc.associativity_ * cc.line_size_)};
+	return cc.cache_size_ % set_size == 0 &&
+		   std::has_single_bit(cc.cache_size_ / set_size);
+}
+}  // namespace
+
+SimServer::SimServer(std::string socket_path, TraceLoader loader, size_t threads)
+	: socket_path_{std::move(socket_path)},
+	  loader_{std::move(loader)},
+	  workers_{threads}
+{}
+
+SimServer::~SimServer()
+{
+	Stop();
+
+	// the connection threads use the thread pool, wait for them before it goes
+	std::unique_lock lock{connections_mutex_};
+	connections_cv_.wait(lock, [this]() { return connection_fds_.empty(); });
+}
+
+bool SimServer::Run()
+{
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	if (socket_path_.size() >= sizeof(addr.sun_path))
+		return false;
+	std::strcpy(addr.sun_path, socket_path_.c_str());
+
+	const int fd{::socket(AF_UNIX, SOCK_STREAM, 0)};
+	if (fd < 0)
+		return false;
+
+	// a socket left behind by a server that did not shut down cleanly
+	::unlink(socket_path_.c_str());
+	if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+		::listen(fd, SOMAXCONN) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	{
+		std::lock_guard lock{connections_mutex_};
+		listen_fd_ = fd;
+	}
+
+	while (!stopping_)
+	{
+		const int conn{::accept(fd, nullptr, nullptr)};
+		if (conn < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+
+		std::lock_guard lock{connections_mutex_};
+		if (stopping_)
+		{
+			::close(conn);
+			break;
+		}
+		connection_fds_.push_back(conn);
+		std::thread{[this, conn]() { Serve(conn); }}.detach();
+	}
+
+	{
+		std::lock_guard lock{connections_mutex_};
+		listen_fd_ = -1;
+	}
+	::close(fd);
+	::unlink(socket_path_.c_str());
+	return true;
+}
+
+void SimServer::Stop()
+{
+	std::lock_guard lock{connections_mutex_};
+	stopping_ = true;
+	// wakes the blocked accept and reads, the owning threads close the fds
+	if (listen_fd_ >= 0)
+		::shutdown(listen_fd_, SHUT_RDWR);
+	for (const int fd : connection_fds_)
+		::shutdown(fd, SHUT_RDWR);
+}
+
+void SimServer::Serve(int fd)
+{
+	while (auto frame{SimProtocol::ReadFrame(fd)})
+	{
+		if (frame->type == LOAD_TRACE)
+			LoadTrace(fd, frame->payload);
+		else if (frame->type == SIMULATE)
+			Simulate(fd, frame->payload);
+		else
+			SimProtocol::WriteFrame(fd, ERROR, "unexpected message");
+	}
+
+	std::lock_guard lock{connections_mutex_};
+	::close(fd);
+	std::erase(connection_fds_, fd);
+	connections_cv_.notify_all();
+}
+
+void SimServer::LoadTrace(int fd, const std::string &path)
+{
+	const auto find{[&]() -> std::optional<std::pair<uint32_t, uint64_t>>
+					{
+						const auto it{trace_ids_.find(path)};
+						if (it == trace_ids_.end())
+							return {};
+						return {{it->second, traces_[it->second]->size()}};
+					}};
+
+	std::optional<std::pair<uint32_t, uint64_t>> loaded;
+	{
+		std::lock_guard lock{traces_mutex_};
+		loaded = find();
+	}
+
+	if (!loaded.has_value())
+	{
+		// parsed outside the lock so a slow trace does not hold up the other
+		// connections, two connections may both parse a new trace and the
+		// first one to finish keeps it
+		auto st{loader_(path)};
+		if (!st.has_value())
+		{
+			SimProtocol::WriteFrame(
+				fd, ERROR, "Stack Trace file " + path + " not found");
+			return;
+		}
+		auto trace{std::make_shared<const StackTrace>(std::move(st.value()))};
+
+		std::lock_guard lock{traces_mutex_};
+		loaded = find();
+		if (!loaded.has_value())
+		{
+			const auto id{static_cast<uint32_t>(traces_.size())};
+			loaded = {id, trace->size()};
+			traces_.push_back(std::move(trace));
+			trace_ids_.emplace(path, id);
+		}
+	}
+	const auto [id, accesses]{loaded.value()};
+
+	std::ostringstream os;
+	BinaryIO::Write(os, id);
+	BinaryIO::Write(os, accesses);
+	SimProtocol::WriteFrame(fd, TRACE_LOADED, os.str());
+}
+
+void SimServer::Simulate(int fd, const std::string &request)
+{
+	std::istringstream is{request};
+	std::vector<std::shared_ptr<const StackTrace>> traces;
+	std::vector<CacheConf> confs;
+
+	uint32_t count;
+	if (!BinaryIO::Read(is, count))
+		count = 0;
+	for (uint32_t i{}; i < count; ++i)
+	{
+		uint32_t id;
+		std::shared_ptr<const StackTrace> trace;
+		if (BinaryIO::Read(is, id))
+		{
+			std::lock_guard lock{traces_mutex_};
+			if (id < traces_.size())
+				trace = traces_[id];
+		}
+		if (!trace)
+		{
+			SimProtocol::WriteFrame(fd, ERROR, "unknown trace id");
+			return;
+		}
+		traces.push_back(std::move(trace));
+	}
+
+	if (!BinaryIO::Read(is, count))
+		count = 0;
+	for (uint32_t i{}; i < count; ++i)
+	{
+		const auto cc{SimProtocol::ReadCacheConf(is)};
+		if (!cc.has_value() || !IsValid(cc.value()))
+		{
+			SimProtocol::WriteFrame(fd, ERROR, "invalid cache config");
+			return;
+		}
+		confs.push_back(cc.value());
+	}
+
+	// results of different simulations must not interleave on the socket
+	std::mutex write_mutex;
+	std::latch done{static_cast<std::ptrdiff_t>(traces.size() * confs.size())};
+	for (uint32_t t{}; t < traces.size(); ++t)
+		for (uint32_t c{}; c < confs.size(); ++c)
+			workers_.Submit(
+				[&, t, c]()
+				{
+					auto cs{simulators_.Acquire(confs[c])};
+					const auto res{cs->SimulateTrace(*traces[t])};
+					simulators_.Release(std::move(cs));
+
+					std::ostringstream os;
+					BinaryIO::Write(os, t);
+					BinaryIO::Write(os, c);
+					SimProtocol::WriteResults(os, res);
+					{
+						std::lock_guard lock{write_mutex};
+						SimProtocol::WriteFrame(fd, RESULT, os.str());
+					}
+					done.count_down();
+				});
+
+	done.wait();
+	SimProtocol::WriteFrame(fd, DONE);
+}
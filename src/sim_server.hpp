@@ -0,0 +1,83 @@
+/**
+ * filename: sim_server.hpp
+ *
+ * description: header file for the resident simulation server
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "base_structs.hpp"
+#include "cache_sim_pool.hpp"
+#include "sim_protocol.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief serves simulation requests on a Unix domain socket
+ * @description Traces stay loaded for as long as the server runs, so every
+ *request after the first one for a trace skips reading it. Each connection is
+ *served by its own thread, the simulations of every connection share one
+ *thread pool and one pool of cache simulators. See MessageType for the
+ *protocol.
+ **/
+class SimServer
+{
+public:
+	using TraceLoader =
+		std::function<std::optional<StackTrace>(const std::string &)>;
+
+private:
+	const std::string socket_path_;
+	const TraceLoader loader_;
+
+	int listen_fd_{-1};
+	std::atomic<bool> stopping_{false};
+
+	// traces loaded so far, the id of a trace is its position
+	std::mutex traces_mutex_;
+	std::vector<std::shared_ptr<const StackTrace>> traces_;
+	std::map<std::string, uint32_t> trace_ids_;
+
+	// open connections, each served by a detached thread
+	std::mutex connections_mutex_;
+	std::condition_variable connections_cv_;
+	std::vector<int> connection_fds_;
+
+	CacheSimulatorPool simulators_;
+	ThreadPool workers_;
+
+	void Serve(int fd);
+	void LoadTrace(int fd, const std::string &path);
+	void Simulate(int fd, const std::string &request);
+
+public:
+	/**
+	 * @param loader reads a Stack Trace file named in a LOAD_TRACE request,
+	 *it may be called from several connections at once
+	 * @param threads simulations run at once, 0 for one per hardware thread
+	 **/
+	SimServer(std::string socket_path, TraceLoader loader, size_t threads = 0);
+
+	// Run must have returned before the server is destroyed
+	~SimServer();
+
+	/**
+	 * @brief accept connections until Stop is called
+	 * @return false if the socket could not be created
+	 **/
+	bool Run();
+
+	// make Run return and close every connection, safe from any thread
+	void Stop();
+};
@@ -0,0 +1,56 @@
+/**
+ * filename: thread_pool.cpp
+ *
+ * description: object file for a fixed size pool of worker threads
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threads)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (size_t i{}; i < threads; ++i)
+		workers_.emplace_back([this]() { Work(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock{mutex_};
+		stopping_ = true;
+	}
+	cv_.notify_all();
+	workers_.clear();
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard lock{mutex_};
+		jobs_.push_back(std::move(job));
+	}
+	cv_.notify_one();
+}
+
+void ThreadPool::Work()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock lock{mutex_};
+			cv_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+			if (jobs_.empty())
+				return;
+			job = std::move(jobs_.front());
+			jobs_.pop_front();
+		}
+		job();
+	}
+}
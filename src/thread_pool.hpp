@@ -0,0 +1,48 @@
+/**
+ * filename: thread_pool.hpp
+ *
+ * description: header file for a fixed size pool of worker threads
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief runs submitted jobs on a fixed number of threads, in the order they
+ *were submitted
+ * @description The destructor finishes every job already submitted before
+ *joining the threads.
+ **/
+class ThreadPool
+{
+private:
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<std::function<void()>> jobs_;
+	bool stopping_{false};
+	std::vector<std::jthread> workers_;
+
+	void Work();
+
+public:
+	// 0 threads uses one per hardware thread
+	ThreadPool(size_t threads = 0);
+
+	~ThreadPool();
+
+	void Submit(std::function<void()> job);
+
+	size_t get_thread_count() const
+	{
+		return workers_.size();
+	};
+};
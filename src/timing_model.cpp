@@ -0,0 +1,61 @@
+/**
+ * filename: timing_model.cpp
+ *
+ * description: object file for the non-blocking cache timing model
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "timing_model.hpp"
+
+#include <algorithm>
+
+void MshrTimingModel::Allocate(address_t block_address)
+{
+	auto mshr{std::min_element(mshrs_.begin(),
+							   mshrs_.end(),
+							   [](const Mshr &a, const Mshr &b)
+							   { return a.ready < b.ready; })};
+
+	// every MSHR is busy, wait for the first one to finish
+	if (mshr->ready > now_)
+	{
+		stats_.mshr_stall_cycles += mshr->ready - now_;
+		now_ = mshr->ready;
+	}
+
+	*mshr = {.block_address = block_address, .ready = now_ + miss_penalty_};
+	primary_misses_++;
+
+	// misses start in order and all take the same time, so the union of the
+	// busy intervals only ever grows at the end
+	busy_cycles_ += mshr->ready - std::max(now_, busy_until_);
+	busy_until_ = mshr->ready;
+}
+
+TimingStats MshrTimingModel::get_stats() const
+{
+	TimingStats ts{stats_};
+
+	ts.run_time = std::max(now_, busy_until_);
+	ts.average_memory_access_time =
+		1 + static_cast<double>(ts.mshr_stall_cycles +
+								ts.dependency_stall_cycles) /
+				static_cast<double>(accesses_);
+	ts.memory_level_parallelism =
+		static_cast<double>(primary_misses_ * miss_penalty_) /
+		static_cast<double>(busy_cycles_);
+
+	return ts;
+}
+
+void MshrTimingModel::Reset()
+{
+	std::fill(mshrs_.begin(), mshrs_.end(), Mshr{});
+	now_ = 0;
+	accesses_ = 0;
+	primary_misses_ = 0;
+	busy_cycles_ = 0;
+	busy_until_ = 0;
+	stats_ = {};
+}
@@ -0,0 +1,94 @@
+/**
+ * filename: timing_model.hpp
+ *
+ * description: header file for the non-blocking cache timing model
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief timing of a non-blocking cache with miss status holding registers
+ * @description Every access takes one cycle after the instructions before it.
+ *A miss that allocates takes an MSHR for miss_penalty cycles and the cpu keeps
+ *going, so independent misses overlap. The cpu only stalls when every MSHR is
+ *busy, or when a load touches a block that is still being fetched. Misses to
+ *a block that already has an MSHR are merged into it. Writes that do not
+ *allocate go straight to memory and never stall.
+ **/
+class MshrTimingModel
+{
+private:
+	struct Mshr
+	{
+		address_t block_address;
+		// cycle the block arrives
+		uint64_t ready;
+	};
+
+	const uint64_t miss_penalty_;
+	const bool is_write_allocate_;
+	std::vector<Mshr> mshrs_;
+
+	uint64_t now_{};
+	uint64_t accesses_{};
+	uint64_t primary_misses_{};
+	// cycles with at least one miss in flight
+	uint64_t busy_cycles_{};
+	uint64_t busy_until_{};
+	TimingStats stats_{};
+
+	// start a fetch for block_address at the current cycle
+	void Allocate(address_t block_address);
+
+public:
+	MshrTimingModel(uint_fast8_t num_mshrs,
+					uint64_t miss_penalty,
+					bool is_write_allocate)
+		: miss_penalty_{miss_penalty},
+		  is_write_allocate_{is_write_allocate},
+		  mshrs_(num_mshrs ? num_mshrs : 1) {};
+
+	/**
+	 * @brief advance the clock over one access
+	 * @param gap instructions since the last memory access
+	 **/
+	void Access(uint16_t gap, address_t block_address, bool hit, bool is_read)
+	{
+		now_ += gap + 1;
+		accesses_++;
+
+		// cheap check for the common case of nothing in flight
+		if (busy_until_ > now_)
+		{
+			for (auto &mshr : mshrs_)
+			{
+				if (mshr.block_address == block_address && mshr.ready > now_)
+				{
+					stats_.merged_misses += !hit;
+					if (is_read)
+					{
+						stats_.dependency_stall_cycles += mshr.ready - now_;
+						now_ = mshr.ready;
+					}
+					return;
+				}
+			}
+		}
+
+		if (!hit && (is_read || is_write_allocate_))
+			Allocate(block_address);
+	};
+
+	// stats since the last reset, waiting for every miss in flight to finish
+	TimingStats get_stats() const;
+
+	// start a new run at cycle 0
+	void Reset();
+};
@@ -0,0 +1,152 @@
+/**
+ * filename: tlb.cpp
+ *
+ * description: object file for the translation lookaside buffer model
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "tlb.hpp"
+
+#include <bit>
+
+#include "cache_factory.hpp"
+
+namespace
+{
+// the part of the config a saved TLB state depends on, laid out without
+// padding so it can be written as is
+struct TlbGeometry
+{
+	address_t page_size;
+	address_t huge_page_size;
+	uint16_t entries;
+	uint16_t huge_entries;
+	uint8_t associativity;
+	uint8_t huge_associativity;
+	uint8_t replacement_policy;
+	uint8_t reserved;
+
+	bool operator==(const TlbGeometry &) const = default;
+};
+
+TlbGeometry Geometry(const TlbConf &tc)
+{
+	return {tc.page_size_,
+			tc.huge_page_size_,
+			tc.entries_,
+			tc.huge_entries_,
+			static_cast<uint8_t>(tc.associativity_),
+			static_cast<uint8_t>(tc.huge_associativity_),
+			static_cast<uint8_t>(tc.replacement_policy_),
+			0};
+}
+
+// a TLB is a cache of one byte lines, each holding a page number. The walk
+// penalty is kept by the TLB, not the cache
+CacheConf PageNumberCache(uint16_t entries,
+						  uint_fast8_t associativity,
+						  ReplacementPolicy replacement_policy)
+{
+	return {1, associativity, entries, replacement_policy, 0, true};
+}
+}  // namespace
+
+Tlb::Tlb(const TlbConf &tc)
+	: tlb_conf_{tc},
+	  page_shift_{static_cast<uint_fast8_t>(std::bit_width(tc.page_size_) - 1)},
+	  huge_page_shift_{
+		  static_cast<uint_fast8_t>(std::bit_width(tc.huge_page_size_) - 1)},
+	  tlb_{CacheFactory::CreateCache(PageNumberCache(
+		  tc.entries_, tc.associativity_, tc.replacement_policy_))}
+{
+	if (tc.huge_entries_)
+		huge_tlb_ = CacheFactory::CreateCache(
+			PageNumberCache(tc.huge_entries_,
+							tc.huge_associativity_,
+							tc.replacement_policy_));
+}
+
+bool Tlb::IsHugePage(address_t address) const
+{
+	for (const auto &region : tlb_conf_.huge_regions_)
+		if (address >= region.first && address <= region.second)
+			return true;
+	return false;
+}
+
+bool Tlb::Lookup(address_t address, bool huge)
+{
+	if (!huge)
+		return tlb_->AccessMemory(address >> page_shift_, true);
+
+	const address_t page{address >> huge_page_shift_};
+	return huge_tlb_ ? huge_tlb_->AccessMemory(page, true)
+					 : tlb_->AccessMemory(page | kHugePageTag, true);
+}
+
+bool Tlb::Translate(address_t address)
+{
+	const bool huge{!tlb_conf_.huge_regions_.empty() && IsHugePage(address)};
+	const bool hit{Lookup(address, huge)};
+	stats_.accesses++;
+
+	if (huge)
+	{
+		stats_.huge_accesses++;
+		stats_.huge_misses += !hit;
+	}
+
+	if (!hit)
+	{
+		stats_.misses++;
+		stats_.walk_cycles += tlb_conf_.walk_penalty_;
+	}
+
+	return hit;
+}
+
+TlbStats Tlb::get_stats() const
+{
+	TlbStats ts{stats_};
+
+	ts.hit_rate = 1.0f - static_cast<double>(ts.misses) /
+							 static_cast<double>(ts.accesses);
+	ts.huge_hit_rate = 1.0f - static_cast<double>(ts.huge_misses) /
+								  static_cast<double>(ts.huge_accesses);
+
+	return ts;
+}
+
+void Tlb::ClearCache()
+{
+	tlb_->ClearCache();
+	if (huge_tlb_)
+		huge_tlb_->ClearCache();
+}
+
+void Tlb::SaveState(std::ostream &os) const
+{
+	BinaryIO::Write(os, Geometry(tlb_conf_));
+	tlb_->SaveState(os);
+	if (huge_tlb_)
+		huge_tlb_->SaveState(os);
+}
+
+bool Tlb::LoadState(std::istream &is)
+{
+	TlbGeometry geometry;
+	if (!BinaryIO::Read(is, geometry) || !(geometry == Geometry(tlb_conf_)))
+	{
+		ClearCache();
+		return false;
+	}
+
+	if (!tlb_->LoadState(is) || (huge_tlb_ && !huge_tlb_->LoadState(is)))
+	{
+		ClearCache();
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,92 @@
+/**
+ * filename: tlb.hpp
+ *
+ * description: header file for the translation lookaside buffer model
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+
+#include "base_structs.hpp"
+#include "cache.hpp"
+
+/**
+ * @brief a TLB that sits beside the data cache
+ * @description The TLB is a set associative cache of page numbers, built with
+ *the cache factory so it uses the same engines and replacement policies as the
+ *data cache. Addresses in a huge page region are translated by the huge page
+ *TLB, or by the base page TLB when there is no huge page TLB. A miss costs a
+ *page walk.
+ **/
+class Tlb
+{
+private:
+	const TlbConf tlb_conf_;
+	const uint_fast8_t page_shift_;
+	const uint_fast8_t huge_page_shift_;
+
+	std::unique_ptr<CacheBase> tlb_;
+	std::unique_ptr<CacheBase> huge_tlb_;
+
+	TlbStats stats_{};
+
+	// sets the huge page numbers apart from the base page numbers when both
+	// share one TLB
+	static constexpr address_t kHugePageTag{address_t{1}
+											<< (8 * sizeof(address_t) - 1)};
+
+	bool IsHugePage(address_t address) const;
+
+	// look up the page holding address in the TLB that translates it
+	bool Lookup(address_t address, bool huge);
+
+public:
+	Tlb(const TlbConf &tc);
+
+	/**
+	 * @brief translate the page holding address, true on hit
+	 **/
+	bool Translate(address_t address);
+
+	// update the translations for address without counting it in the
+	// statistics
+	void Warm(address_t address)
+	{
+		Lookup(address,
+			   !tlb_conf_.huge_regions_.empty() && IsHugePage(address));
+	};
+
+	// statistics since the last reset
+	TlbStats get_stats() const;
+
+	void ResetStats()
+	{
+		stats_ = {};
+	};
+
+	// flush every translation
+	void ClearCache();
+
+	/**
+	 * @brief write the TLB geometry and the translations it holds
+	 **/
+	void SaveState(std::ostream &os) const;
+
+	/**
+	 * @brief restore translations saved by a TLB with the same geometry
+	 * @return false if the geometry differs or the state is truncated, the
+	 *TLB is left flushed
+	 **/
+	bool LoadState(std::istream &is);
+
+	TlbConf get_tlb_config() const
+	{
+		return tlb_conf_;
+	};
+};
@@ -0,0 +1,89 @@
+/**
+ * filename: trace_stages.cpp
+ *
+ * description: lazy stages that reshape a trace on its way into a cache sim
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "trace_stages.hpp"
+
+#include <charconv>
+#include <string_view>
+
+namespace
+{
+// the fields of s between the colons
+std::vector<std::string_view> Fields(std::string_view s)
+{
+	std::vector<std::string_view> fields;
+	for (const auto field : s | std::views::split(':'))
+		fields.emplace_back(field.begin(), field.end());
+	return fields;
+}
+
+std::optional<uint64_t> Number(std::string_view s, int base)
+{
+	if (base == 16 && (s.starts_with("0x") || s.starts_with("0X")))
+		s.remove_prefix(2);
+	uint64_t n;
+	const auto [end, ec]{std::from_chars(s.data(), s.data() + s.size(), n, base)};
+	if (ec != std::errc{} || end != s.data() + s.size() || s.empty())
+		return {};
+	return n;
+}
+}  // namespace
+
+namespace TraceStages
+{
+std::optional<Stage> ParseStage(const std::string& s)
+{
+	const auto fields{Fields(s)};
+	if (fields.empty())
+		return {};
+	const auto name{fields[0]};
+	const auto arg{[&](size_t i, int base) -> std::optional<uint64_t>
+				   {
+					   if (i >= fields.size())
+						   return {};
+					   return Number(fields[i], base);
+				   }};
+
+	if (name == "loads" && fields.size() == 1)
+		return Stage{.type = LOADS, .first = 0, .last = 0};
+	if (name == "stores" && fields.size() == 1)
+		return Stage{.type = STORES, .first = 0, .last = 0};
+	if (name == "range" && fields.size() == 3)
+	{
+		const auto first{arg(1, 16)};
+		const auto last{arg(2, 16)};
+		if (!first || !last || *first > *last)
+			return {};
+		return Stage{.type = RANGE, .first = *first, .last = *last};
+	}
+	if (name == "every" && (fields.size() == 2 || fields.size() == 3))
+	{
+		const auto n{arg(1, 10)};
+		const auto phase{fields.size() == 3 ? arg(2, 10) : uint64_t{}};
+		if (!n || *n == 0 || !phase || *phase >= *n)
+			return {};
+		return Stage{.type = EVERY, .first = *n, .last = *phase};
+	}
+	if (name == "slice" && fields.size() == 3)
+	{
+		const auto first{arg(1, 10)};
+		const auto count{arg(2, 10)};
+		if (!first || !count)
+			return {};
+		return Stage{.type = SLICE, .first = *first, .last = *count};
+	}
+	if (name == "xor" && fields.size() == 2)
+	{
+		const auto mask{arg(1, 16)};
+		if (!mask)
+			return {};
+		return Stage{.type = XOR, .first = *mask, .last = 0};
+	}
+	return {};
+}
+}  // namespace TraceStages
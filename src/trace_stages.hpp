@@ -0,0 +1,361 @@
+/**
+ * filename: trace_stages.hpp
+ *
+ * description: header file for lazy stages that reshape a trace on its way
+ *into a cache sim
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief a stage an access passes through
+ * @description LOADS, STORES : keep only reads or only writes
+ * RANGE : keep addresses in [first, last]
+ * EVERY : keep every first'th access reaching the stage, starting at last
+ * SLICE : keep count accesses reaching the stage after skipping first, the
+ *stage is then done
+ * XOR : flip the address bits set in first
+ **/
+enum StageType
+{
+	LOADS,
+	STORES,
+	RANGE,
+	EVERY,
+	SLICE,
+	XOR
+};
+
+struct Stage
+{
+	StageType type;
+	uint64_t first;
+	// last of RANGE and EVERY, count of SLICE
+	uint64_t last;
+};
+
+/**
+ * @brief the accesses of base passed through stages in order, one at a time
+ * @description Nothing is copied, each access is pulled from base when the
+ *iterator reaches it. The stages of a runtime pipeline are a plain vector,
+ *so a pipeline from the command line is a single view and not a type per
+ *stage. An input range, iterate it once.
+ **/
+template <std::ranges::input_range V>
+	requires std::ranges::view<V>
+class StagedView : public std::ranges::view_interface<StagedView<V>>
+{
+private:
+	V base_;
+	std::vector<Stage> stages_;
+
+public:
+	class Iterator
+	{
+	private:
+		std::ranges::iterator_t<V> it_;
+		std::ranges::sentinel_t<V> end_;
+		const std::vector<Stage>* stages_{nullptr};
+		// accesses that reached each EVERY and SLICE stage
+		std::vector<uint64_t> reached_;
+		MemoryAccess current_{};
+		// a SLICE stage is past its last access
+		bool done_{false};
+
+		// true if current_ passes every stage, transformed by them
+		bool Pass()
+		{
+			for (size_t k{}; k < stages_->size(); ++k)
+			{
+				const auto& s{(*stages_)[k]};
+				switch (s.type)
+				{
+					case LOADS:
+						if (!current_.is_read)
+							return false;
+						break;
+					case STORES:
+						if (current_.is_read)
+							return false;
+						break;
+					case RANGE:
+						if (current_.address < s.first ||
+							current_.address > s.last)
+							return false;
+						break;
+					case EVERY:
+						if (reached_[k]++ % s.first != s.last)
+							return false;
+						break;
+					case SLICE:
+					{
+						const auto n{reached_[k]++};
+						if (n < s.first)
+							return false;
+						if (n - s.first >= s.last)
+						{
+							done_ = true;
+							return false;
+						}
+						break;
+					}
+					case XOR:
+						current_.address ^= static_cast<address_t>(s.first);
+						break;
+				}
+			}
+			return true;
+		};
+
+		// move to the first access from it_ on that passes
+		void Settle()
+		{
+			for (; !done_ && it_ != end_; ++it_)
+			{
+				current_ = *it_;
+				if (Pass())
+					return;
+			}
+		};
+
+	public:
+		using value_type = MemoryAccess;
+		using difference_type = std::ptrdiff_t;
+
+		Iterator() = default;
+
+		Iterator(std::ranges::iterator_t<V> it,
+				 std::ranges::sentinel_t<V> end,
+				 const std::vector<Stage>& stages)
+			: it_{std::move(it)},
+			  end_{std::move(end)},
+			  stages_{&stages},
+			  reached_(stages.size())
+		{
+			Settle();
+		}
+
+		const MemoryAccess& operator*() const
+		{
+			return current_;
+		};
+
+		Iterator& operator++()
+		{
+			++it_;
+			Settle();
+			return *this;
+		};
+
+		void operator++(int)
+		{
+			++*this;
+		};
+
+		friend bool operator==(const Iterator& i, std::default_sentinel_t)
+		{
+			return i.done_ || i.it_ == i.end_;
+		}
+	};
+
+	StagedView(V base, std::vector<Stage> stages)
+		: base_{std::move(base)}, stages_{std::move(stages)}
+	{}
+
+	Iterator begin()
+	{
+		return {std::ranges::begin(base_), std::ranges::end(base_), stages_};
+	};
+
+	std::default_sentinel_t end() const
+	{
+		return std::default_sentinel;
+	};
+};
+
+/**
+ * @brief the traces one access of each in turn, a trace that runs out drops
+ *out of the rotation
+ **/
+class InterleaveView : public std::ranges::view_interface<InterleaveView>
+{
+private:
+	std::vector<std::reference_wrapper<const StackTrace>> traces_;
+
+public:
+	class Iterator
+	{
+	private:
+		const std::vector<std::reference_wrapper<const StackTrace>>* traces_{
+			nullptr};
+		// next access of each trace
+		std::vector<size_t> next_;
+		size_t source_{};
+		bool done_{true};
+
+		// the first trace from source on with accesses left
+		void Settle(size_t source)
+		{
+			for (size_t n{}; n < traces_->size(); ++n)
+			{
+				const auto s{(source + n) % traces_->size()};
+				if (next_[s] < (*traces_)[s].get().size())
+				{
+					source_ = s;
+					return;
+				}
+			}
+			done_ = true;
+		};
+
+	public:
+		using value_type = MemoryAccess;
+		using difference_type = std::ptrdiff_t;
+
+		Iterator() = default;
+
+		Iterator(
+			const std::vector<std::reference_wrapper<const StackTrace>>& traces)
+			: traces_{&traces}, next_(traces.size()), done_{false}
+		{
+			Settle(0);
+		}
+
+		const MemoryAccess& operator*() const
+		{
+			return (*traces_)[source_].get()[next_[source_]];
+		};
+
+		Iterator& operator++()
+		{
+			next_[source_]++;
+			Settle(source_ + 1);
+			return *this;
+		};
+
+		void operator++(int)
+		{
+			++*this;
+		};
+
+		friend bool operator==(const Iterator& i, std::default_sentinel_t)
+		{
+			return i.done_;
+		}
+	};
+
+	InterleaveView(std::vector<std::reference_wrapper<const StackTrace>> traces)
+		: traces_{std::move(traces)}
+	{}
+
+	Iterator begin() const
+	{
+		return {traces_};
+	};
+
+	std::default_sentinel_t end() const
+	{
+		return std::default_sentinel;
+	};
+};
+
+/**
+ * @brief lazy stages to pipe a trace through before SimulateTrace, e.g.
+ *cs.SimulateTrace(st | TraceStages::Loads() | TraceStages::Every(10))
+ * @description LOADS, STORES, RANGE, SLICE and remaps are standard views.
+ *Every and Apply are StagedViews, Apply runs a pipeline built at runtime.
+ **/
+namespace TraceStages
+{
+// pipes a range into a StagedView of stages
+struct Apply
+{
+	std::vector<Stage> stages;
+
+	template <std::ranges::viewable_range R>
+	friend auto operator|(R&& r, Apply a)
+	{
+		return StagedView{std::views::all(std::forward<R>(r)),
+						  std::move(a.stages)};
+	}
+};
+
+inline auto Loads()
+{
+	return std::views::filter([](const MemoryAccess& ma)
+							  { return ma.is_read; });
+}
+
+inline auto Stores()
+{
+	return std::views::filter([](const MemoryAccess& ma)
+							  { return !ma.is_read; });
+}
+
+// addresses in [first, last]
+inline auto InRange(address_t first, address_t last)
+{
+	return std::views::filter(
+		[=](const MemoryAccess& ma)
+		{ return ma.address >= first && ma.address <= last; });
+}
+
+inline auto Slice(size_t first, size_t count)
+{
+	return std::views::drop(first) | std::views::take(count);
+}
+
+inline Apply Every(uint64_t n, uint64_t phase = 0)
+{
+	return {{{.type = EVERY, .first = n, .last = phase}}};
+}
+
+// replace every address with f(address)
+template <typename F>
+auto Remap(F f)
+{
+	return std::views::transform(
+		[f](MemoryAccess ma)
+		{
+			ma.address = f(ma.address);
+			return ma;
+		});
+}
+
+// the traces one after the other, they must outlive the view
+inline auto Concat(
+	const std::vector<std::reference_wrapper<const StackTrace>>& traces)
+{
+	return traces |
+		   std::views::transform([](const auto& st) -> const StackTrace&
+								 { return st.get(); }) |
+		   std::views::join;
+}
+
+// the traces one access of each in turn, they must outlive the view
+inline InterleaveView Interleave(
+	std::vector<std::reference_wrapper<const StackTrace>> traces)
+{
+	return {std::move(traces)};
+}
+
+/**
+ * @brief a stage from the command line: loads, stores, range:<first>:<last>,
+ *every:<n>[:<phase>], slice:<first>:<count> or xor:<mask>. Addresses and
+ *masks are hex, counts decimal
+ **/
+std::optional<Stage> ParseStage(const std::string& s);
+}  // namespace TraceStages
@@ -9,13 +9,147 @@
 
 #include "util.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <ios>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include "base_structs.hpp"
+#include "binary_io.hpp"
+#include "result_cache.hpp"
+
+namespace
+{
+// "CSTB" read as a little endian word
+constexpr uint32_t kSidecarMagic{0x42545343};
+constexpr uint32_t kSidecarVersion{1};
+
+static_assert(sizeof(MemoryAccess) == 8,
+			  "the sidecar stores the accesses as they are laid out in memory");
+
+// what the sidecar was made from, laid out without padding so it can be
+// written as is
+struct SidecarHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	// size and modification time of the trace
+	uint64_t trace_size;
+	int64_t trace_mtime;
+	// ResultCache::HashTrace of the accesses, catches a damaged sidecar
+	uint64_t trace_hash;
+	uint64_t accesses;
+};
+
+std::filesystem::path SidecarPath(const std::filesystem::path &trace,
+								  const std::string &sidecar_folder)
+{
+	if (sidecar_folder.empty())
+		return trace.string() + ".stbin";
+
+	// traces with the same name in different folders get their own sidecar
+	std::error_code ec;
+	auto absolute{std::filesystem::weakly_canonical(trace, ec)};
+	if (ec)
+		absolute = trace;
+	std::ostringstream name;
+	name << trace.filename().string() << "." << std::hex
+		 << std::hash<std::string>{}(absolute.string()) << ".stbin";
+	return std::filesystem::path{sidecar_folder} / name.str();
+}
+
+// the trace in the sidecar, if it was made from a trace of this size and
+// modification time
+std::optional<StackTrace> MapSidecar(const std::filesystem::path &sidecar,
+									 uint64_t trace_size,
+									 int64_t trace_mtime)
+{
+	const int fd{::open(sidecar.c_str(), O_RDONLY)};
+	if (fd < 0)
+		return {};
+
+	struct stat sb;
+	if (::fstat(fd, &sb) != 0 ||
+		static_cast<size_t>(sb.st_size) < sizeof(SidecarHeader))
+	{
+		::close(fd);
+		return {};
+	}
+
+	const auto size{static_cast<size_t>(sb.st_size)};
+	void *data{::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+	::close(fd);
+	if (data == MAP_FAILED)
+		return {};
+
+	std::optional<StackTrace> st;
+	SidecarHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic == kSidecarMagic && header.version == kSidecarVersion &&
+		header.trace_size == trace_size && header.trace_mtime == trace_mtime &&
+		(size - sizeof(header)) % sizeof(MemoryAccess) == 0 &&
+		header.accesses == (size - sizeof(header)) / sizeof(MemoryAccess))
+	{
+		const auto *first{reinterpret_cast<const MemoryAccess *>(
+			static_cast<const char *>(data) + sizeof(header))};
+		st.emplace(first, first + header.accesses);
+		if (ResultCache::HashTrace(*st) != header.trace_hash)
+			st.reset();
+	}
+
+	::munmap(data, size);
+	return st;
+}
+
+void WriteSidecar(const std::filesystem::path &sidecar,
+				  const StackTrace &st,
+				  uint64_t trace_size,
+				  int64_t trace_mtime)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(sidecar.parent_path(), ec);
+
+	// written under another name first, so a reader never sees half of it.
+	// The server may write the same trace from two threads
+	std::ostringstream writer;
+	writer << ::getpid() << '.' << std::this_thread::get_id();
+	auto tmp{sidecar};
+	tmp += "." + writer.str() + ".tmp";
+	{
+		std::ofstream os{tmp, std::ios::binary | std::ios::trunc};
+		BinaryIO::Write(os,
+						SidecarHeader{.magic = kSidecarMagic,
+									  .version = kSidecarVersion,
+									  .trace_size = trace_size,
+									  .trace_mtime = trace_mtime,
+									  .trace_hash = ResultCache::HashTrace(st),
+									  .accesses = st.size()});
+		os.write(reinterpret_cast<const char *>(st.data()),
+				 static_cast<std::streamsize>(st.size() * sizeof(MemoryAccess)));
+		if (!os)
+		{
+			os.close();
+			std::filesystem::remove(tmp, ec);
+			return;
+		}
+	}
+
+	std::filesystem::rename(tmp, sidecar, ec);
+	if (ec)
+		std::filesystem::remove(tmp, ec);
+}
+}  // namespace
 
 namespace Util
 {
@@ -52,11 +186,16 @@ std::optional<CacheConf> ReadCacheConfFile(const std::string &s)
 	conf.miss_penalty_ = static_cast<uint_fast8_t>(tmp);
 	file >> tmp;
 	conf.write_allocate_ = static_cast<uint_fast8_t>(tmp);
+	// the replacement seed is optional
+	if (file >> tmp)
+		conf.seed_ = tmp;
 
 	return conf;
 }
 
-std::optional<StackTrace> ReadStackTraceFile(const std::string &s)
+std::optional<StackTrace> ReadStackTraceFile(
+	const std::string &s,
+	std::optional<AddressMap> *address_map)
 {
 	StackTrace st;
 	std::ifstream file(s, std::ios_base::in);
@@ -67,6 +206,9 @@ std::optional<StackTrace> ReadStackTraceFile(const std::string &s)
 	std::string address;
 	unsigned int last_memory_access_count;
 	MemoryAccess ma{};
+	// every address, kept once one of them does not fit in address_t
+	std::vector<uint64_t> wide;
+	bool is_wide{false};
 	while (file >> is_read >> address >> last_memory_access_count)
 	{
 		if (is_read == 'l')
@@ -74,14 +216,174 @@ std::optional<StackTrace> ReadStackTraceFile(const std::string &s)
 		else
 			ma.is_read = false;
 
-		ma.address =
-			static_cast<address_t>(std::stoul(address.substr(2), 0, 16));
+		const uint64_t a{std::stoull(address.substr(2), 0, 16)};
+		if (a > std::numeric_limits<address_t>::max() && !is_wide)
+		{
+			is_wide = true;
+			wide.reserve(st.size() + 1);
+			for (const auto &earlier : st)
+				wide.push_back(earlier.address);
+		}
+		if (is_wide)
+			wide.push_back(a);
+
+		ma.address = static_cast<address_t>(a);
 		ma.last_memory_access_count =
 			static_cast<uint_fast8_t>(last_memory_access_count);
 
 		st.push_back(std::move(ma));
 	}
 
+	if (address_map)
+		address_map->reset();
+	if (is_wide)
+	{
+		auto map{AddressMap::Build(wide)};
+		for (size_t i{}; i < st.size(); ++i)
+			st[i].address = map->Compact(wide[i]);
+		if (address_map)
+			*address_map = std::move(map);
+	}
+
 	return st;
 }
+
+std::optional<StackTrace> ReadStackTraceFile(
+	const std::string &s,
+	const std::string &sidecar_folder,
+	std::optional<AddressMap> *address_map)
+{
+	std::error_code ec;
+	const auto trace_size{std::filesystem::file_size(s, ec)};
+	if (ec)
+		return {};
+	const auto trace_mtime{static_cast<int64_t>(
+		std::filesystem::last_write_time(s, ec).time_since_epoch().count())};
+	if (ec)
+		return {};
+
+	const auto sidecar{SidecarPath(s, sidecar_folder)};
+	auto st{MapSidecar(sidecar, trace_size, trace_mtime)};
+	if (st.has_value())
+	{
+		if (address_map)
+			address_map->reset();
+		return st;
+	}
+
+	// the sidecar holds the addresses as they are, so wide traces have none
+	std::optional<AddressMap> map;
+	st = ReadStackTraceFile(s, &map);
+	if (st.has_value() && !map.has_value())
+		WriteSidecar(sidecar, st.value(), trace_size, trace_mtime);
+	if (address_map)
+		*address_map = std::move(map);
+	return st;
+}
+
+std::optional<TlbConf> ReadTlbConfFile(const std::string &s)
+{
+	TlbConf conf{};
+	std::ifstream file(s, std::ios_base::in);
+	if (!file)
+		return {};
+
+	unsigned int tmp;
+	file >> tmp;
+	conf.entries_ = static_cast<uint16_t>(tmp);
+	file >> tmp;
+	conf.associativity_ = static_cast<uint_fast8_t>(tmp);
+	file >> tmp;
+	conf.page_size_ = tmp;
+	file >> tmp;
+	switch (tmp)
+	{
+		case 0:
+			conf.replacement_policy_ = ReplacementPolicy::RAND;
+			break;
+		case 1:
+			conf.replacement_policy_ = ReplacementPolicy::FIFO;
+			break;
+		default:
+			return {};
+	}
+	file >> tmp;
+	conf.walk_penalty_ = static_cast<uint16_t>(tmp);
+	file >> tmp;
+	conf.huge_entries_ = static_cast<uint16_t>(tmp);
+	file >> tmp;
+	conf.huge_associativity_ = static_cast<uint_fast8_t>(tmp);
+	file >> tmp;
+	conf.huge_page_size_ = tmp;
+	if (!file)
+		return {};
+
+	// the rest of the file is first and last address of each huge page region
+	std::string first;
+	std::string last;
+	while (file >> first >> last)
+		conf.huge_regions_.emplace_back(
+			static_cast<address_t>(std::stoul(first, 0, 16)),
+			static_cast<address_t>(std::stoul(last, 0, 16)));
+
+	return conf;
+}
+
+std::optional<InclusionPolicy> ParseInclusionPolicy(const std::string &s)
+{
+	if (s == "inclusive")
+		return InclusionPolicy::INCLUSIVE;
+	if (s == "exclusive")
+		return InclusionPolicy::EXCLUSIVE;
+	if (s == "non-inclusive")
+		return InclusionPolicy::NON_INCLUSIVE;
+	return {};
+}
+
+std::optional<PrefetcherType> ParsePrefetcherType(const std::string &s)
+{
+	if (s == "next-line")
+		return PrefetcherType::NEXT_LINE;
+	if (s == "stride")
+		return PrefetcherType::STRIDE;
+	if (s == "stream")
+		return PrefetcherType::STREAM;
+	return {};
+}
+
+std::optional<InterleavePolicy> ParseInterleavePolicy(const std::string &s)
+{
+	if (s == "round-robin")
+		return InterleavePolicy::ROUND_ROBIN;
+	if (s == "timestamp")
+		return InterleavePolicy::TIMESTAMP;
+	return {};
+}
+
+std::optional<SamplingPolicy> ParseSamplingPolicy(const std::string &s)
+{
+	if (s == "periodic")
+		return SamplingPolicy::PERIODIC;
+	if (s == "random")
+		return SamplingPolicy::RANDOM;
+	return {};
+}
+
+std::optional<ResultsTable::Format> ParseResultsFormat(const std::string &s)
+{
+	if (s == "csv")
+		return ResultsTable::CSV;
+	if (s == "jsonl")
+		return ResultsTable::JSONL;
+	return {};
+}
+
+std::optional<CoherenceProtocol> ParseCoherenceProtocol(const std::string &s)
+{
+	if (s == "snoop")
+		return SNOOP;
+	if (s == "directory")
+		return DIRECTORY;
+	return {};
+}
 }  // namespace Util
@@ -13,12 +13,35 @@
 #include <iostream>
 #include <optional>
 
+#include "address_map.hpp"
 #include "cache_sim.hpp"
+#include "coherent_sim.hpp"
+#include "results_table.hpp"
+#include "shared_cache_sim.hpp"
 
 namespace Util
 {
 std::optional<CacheConf> ReadCacheConfFile(const std::string &s);
-std::optional<StackTrace> ReadStackTraceFile(const std::string &s);
+// addresses wider than address_t are renumbered to fit, address_map is set to
+// the renumbering then and reset otherwise
+std::optional<StackTrace> ReadStackTraceFile(
+	const std::string &s,
+	std::optional<AddressMap> *address_map = nullptr);
+// reads the binary sidecar of the trace when it is still current, otherwise
+// parses the trace and writes the sidecar. The sidecar is put next to the
+// trace, or in sidecar_folder when it is not empty. Traces with wide
+// addresses have no sidecar
+std::optional<StackTrace> ReadStackTraceFile(
+	const std::string &s,
+	const std::string &sidecar_folder,
+	std::optional<AddressMap> *address_map = nullptr);
+std::optional<TlbConf> ReadTlbConfFile(const std::string &s);
+std::optional<InclusionPolicy> ParseInclusionPolicy(const std::string &s);
+std::optional<PrefetcherType> ParsePrefetcherType(const std::string &s);
+std::optional<InterleavePolicy> ParseInterleavePolicy(const std::string &s);
+std::optional<SamplingPolicy> ParseSamplingPolicy(const std::string &s);
+std::optional<ResultsTable::Format> ParseResultsFormat(const std::string &s);
+std::optional<CoherenceProtocol> ParseCoherenceProtocol(const std::string &s);
 
 struct Timer
 {
@@ -0,0 +1,50 @@
+/**
+ * filename: victim_cache.cpp
+ *
+ * description: the victim cache model
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "victim_cache.hpp"
+
+#include <algorithm>
+
+std::optional<bool> VictimCache::Probe(address_t block_address, bool swap)
+{
+	stats_.probes++;
+	const auto it{std::ranges::find(
+		entries_, block_address, &cache_block_t::block_address)};
+	if (it == entries_.end())
+		return {};
+
+	stats_.hits++;
+	stats_.swap_cycles += victim_conf_.hit_latency_;
+	const bool dirty{it->dirty};
+	if (swap)
+		entries_.erase(it);
+	return dirty;
+}
+
+std::optional<cache_block_t> VictimCache::Insert(const cache_block_t &block)
+{
+	stats_.insertions++;
+	entries_.push_back(block);
+	if (entries_.size() <= victim_conf_.entries_)
+		return {};
+
+	const auto out{entries_.front()};
+	entries_.erase(entries_.begin());
+	if (out.dirty)
+		stats_.writebacks++;
+	return out;
+}
+
+VictimCacheStats VictimCache::get_stats() const
+{
+	auto stats{stats_};
+	stats.hit_rate = stats.probes ? static_cast<double>(stats.hits) /
+										static_cast<double>(stats.probes)
+								  : 0;
+	return stats;
+}
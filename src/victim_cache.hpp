@@ -0,0 +1,70 @@
+/**
+ * filename: victim_cache.hpp
+ *
+ * description: header file for the victim cache model
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "base_structs.hpp"
+#include "cache_block.hpp"
+
+/**
+ * @brief a small fully associative buffer of the blocks a cache evicts
+ * @description Every miss of the cache probes the victim cache. On a hit the
+ *block is swapped back into the cache and the block the cache evicted for it
+ *takes its place, so the miss costs hit_latency cycles instead of a trip to
+ *memory. Blocks only enter on an eviction and leave on a hit, so the oldest
+ *entry is also the least recently used one.
+ **/
+class VictimCache
+{
+private:
+	const VictimCacheConf victim_conf_;
+	// oldest first
+	std::vector<cache_block_t> entries_;
+	VictimCacheStats stats_{};
+
+public:
+	VictimCache(const VictimCacheConf &vc) : victim_conf_{vc}
+	{
+		entries_.reserve(vc.entries_);
+	}
+
+	/**
+	 * @brief look for the block a miss of the cache wants
+	 * @param swap take the block out, the cache allocated it
+	 * @return the dirty bit of the block, nothing on a miss
+	 **/
+	std::optional<bool> Probe(address_t block_address, bool swap);
+
+	/**
+	 * @brief put a block the cache evicted in as the newest entry
+	 * @return the oldest entry when it had to make room
+	 **/
+	std::optional<cache_block_t> Insert(const cache_block_t &block);
+
+	// statistics since the last reset
+	VictimCacheStats get_stats() const;
+
+	void ResetStats()
+	{
+		stats_ = {};
+	};
+
+	void Clear()
+	{
+		entries_.clear();
+	};
+
+	VictimCacheConf get_victim_config() const
+	{
+		return victim_conf_;
+	};
+};
@@ -0,0 +1,50 @@
+/**
+ * filename: write_buffer.cpp
+ *
+ * description: the coalescing write buffer model
+ *
+ * authors: Chamberlain, David
+ **/
+
+#include "write_buffer.hpp"
+
+#include <algorithm>
+
+void WriteBuffer::Write(address_t line, uint64_t now)
+{
+	// every earlier wait delayed the rest of the trace as well
+	now += stats_.stall_cycles;
+	while (!entries_.empty() && entries_.front().done <= now)
+		entries_.pop_front();
+
+	stats_.writes++;
+	if (std::ranges::find(entries_, line, &Entry::line) != entries_.end())
+	{
+		stats_.coalesced++;
+		return;
+	}
+
+	if (entries_.size() >= buffer_conf_.depth_ && !entries_.empty())
+	{
+		const auto wait{entries_.front().done - now};
+		stats_.stall_cycles += wait;
+		now += wait;
+		entries_.pop_front();
+	}
+
+	// the lines drain one after the other
+	const auto start{entries_.empty() ? now
+									  : std::max(now, entries_.back().done)};
+	entries_.push_back({.line = line, .done = start + buffer_conf_.drain_cycles_});
+}
+
+WriteBufferStats WriteBuffer::get_stats() const
+{
+	auto stats{stats_};
+	// every line that was not merged is written to memory in the end
+	stats.memory_writes = stats.writes - stats.coalesced;
+	stats.coalesce_rate = stats.writes ? static_cast<double>(stats.coalesced) /
+											 static_cast<double>(stats.writes)
+									   : 0;
+	return stats;
+}
@@ -0,0 +1,65 @@
+/**
+ * filename: write_buffer.hpp
+ *
+ * description: header file for the coalescing write buffer model
+ *
+ * authors: Chamberlain, David
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+#include "base_structs.hpp"
+
+/**
+ * @brief a FIFO of lines waiting to be written to memory
+ * @description The buffer takes the writes a cache sends to memory, every
+ *store of a write-through cache or every dirty block a write-back cache
+ *evicts. A write to a line already waiting is merged into it. The lines
+ *drain one at a time, drain_cycles each, and a write to a full buffer waits
+ *for the oldest line to finish. Time is the instruction count of the trace
+ *plus the cycles already spent waiting.
+ **/
+class WriteBuffer
+{
+private:
+	struct Entry
+	{
+		address_t line;
+		// cycle the line is written to memory
+		uint64_t done;
+	};
+
+	const WriteBufferConf buffer_conf_;
+	std::deque<Entry> entries_;
+	WriteBufferStats stats_{};
+
+public:
+	WriteBuffer(const WriteBufferConf &wc) : buffer_conf_{wc} {}
+
+	/**
+	 * @brief buffer a write of line at instruction count now
+	 **/
+	void Write(address_t line, uint64_t now);
+
+	// statistics since the last reset
+	WriteBufferStats get_stats() const;
+
+	void ResetStats()
+	{
+		stats_ = {};
+	};
+
+	// drop every waiting line
+	void Clear()
+	{
+		entries_.clear();
+	};
+
+	WriteBufferConf get_buffer_config() const
+	{
+		return buffer_conf_;
+	};
+};